@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* Measures escape encoding alone: full frames of a 256 x 64 grid are rendered
+ * into memory with nt_ctx_render_to(), so no system calls are made. The
+ * optional arguments are the TERM and COLORTERM values to encode for, by
+ * default xterm-256color and truecolor. Results are printed to stderr. */
+
+#include "nt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_WIDTH 256
+#define BENCH_HEIGHT 64
+#define BENCH_FRAMES 500
+#define BENCH_BUFF_CAP (4 << 20)
+
+struct bench_frame
+{
+    struct nt_ctx* ctx;
+    struct nt_grid* grid;
+};
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static int bench_render(void* data)
+{
+    struct bench_frame* frame = data;
+    return nt_ctx_grid_draw(frame->ctx, frame->grid);
+}
+
+int main(int argc, char** argv)
+{
+    const char* term = (argc > 1) ? argv[1] : "xterm-256color";
+    const char* colorterm = (argc > 2) ? argv[2] : "truecolor";
+
+    struct bench_frame frame;
+    int status = nt_ctx_new(-1, -1, term, colorterm, &frame.ctx);
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_ctx_new() failed: %d\n", status);
+        return 1;
+    }
+
+    if(nt_grid_new(BENCH_WIDTH, BENCH_HEIGHT, &frame.grid) != 0)
+    {
+        fprintf(stderr, "nt_grid_new() failed\n");
+        return 1;
+    }
+
+    nt_gfx_id ids[16];
+    size_t i, x, y;
+    for(i = 0; i < 16; i++)
+    {
+        struct nt_gfx gfx = NT_GFX_DEFAULT;
+        gfx.fg = nt_color_new_auto(i * 16, 255 - (i * 16), 128);
+        nt_gfx_intern(gfx, &ids[i]);
+    }
+
+    for(y = 0; y < BENCH_HEIGHT; y++)
+    {
+        for(x = 0; x < BENCH_WIDTH; x++)
+        {
+            nt_grid_set(frame.grid, x, y, (struct nt_cell) {
+                .cp = 'a' + ((x + y) % 26), .gfx = ids[(x / 7) % 16] });
+        }
+    }
+
+    char* buff = malloc(BENCH_BUFF_CAP);
+    if(buff == NULL)
+        return 1;
+
+    size_t len = 0;
+    unsigned long long bytes = 0;
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        status = nt_ctx_render_to(frame.ctx, bench_render, &frame,
+                buff, BENCH_BUFF_CAP, &len);
+        if(status != 0)
+        {
+            fprintf(stderr, "nt_ctx_render_to() failed: %d\n", status);
+            return 1;
+        }
+        bytes += len;
+    }
+    unsigned long long total_ns = bench_now_ns() - start_ns;
+
+    fprintf(stderr, "%s %s: %d frames, %zu bytes/frame, %.1f us/frame, "
+            "%.1f MB/s\n", term, colorterm, BENCH_FRAMES, len,
+            (total_ns / 1000.0) / BENCH_FRAMES,
+            (bytes / 1e6) / (total_ns / 1e9));
+
+    free(buff);
+    nt_grid_destroy(frame.grid);
+    nt_ctx_destroy(frame.ctx);
+
+    return 0;
+}
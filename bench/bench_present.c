@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* Measures nt_grid_present() diff time on a 4096 x 256 grid. The optional
+ * argument is passed to nt_grid_set_present_threads(). Output goes to stdout,
+ * so redirect it to /dev/null. stdin must be a terminal. Results are printed
+ * to stderr. */
+
+#include "nt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_WIDTH 4096
+#define BENCH_HEIGHT 256
+#define BENCH_FRAMES 200
+#define BENCH_BUFF_CAP 65536
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static void bench_report(const char* name, unsigned long long total_ns)
+{
+    fprintf(stderr, "%s: %d frames, %.1f us/frame, %.1f ns/row\n",
+            name, BENCH_FRAMES, (total_ns / 1000.0) / BENCH_FRAMES,
+            (double)total_ns / ((unsigned long long)BENCH_FRAMES * BENCH_HEIGHT));
+}
+
+int main(int argc, char** argv)
+{
+    int status = nt_init();
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_init() failed: %d\n", status);
+        return 1;
+    }
+
+    unsigned int threads = (argc > 1) ? (unsigned int)atoi(argv[1]) : 1;
+    if(nt_grid_set_present_threads(threads) != 0)
+    {
+        fprintf(stderr, "nt_grid_set_present_threads() failed\n");
+        return 1;
+    }
+
+    static char buff[BENCH_BUFF_CAP];
+    nt_buffer_enable(buff, sizeof(buff));
+
+    struct nt_grid *screen, *grid;
+    if((nt_grid_new(BENCH_WIDTH, BENCH_HEIGHT, &screen) != 0) ||
+       (nt_grid_new(BENCH_WIDTH, BENCH_HEIGHT, &grid) != 0))
+    {
+        fprintf(stderr, "nt_grid_new() failed\n");
+        return 1;
+    }
+
+    nt_gfx_id ids[16];
+    size_t i, x, y;
+    for(i = 0; i < 16; i++)
+    {
+        struct nt_gfx gfx = NT_GFX_DEFAULT;
+        gfx.fg = nt_color_new_auto(i * 16, 255 - (i * 16), 128);
+        nt_gfx_intern(gfx, &ids[i]);
+    }
+
+    for(y = 0; y < BENCH_HEIGHT; y++)
+    {
+        for(x = 0; x < BENCH_WIDTH; x++)
+        {
+            nt_grid_set(grid, x, y, (struct nt_cell) {
+                .cp = 'a' + ((x + y) % 26), .gfx = ids[(x / 7) % 16] });
+        }
+    }
+    nt_grid_present(screen, grid);
+
+    /* Rows are rewritten with the same contents, so every row is hashed. */
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        for(y = 0; y < BENCH_HEIGHT; y++)
+        {
+            nt_grid_set(grid, y, y, (struct nt_cell) {
+                .cp = 'a' + ((2 * y) % 26), .gfx = ids[(y / 7) % 16] });
+        }
+        nt_grid_present(screen, grid);
+    }
+    nt_buffer_flush();
+    bench_report("unchanged", bench_now_ns() - start_ns);
+
+    /* One cell per row changes, so every row is compared and one cell of it
+     * is drawn. */
+    start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        x = (i * 37) % BENCH_WIDTH;
+        for(y = 0; y < BENCH_HEIGHT; y++)
+        {
+            nt_grid_set(grid, x, y, (struct nt_cell) {
+                .cp = 'A' + (i % 26), .gfx = ids[i % 16] });
+        }
+        nt_grid_present(screen, grid);
+    }
+    nt_buffer_flush();
+    bench_report("one cell per row", bench_now_ns() - start_ns);
+
+    /* Every cell changes, so encoding dominates. */
+    start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        for(y = 0; y < BENCH_HEIGHT; y++)
+        {
+            for(x = 0; x < BENCH_WIDTH; x++)
+            {
+                nt_grid_set(grid, x, y, (struct nt_cell) {
+                    .cp = 'a' + ((x + y + i) % 26),
+                    .gfx = ids[((x / 7) + i) % 16] });
+            }
+        }
+        nt_grid_present(screen, grid);
+    }
+    nt_buffer_flush();
+    bench_report("every cell", bench_now_ns() - start_ns);
+
+    nt_grid_destroy(screen);
+    nt_grid_destroy(grid);
+    nt_buffer_disable(NT_BUFF_DISCARD, NULL);
+    nt_grid_set_present_threads(1);
+    nt_deinit();
+
+    return 0;
+}
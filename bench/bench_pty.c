@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* End-to-end benchmarks through a pseudo-terminal. The program forks: the
+ * child runs nuterm with the pty as its terminal, and the parent acts as the
+ * terminal, reading and discarding output and typing input when the child
+ * asks for it. Measured in the child:
+ * - present: write system calls, bytes and time per nt_grid_present() frame,
+ *   flushed every frame, for sparse and full changes. System calls and bytes
+ *   come from /proc/self/io and are -1 where it is not available.
+ * - write_str: time per cell of nt_write_str().
+ * - events: time per event of nt_event_push() followed by nt_event_wait().
+ * - input: time per event and MB/s of parsing keys, SGR mouse reports and a
+ *   pasted block of UTF-8 text.
+ * Results are printed to stdout as one JSON object. The optional arguments
+ * are the TERM and COLORTERM values for the child, by default xterm-256color
+ * and truecolor. */
+
+#include "nt.h"
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_WIDTH 160
+#define BENCH_HEIGHT 48
+#define BENCH_FRAMES 500
+#define BENCH_WRITE_CALLS 100000
+#define BENCH_WRITE_CELLS 80
+#define BENCH_EVENTS 204800
+#define BENCH_EVENT_BATCH 256
+#define BENCH_INPUT_REPEAT 4000
+#define BENCH_INPUT_TIMEOUT_MS 2000
+#define BENCH_BUFF_CAP 65536
+#define BENCH_JSON_CAP 4096
+
+/* Input the parent types, requested by the child with the first byte. */
+static const struct bench_input
+{
+    char req;
+    const char* name;
+    const char* unit; // typed BENCH_INPUT_REPEAT times
+    size_t unit_events;
+    uint32_t type;
+} bench_inputs[] = {
+    { 'k', "keys", "abc\x1b[Axyz\x1b[B\x7f\t", 10, NT_EVENT_KEY },
+    { 'm', "mouse", "\x1b[<0;12;7M\x1b[<64;80;24M", 2, NT_EVENT_MOUSE },
+    { 'p', "paste", "Lorem ipsum d\xc3\xb6lor sit \xe2\x9c\x93 amet, ", 30,
+        NT_EVENT_KEY }
+};
+
+#define BENCH_INPUT_COUNT (sizeof(bench_inputs) / sizeof(bench_inputs[0]))
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/* -------------------------------------------------------------------------- */
+/* CHILD */
+/* -------------------------------------------------------------------------- */
+
+struct bench_io
+{
+    long long syscw, wchar; // -1 if unknown
+};
+
+static struct bench_io bench_io_get(void)
+{
+    struct bench_io io = { -1, -1 };
+
+    FILE* file = fopen("/proc/self/io", "r");
+    if(file == NULL)
+        return io;
+
+    char line[128];
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        sscanf(line, "syscw: %lld", &io.syscw);
+        sscanf(line, "wchar: %lld", &io.wchar);
+    }
+    fclose(file);
+
+    return io;
+}
+
+static double bench_io_per(long long end, long long start, size_t count)
+{
+    if((end < 0) || (start < 0))
+        return -1;
+
+    return (double)(end - start) / count;
+}
+
+static size_t bench_present(struct nt_grid* screen, struct nt_grid* grid,
+        const nt_gfx_id* ids, bool full, char* json, size_t json_cap)
+{
+    size_t i, x, y, x0, x1;
+
+    struct bench_io io_start = bench_io_get();
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        for(y = 0; y < BENCH_HEIGHT; y++)
+        {
+            /* Sparse frames change one cell per row. */
+            x0 = full ? 0 : ((i + y) % BENCH_WIDTH);
+            x1 = full ? BENCH_WIDTH : (x0 + 1);
+            for(x = x0; x < x1; x++)
+            {
+                nt_grid_set(grid, x, y, (struct nt_cell) {
+                    .cp = 'a' + ((x + y + i) % 26),
+                    .gfx = ids[((x / 7) + i) % 16] });
+            }
+        }
+        nt_grid_present(screen, grid);
+        nt_buffer_flush();
+    }
+    unsigned long long total_ns = bench_now_ns() - start_ns;
+    struct bench_io io_end = bench_io_get();
+
+    return (size_t)snprintf(json, json_cap,
+            "\"%s\": { \"frames\": %d, \"us_per_frame\": %.2f, "
+            "\"syscalls_per_frame\": %.2f, \"bytes_per_frame\": %.1f }",
+            full ? "full" : "sparse", BENCH_FRAMES,
+            (total_ns / 1000.0) / BENCH_FRAMES,
+            bench_io_per(io_end.syscw, io_start.syscw, BENCH_FRAMES),
+            bench_io_per(io_end.wchar, io_start.wchar, BENCH_FRAMES));
+}
+
+static size_t bench_write_str(const nt_gfx_id* ids, char* json,
+        size_t json_cap)
+{
+    char str[BENCH_WRITE_CELLS];
+    size_t i;
+    for(i = 0; i < BENCH_WRITE_CELLS; i++)
+        str[i] = 'a' + (i % 26);
+
+    struct nt_gfx gfx = NT_GFX_DEFAULT;
+    gfx.fg = nt_color_new_auto(200, 100, 50);
+
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_WRITE_CALLS; i++)
+    {
+        nt_cursor_move(0, i % BENCH_HEIGHT);
+        nt_write_str(str, BENCH_WRITE_CELLS, gfx);
+    }
+    nt_buffer_flush();
+    unsigned long long str_ns = bench_now_ns() - start_ns;
+
+    start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_WRITE_CALLS; i++)
+    {
+        nt_cursor_move(0, i % BENCH_HEIGHT);
+        nt_write_str_id(str, BENCH_WRITE_CELLS, ids[i % 16]);
+    }
+    nt_buffer_flush();
+    unsigned long long id_ns = bench_now_ns() - start_ns;
+
+    double cells = (double)BENCH_WRITE_CALLS * BENCH_WRITE_CELLS;
+
+    return (size_t)snprintf(json, json_cap,
+            "\"write_str\": { \"cells\": %.0f, \"ns_per_cell\": %.3f, "
+            "\"ns_per_cell_id\": %.3f }", cells, str_ns / cells, id_ns / cells);
+}
+
+static size_t bench_events(char* json, size_t json_cap)
+{
+    struct nt_event event, out_event;
+    nt_event_new_custom(NT_EVENT_CUSTOM_BASE, NULL, 0, &event);
+
+    size_t i, j;
+    size_t count = 0;
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < (BENCH_EVENTS / BENCH_EVENT_BATCH); i++)
+    {
+        for(j = 0; j < BENCH_EVENT_BATCH; j++)
+            nt_event_push(&event);
+
+        for(j = 0; j < BENCH_EVENT_BATCH; j++)
+        {
+            nt_event_wait(&out_event, 0, NULL);
+            count += (out_event.type == NT_EVENT_CUSTOM_BASE);
+        }
+    }
+    unsigned long long total_ns = bench_now_ns() - start_ns;
+
+    return (size_t)snprintf(json, json_cap,
+            "\"events\": { \"count\": %zu, \"ns_per_event\": %.1f }",
+            count, (double)total_ns / count);
+}
+
+/* Asks the parent for `input` and times parsing it, from the first event to
+ * the last. */
+static size_t bench_input(const struct bench_input* input, int ctl_fd,
+        char* json, size_t json_cap)
+{
+    size_t expected = input->unit_events * BENCH_INPUT_REPEAT;
+    size_t bytes = strlen(input->unit) * BENCH_INPUT_REPEAT;
+    size_t count = 0;
+    unsigned long long start_ns = 0, end_ns = 0;
+    struct nt_event event;
+
+    if(write(ctl_fd, &input->req, 1) != 1)
+        return 0;
+
+    while(count < expected)
+    {
+        if((nt_event_wait(&event, BENCH_INPUT_TIMEOUT_MS, NULL) != 0) ||
+           (event.type == NT_EVENT_TIMEOUT))
+            break;
+        if(event.type != input->type)
+            continue;
+
+        if(count++ == 0)
+            start_ns = bench_now_ns();
+        end_ns = bench_now_ns();
+    }
+
+    double total_ns = (count > 1) ? (double)(end_ns - start_ns) : 0;
+
+    return (size_t)snprintf(json, json_cap,
+            "\"%s\": { \"events\": %zu, \"expected\": %zu, "
+            "\"ns_per_event\": %.1f, \"mb_per_s\": %.2f }",
+            input->name, count, expected,
+            (count > 1) ? (total_ns / (count - 1)) : 0.0,
+            (count > 1) ? ((bytes / 1e6) / (total_ns / 1e9)) : 0.0);
+}
+
+static int bench_child(const char* term, const char* colorterm,
+        int ctl_fd, int res_fd)
+{
+    setenv("TERM", term, 1);
+    setenv("COLORTERM", colorterm, 1);
+
+    int status = nt_init();
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        dprintf(res_fd, "{ \"error\": \"nt_init() failed: %d\" }\n", status);
+        return 1;
+    }
+
+    static char buff[BENCH_BUFF_CAP];
+    nt_buffer_enable(buff, sizeof(buff));
+
+    struct nt_grid *screen, *grid;
+    if((nt_grid_new(0, 0, &screen) != 0) ||
+       (nt_grid_new(BENCH_WIDTH, BENCH_HEIGHT, &grid) != 0))
+    {
+        dprintf(res_fd, "{ \"error\": \"nt_grid_new() failed\" }\n");
+        return 1;
+    }
+
+    nt_gfx_id ids[16];
+    size_t i;
+    for(i = 0; i < 16; i++)
+    {
+        struct nt_gfx gfx = NT_GFX_DEFAULT;
+        gfx.fg = nt_color_new_auto(i * 16, 255 - (i * 16), 128);
+        nt_gfx_intern(gfx, &ids[i]);
+    }
+    nt_grid_present(screen, grid);
+    nt_buffer_flush();
+
+    char json[BENCH_JSON_CAP];
+    size_t len = (size_t)snprintf(json, sizeof(json),
+            "{ \"term\": \"%s\", \"colorterm\": \"%s\", "
+            "\"width\": %d, \"height\": %d, \"present\": { ",
+            term, colorterm, BENCH_WIDTH, BENCH_HEIGHT);
+
+    len += bench_present(screen, grid, ids, false,
+            json + len, sizeof(json) - len);
+    len += snprintf(json + len, sizeof(json) - len, ", ");
+    len += bench_present(screen, grid, ids, true,
+            json + len, sizeof(json) - len);
+    len += snprintf(json + len, sizeof(json) - len, " }, ");
+    len += bench_write_str(ids, json + len, sizeof(json) - len);
+    len += snprintf(json + len, sizeof(json) - len, ", ");
+    len += bench_events(json + len, sizeof(json) - len);
+    len += snprintf(json + len, sizeof(json) - len, ", \"input\": { ");
+    for(i = 0; i < BENCH_INPUT_COUNT; i++)
+    {
+        len += bench_input(&bench_inputs[i], ctl_fd,
+                json + len, sizeof(json) - len);
+        len += snprintf(json + len, sizeof(json) - len,
+                (i + 1 < BENCH_INPUT_COUNT) ? ", " : " } }\n");
+    }
+
+    nt_buffer_disable(NT_BUFF_FLUSH, NULL);
+    nt_grid_destroy(screen);
+    nt_grid_destroy(grid);
+    nt_deinit();
+
+    if(write(res_fd, json, len) != (ssize_t)len)
+        return 1;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* PARENT */
+/* -------------------------------------------------------------------------- */
+
+static void bench_type(int master_fd, const struct bench_input* input)
+{
+    size_t unit_len = strlen(input->unit);
+    size_t i, written;
+    ssize_t status;
+
+    for(i = 0; i < BENCH_INPUT_REPEAT; i++)
+    {
+        written = 0;
+        while(written < unit_len)
+        {
+            status = write(master_fd, input->unit + written,
+                    unit_len - written);
+            if(status < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                return;
+            }
+            written += (size_t)status;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* term = (argc > 1) ? argv[1] : "xterm-256color";
+    const char* colorterm = (argc > 2) ? argv[2] : "truecolor";
+
+    struct winsize size = {
+        .ws_col = BENCH_WIDTH,
+        .ws_row = BENCH_HEIGHT
+    };
+    int master_fd, slave_fd;
+    if(openpty(&master_fd, &slave_fd, NULL, NULL, &size) != 0)
+    {
+        perror("openpty");
+        return 1;
+    }
+
+    int ctl_pipe[2], res_pipe[2];
+    if((pipe(ctl_pipe) != 0) || (pipe(res_pipe) != 0))
+    {
+        perror("pipe");
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if(pid < 0)
+    {
+        perror("fork");
+        return 1;
+    }
+    if(pid == 0)
+    {
+        close(master_fd);
+        close(ctl_pipe[0]);
+        close(res_pipe[0]);
+
+        setsid();
+        ioctl(slave_fd, TIOCSCTTY, 0);
+        dup2(slave_fd, STDIN_FILENO);
+        dup2(slave_fd, STDOUT_FILENO);
+        close(slave_fd);
+
+        _exit(bench_child(term, colorterm, ctl_pipe[1], res_pipe[1]));
+    }
+
+    close(slave_fd);
+    close(ctl_pipe[1]);
+    close(res_pipe[1]);
+
+    /* Output is discarded. The loop ends once the child closes the result
+     * pipe. */
+    struct pollfd fds[3] = {
+        { .fd = master_fd, .events = POLLIN },
+        { .fd = ctl_pipe[0], .events = POLLIN },
+        { .fd = res_pipe[0], .events = POLLIN }
+    };
+    static char buff[BENCH_BUFF_CAP];
+    char req;
+    size_t i;
+    ssize_t len;
+
+    while(fds[2].fd >= 0)
+    {
+        if(poll(fds, 3, -1) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        if(fds[0].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+            if(read(master_fd, buff, sizeof(buff)) <= 0)
+                fds[0].fd = -1;
+        }
+        if(fds[1].revents & (POLLIN | POLLHUP))
+        {
+            if(read(ctl_pipe[0], &req, 1) == 1)
+            {
+                for(i = 0; i < BENCH_INPUT_COUNT; i++)
+                {
+                    if(bench_inputs[i].req == req)
+                        bench_type(master_fd, &bench_inputs[i]);
+                }
+            }
+            else
+                fds[1].fd = -1;
+        }
+        if(fds[2].revents & (POLLIN | POLLHUP))
+        {
+            len = read(res_pipe[0], buff, sizeof(buff));
+            if(len > 0)
+                fwrite(buff, 1, (size_t)len, stdout);
+            else
+                fds[2].fd = -1;
+        }
+    }
+
+    int child_status;
+    waitpid(pid, &child_status, 0);
+    close(master_fd);
+
+    return (WIFEXITED(child_status) && (WEXITSTATUS(child_status) == 0)) ?
+        0 : 1;
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* Records and replays terminal input, see nt_input_record_start().
+ *
+ * bench_replay record FILE
+ *     Records input from the terminal to FILE, with mouse reporting on,
+ *     until Ctrl+Q is pressed.
+ *
+ * bench_replay FILE [TERM [COLORTERM]]
+ *     Replays FILE into a context reading from a pipe, parsing for TERM and
+ *     COLORTERM, by default xterm-256color and truecolor. A virtual clock is
+ *     set to the time of each record before its bytes are written, so
+ *     timeouts and frame pacing behave the same on every run. After each
+ *     record, events are taken until none is left. Prints one JSON object to
+ *     stdout with event counts by type, the distribution of events per record
+ *     and the latency of each nt_event_wait() that delivered an event. */
+
+#include "nt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_CTRL_Q 0x11
+#define BENCH_PER_RECORD_MAX 4 // the last bucket counts this many or more
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static int bench_cmp_ull(const void* a, const void* b)
+{
+    unsigned long long ull_a = *(const unsigned long long*)a;
+    unsigned long long ull_b = *(const unsigned long long*)b;
+    return (ull_a > ull_b) - (ull_a < ull_b);
+}
+
+/* -------------------------------------------------------------------------- */
+/* RECORD */
+/* -------------------------------------------------------------------------- */
+
+static int bench_record(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    int status = nt_init();
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_init() failed: %d\n", status);
+        fclose(file);
+        return 1;
+    }
+
+    nt_alt_screen_enable();
+    nt_mouse_mode_enable();
+    nt_erase_screen();
+    nt_write_str_unsafe("Recording, press Ctrl+Q to stop.", NT_GFX_DEFAULT);
+
+    size_t count = 0;
+    struct nt_event event;
+    struct nt_key key;
+    if(nt_input_record_start(fileno(file)) == 0)
+    {
+        while(nt_event_wait(&event, NT_EVENT_WAIT_FOREVER, NULL) == 0)
+        {
+            if(event.type == NT_EVENT_KEY)
+            {
+                NT_EVENT_FILL_DATA(event, &key);
+                if(nt_key_utf32_match(key, BENCH_CTRL_Q))
+                    break;
+            }
+            if(event.type & (NT_EVENT_KEY | NT_EVENT_MOUSE))
+                count++;
+        }
+        nt_input_record_stop();
+    }
+
+    nt_mouse_mode_disable();
+    nt_alt_screen_disable();
+    nt_deinit();
+    fclose(file);
+
+    fprintf(stderr, "%zu events recorded to %s\n", count, path);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* REPLAY */
+/* -------------------------------------------------------------------------- */
+
+struct bench_stats
+{
+    size_t records;
+    size_t bytes;
+    unsigned long long duration_us;
+
+    size_t keys, esc_keys, mouse, other;
+    size_t per_record[BENCH_PER_RECORD_MAX + 1];
+
+    unsigned long long* latencies_ns;
+    size_t latency_count;
+    size_t latency_cap;
+};
+
+static int bench_latency_add(struct bench_stats* stats,
+        unsigned long long latency_ns)
+{
+    if(stats->latency_count == stats->latency_cap)
+    {
+        size_t new_cap = (stats->latency_cap > 0) ?
+            (stats->latency_cap * 2) : 1024;
+        unsigned long long* new_latencies = realloc(stats->latencies_ns,
+                new_cap * sizeof(unsigned long long));
+        if(new_latencies == NULL)
+            return 1;
+
+        stats->latencies_ns = new_latencies;
+        stats->latency_cap = new_cap;
+    }
+
+    stats->latencies_ns[stats->latency_count++] = latency_ns;
+
+    return 0;
+}
+
+/* Takes events from `ctx` until none is ready. */
+static int bench_drain(struct nt_ctx* ctx, struct bench_stats* stats)
+{
+    struct nt_event event;
+    struct nt_key key;
+    unsigned long long start_ns, latency_ns;
+    size_t count = 0;
+
+    while(true)
+    {
+        start_ns = bench_now_ns();
+        if(nt_ctx_event_wait(ctx, &event, 0, NULL) != 0)
+            return 1;
+        latency_ns = bench_now_ns() - start_ns;
+
+        if(event.type == NT_EVENT_TIMEOUT)
+            break;
+
+        if(event.type == NT_EVENT_KEY)
+        {
+            NT_EVENT_FILL_DATA(event, &key);
+            if(key.type == NT_KEY_ESC)
+                stats->esc_keys++;
+            else
+                stats->keys++;
+        }
+        else if(event.type == NT_EVENT_MOUSE)
+            stats->mouse++;
+        else
+            stats->other++;
+
+        count++;
+        if(bench_latency_add(stats, latency_ns) != 0)
+            return 1;
+    }
+
+    stats->per_record[(count < BENCH_PER_RECORD_MAX) ?
+        count : BENCH_PER_RECORD_MAX]++;
+
+    return 0;
+}
+
+static void bench_print(const struct bench_stats* stats)
+{
+    unsigned long long* lat = stats->latencies_ns;
+    size_t n = stats->latency_count;
+    unsigned long long sum = 0;
+    size_t i;
+
+    qsort(lat, n, sizeof(unsigned long long), bench_cmp_ull);
+    for(i = 0; i < n; i++)
+        sum += lat[i];
+
+    printf("{ \"records\": %zu, \"bytes\": %zu, \"duration_us\": %llu, "
+            "\"events\": { \"total\": %zu, \"keys\": %zu, \"esc_keys\": %zu, "
+            "\"mouse\": %zu, \"other\": %zu }, \"events_per_record\": { ",
+            stats->records, stats->bytes, stats->duration_us, n,
+            stats->keys, stats->esc_keys, stats->mouse, stats->other);
+    for(i = 0; i <= BENCH_PER_RECORD_MAX; i++)
+    {
+        printf("\"%zu%s\": %zu%s", i, (i == BENCH_PER_RECORD_MAX) ? "+" : "",
+                stats->per_record[i], (i < BENCH_PER_RECORD_MAX) ? ", " : "");
+    }
+    printf(" }, \"latency_ns\": { \"mean\": %.1f, \"p50\": %llu, "
+            "\"p90\": %llu, \"p99\": %llu, \"max\": %llu } }\n",
+            (n > 0) ? ((double)sum / n) : 0.0,
+            (n > 0) ? lat[n / 2] : 0,
+            (n > 0) ? lat[(n * 9) / 10] : 0,
+            (n > 0) ? lat[(n * 99) / 100] : 0,
+            (n > 0) ? lat[n - 1] : 0);
+}
+
+static int bench_replay(const char* path, const char* term,
+        const char* colorterm)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    char magic[NT_INPUT_RECORD_MAGIC_LEN];
+    if((fread(magic, 1, sizeof(magic), file) != sizeof(magic)) ||
+       (memcmp(magic, NT_INPUT_RECORD_MAGIC, sizeof(magic)) != 0))
+    {
+        fprintf(stderr, "%s: not an input recording\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    int in_pipe[2];
+    if(pipe(in_pipe) != 0)
+    {
+        perror("pipe");
+        fclose(file);
+        return 1;
+    }
+
+    struct nt_ctx* ctx;
+    int status = nt_ctx_new(in_pipe[0], -1, term, colorterm, &ctx);
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_ctx_new() failed: %d\n", status);
+        fclose(file);
+        return 1;
+    }
+    nt_ctx_clock_set_virtual(ctx, true);
+    unsigned long long base_us = nt_ctx_clock_get_us(ctx);
+
+    struct bench_stats stats = {0};
+    struct nt_input_record record;
+    char data[4096];
+    unsigned long long now_us;
+    int rv = 0;
+
+    while(fread(&record, sizeof(record), 1, file) == 1)
+    {
+        if((record.len > sizeof(data)) ||
+           (fread(data, 1, record.len, file) != record.len))
+        {
+            fprintf(stderr, "%s: truncated or corrupt record\n", path);
+            rv = 1;
+            break;
+        }
+
+        /* Waits may have moved the clock past the record already. */
+        now_us = nt_ctx_clock_get_us(ctx);
+        if((base_us + record.time_us) > now_us)
+            nt_ctx_clock_advance(ctx, (base_us + record.time_us) - now_us);
+
+        if(write(in_pipe[1], data, record.len) != (ssize_t)record.len)
+        {
+            perror("write");
+            rv = 1;
+            break;
+        }
+
+        if(bench_drain(ctx, &stats) != 0)
+        {
+            fprintf(stderr, "nt_ctx_event_wait() failed\n");
+            rv = 1;
+            break;
+        }
+
+        stats.records++;
+        stats.bytes += record.len;
+        stats.duration_us = record.time_us;
+    }
+
+    if(rv == 0)
+        bench_print(&stats);
+
+    free(stats.latencies_ns);
+    nt_ctx_destroy(ctx);
+    close(in_pipe[0]);
+    close(in_pipe[1]);
+    fclose(file);
+
+    return rv;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char** argv)
+{
+    if((argc == 3) && (strcmp(argv[1], "record") == 0))
+        return bench_record(argv[2]);
+
+    if((argc < 2) || (argc > 4))
+    {
+        fprintf(stderr, "usage: %s record FILE\n"
+                "       %s FILE [TERM [COLORTERM]]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    return bench_replay(argv[1], (argc > 2) ? argv[2] : "xterm-256color",
+            (argc > 3) ? argv[3] : "truecolor");
+}
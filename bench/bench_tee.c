@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* Measures what output recording adds to frame latency, see
+ * nt_output_record_start().
+ *
+ * bench_tee [TERM [COLORTERM]]
+ *     Presents a 160 x 48 grid with random changes every millisecond and
+ *     flushes it to /dev/null, without recording and recording to a
+ *     temporary file in each format. The time of each present and flush is
+ *     taken, with rounds alternating between the modes. The writer thread
+ *     runs while the output path sleeps, as it would between frames. The
+ *     binary recording is then replayed into an nt_vt model and checked
+ *     against the grid. Results are printed to stderr.
+ *
+ * bench_tee play FILE
+ *     Writes a binary recording to stdout with its original timing. */
+
+#include "nt.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_WIDTH 160
+#define BENCH_HEIGHT 48
+#define BENCH_FRAMES 1000
+#define BENCH_CHANGES 32
+#define BENCH_ROUNDS 3
+#define BENCH_MODES 3
+#define BENCH_FRAME_GAP_NS 1000000L
+
+static const char* const bench_mode_names[BENCH_MODES] = {
+    "off", "asciicast", "binary"
+};
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static int bench_cmp_ull(const void* a, const void* b)
+{
+    unsigned long long ull_a = *(const unsigned long long*)a;
+    unsigned long long ull_b = *(const unsigned long long*)b;
+    return (ull_a > ull_b) - (ull_a < ull_b);
+}
+
+/* Returns the number of cells whose text differs between `grid` and `vt`. */
+static size_t bench_mismatches(const struct nt_grid* grid,
+        const struct nt_vt* vt)
+{
+    struct nt_cell cell;
+    struct nt_vt_cell vt_cell;
+    size_t count = 0;
+    size_t x, y;
+
+    for(y = 0; y < BENCH_HEIGHT; y++)
+    {
+        for(x = 0; x < BENCH_WIDTH; x++)
+        {
+            nt_grid_get(grid, x, y, &cell);
+            nt_vt_get_cell(vt, x, y, &vt_cell);
+            if((vt_cell.len != 1) || ((uint32_t)vt_cell.text[0] != cell.cp))
+                count++;
+        }
+    }
+
+    return count;
+}
+
+/* Calls `fn` with the bytes of each record of the binary recording in
+ * `file`, after waiting for its time if `timed` is set. Returns the number of
+ * dropped bytes, or -1 if `file` isn't a valid recording. */
+static long long bench_read_records(FILE* file, bool timed,
+        void (*fn)(const char* data, size_t len, void* fn_data), void* fn_data)
+{
+    char magic[NT_OUTPUT_RECORD_MAGIC_LEN];
+    if((fread(magic, 1, sizeof(magic), file) != sizeof(magic)) ||
+       (memcmp(magic, NT_OUTPUT_RECORD_MAGIC, sizeof(magic)) != 0))
+        return -1;
+
+    struct nt_output_record record;
+    long long dropped = 0;
+    char* data = NULL;
+    size_t cap = 0;
+    unsigned long long start_ns = bench_now_ns();
+    unsigned long long due_ns, now_ns;
+
+    while(fread(&record, sizeof(record), 1, file) == 1)
+    {
+        if(record.len > cap)
+        {
+            char* new_data = realloc(data, record.len);
+            if(new_data == NULL)
+                break;
+            data = new_data;
+            cap = record.len;
+        }
+        if(fread(data, 1, record.len, file) != record.len)
+        {
+            free(data);
+            return -1;
+        }
+
+        if(timed)
+        {
+            due_ns = start_ns + (record.time_us * 1000ULL);
+            now_ns = bench_now_ns();
+            if(due_ns > now_ns)
+            {
+                struct timespec wait = {
+                    .tv_sec = (time_t)((due_ns - now_ns) / 1000000000ULL),
+                    .tv_nsec = (long)((due_ns - now_ns) % 1000000000ULL)
+                };
+                nanosleep(&wait, NULL);
+            }
+        }
+
+        dropped += record.dropped;
+        fn(data, record.len, fn_data);
+    }
+
+    free(data);
+
+    return dropped;
+}
+
+/* -------------------------------------------------------------------------- */
+/* PLAY */
+/* -------------------------------------------------------------------------- */
+
+static void bench_play_fn(const char* data, size_t len, void* fn_data)
+{
+    (void)fn_data;
+
+    fwrite(data, 1, len, stdout);
+    fflush(stdout);
+}
+
+static int bench_play(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    long long dropped = bench_read_records(file, true, bench_play_fn, NULL);
+    fclose(file);
+
+    if(dropped < 0)
+    {
+        fprintf(stderr, "%s: not a binary output recording\n", path);
+        return 1;
+    }
+    if(dropped > 0)
+        fprintf(stderr, "%lld bytes were dropped while recording\n", dropped);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* BENCHMARK */
+/* -------------------------------------------------------------------------- */
+
+static void bench_vt_fn(const char* data, size_t len, void* fn_data)
+{
+    nt_vt_feed(fn_data, data, len);
+}
+
+/* Presents BENCH_FRAMES frames, recording in `mode` to `fd`, and stores the
+ * time each took in `out_frame_ns`. The first frame is drawn in full on a new
+ * `screen`. */
+static void bench_round(struct nt_ctx* ctx, struct nt_grid* grid,
+        const nt_gfx_id* ids, int mode, int fd,
+        unsigned long long* out_frame_ns)
+{
+    struct timespec gap = { .tv_sec = 0, .tv_nsec = BENCH_FRAME_GAP_NS };
+    unsigned long long start_ns;
+
+    struct nt_grid* screen;
+    if(nt_grid_new(0, 0, &screen) != 0)
+        exit(1);
+
+    if(mode > 0)
+    {
+        enum nt_output_record_fmt fmt = (mode == 1) ?
+            NT_OUTPUT_RECORD_ASCIICAST : NT_OUTPUT_RECORD_BINARY;
+        if((ftruncate(fd, 0) != 0) || (lseek(fd, 0, SEEK_SET) != 0) ||
+           (nt_ctx_output_record_start(ctx, fd, fmt, 0) != 0))
+        {
+            fprintf(stderr, "nt_ctx_output_record_start(%s) failed\n",
+                    bench_mode_names[mode]);
+            exit(1);
+        }
+    }
+
+    size_t i, j;
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        for(j = 0; j < BENCH_CHANGES; j++)
+        {
+            nt_grid_set(grid, rand() % BENCH_WIDTH, rand() % BENCH_HEIGHT,
+                    (struct nt_cell) {
+                        .cp = 'a' + (rand() % 26), .gfx = ids[rand() % 16] });
+        }
+
+        start_ns = bench_now_ns();
+        nt_ctx_grid_present(ctx, screen, grid);
+        nt_ctx_buffer_flush(ctx);
+        out_frame_ns[i] = bench_now_ns() - start_ns;
+
+        nanosleep(&gap, NULL);
+    }
+
+    if(mode > 0)
+        nt_ctx_output_record_stop(ctx);
+
+    nt_grid_destroy(screen);
+}
+
+static int bench_run(const char* term, const char* colorterm)
+{
+    int null_fd = open("/dev/null", O_WRONLY);
+    char path[] = "/tmp/bench_tee_XXXXXX";
+    int fd = mkstemp(path);
+    if((null_fd < 0) || (fd < 0))
+    {
+        perror("open");
+        return 1;
+    }
+    unlink(path);
+
+    struct nt_ctx* ctx;
+    int status = nt_ctx_new(-1, null_fd, term, colorterm, &ctx);
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_ctx_new() failed: %d\n", status);
+        return 1;
+    }
+
+    static char buff[1 << 18];
+    nt_ctx_buffer_enable(ctx, buff, sizeof(buff));
+
+    struct nt_grid* grid;
+    if(nt_grid_new(BENCH_WIDTH, BENCH_HEIGHT, &grid) != 0)
+    {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    nt_gfx_id ids[16];
+    size_t i;
+    for(i = 0; i < 16; i++)
+    {
+        struct nt_gfx gfx = NT_GFX_DEFAULT;
+        gfx.fg = nt_color_new_auto(i * 16, 255 - (i * 16), 128);
+        nt_gfx_intern(gfx, &ids[i]);
+    }
+    nt_grid_clear(grid, ids[0]);
+
+    static unsigned long long frame_ns[BENCH_MODES][BENCH_ROUNDS * BENCH_FRAMES];
+    const size_t frame_count = BENCH_ROUNDS * BENCH_FRAMES;
+    unsigned long long sum_ns[BENCH_MODES] = {0};
+    off_t sizes[BENCH_MODES] = {0};
+    int round, mode;
+
+    srand(1);
+    for(round = 0; round < BENCH_ROUNDS; round++)
+    {
+        for(mode = 0; mode < BENCH_MODES; mode++)
+        {
+            bench_round(ctx, grid, ids, mode, fd,
+                    &frame_ns[mode][round * BENCH_FRAMES]);
+            sizes[mode] = lseek(fd, 0, SEEK_END);
+        }
+    }
+
+    for(mode = 0; mode < BENCH_MODES; mode++)
+    {
+        for(i = 0; i < frame_count; i++)
+            sum_ns[mode] += frame_ns[mode][i];
+        qsort(frame_ns[mode], frame_count, sizeof(unsigned long long),
+                bench_cmp_ull);
+
+        fprintf(stderr, "%s %s, recording %s: mean %.2f us (%+.2f%%), "
+                "p50 %.2f us, p99 %.2f us",
+                term, colorterm, bench_mode_names[mode],
+                (sum_ns[mode] / 1000.0) / frame_count,
+                ((double)sum_ns[mode] / sum_ns[0] - 1.0) * 100.0,
+                frame_ns[mode][frame_count / 2] / 1000.0,
+                frame_ns[mode][(frame_count * 99) / 100] / 1000.0);
+        if(mode > 0)
+        {
+            fprintf(stderr, ", %.1f KiB/frame",
+                    (sizes[mode] / 1024.0) / BENCH_FRAMES);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    /* The last round recorded in binary, replaying it must give the grid. */
+    struct nt_vt* vt;
+    if(nt_vt_new(BENCH_WIDTH, BENCH_HEIGHT, &vt) != 0)
+    {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    lseek(fd, 0, SEEK_SET);
+    FILE* file = fdopen(fd, "rb");
+    long long dropped = bench_read_records(file, false, bench_vt_fn, vt);
+    fprintf(stderr, "binary replay: %lld bytes dropped, %zu mismatched cells\n",
+            dropped, bench_mismatches(grid, vt));
+    fclose(file);
+
+    nt_vt_destroy(vt);
+    nt_ctx_destroy(ctx);
+    nt_grid_destroy(grid);
+    close(null_fd);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char** argv)
+{
+    if((argc == 3) && (strcmp(argv[1], "play") == 0))
+        return bench_play(argv[2]);
+
+    return bench_run((argc > 1) ? argv[1] : "xterm-256color",
+            (argc > 2) ? argv[2] : "truecolor");
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* Measures how many bytes nt_ctx_grid_present() emits per visible change. A
+ * 256 x 64 grid is animated by changing a few cells in random places each
+ * frame, some to double-width characters, and the output is fed to an nt_vt
+ * model, which counts the cells that actually changed on screen. The model
+ * is then checked against the grid, including the halves of double-width
+ * characters that were partly overwritten. The optional arguments are the TERM and COLORTERM values to encode
+ * for, by default xterm-256color and truecolor. Results are printed to
+ * stderr. */
+
+#include "nt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_WIDTH 256
+#define BENCH_HEIGHT 64
+#define BENCH_FRAMES 2000
+#define BENCH_CHANGES 64
+#define BENCH_WIDE_EVERY 8 // every 8th change is a double-width character
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/* Stores the UTF-8 encoding of `cp`, below U+10000, in `out`. Returns its
+ * length. */
+static size_t bench_utf8(uint32_t cp, char* out)
+{
+    if(cp < 0x80)
+    {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if(cp < 0x800)
+    {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+}
+
+/* Returns the number of cells whose text or width differs between `grid` and
+ * `vt`. */
+static size_t bench_mismatches(const struct nt_grid* grid,
+        const struct nt_vt* vt)
+{
+    const uint16_t width_flags = NT_CELL_WIDE | NT_CELL_CONT;
+    struct nt_cell cell;
+    struct nt_vt_cell vt_cell;
+    char utf8[3];
+    size_t count = 0;
+    size_t x, y, len;
+
+    for(y = 0; y < BENCH_HEIGHT; y++)
+    {
+        for(x = 0; x < BENCH_WIDTH; x++)
+        {
+            nt_grid_get(grid, x, y, &cell);
+            nt_vt_get_cell(vt, x, y, &vt_cell);
+            if((cell.flags & width_flags) != (vt_cell.flags & width_flags))
+            {
+                count++;
+                continue;
+            }
+            if(cell.flags & NT_CELL_CONT)
+                continue;
+
+            len = bench_utf8(cell.cp, utf8);
+            if((vt_cell.len != len) || (memcmp(vt_cell.text, utf8, len) != 0))
+                count++;
+        }
+    }
+
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    const char* term = (argc > 1) ? argv[1] : "xterm-256color";
+    const char* colorterm = (argc > 2) ? argv[2] : "truecolor";
+
+    struct nt_ctx* ctx;
+    int status = nt_ctx_new(-1, -1, term, colorterm, &ctx);
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_ctx_new() failed: %d\n", status);
+        return 1;
+    }
+
+    struct nt_vt* vt;
+    struct nt_grid* screen;
+    struct nt_grid* grid;
+    if((nt_vt_new(BENCH_WIDTH, BENCH_HEIGHT, &vt) != 0) ||
+       (nt_grid_new(0, 0, &screen) != 0) ||
+       (nt_grid_new(BENCH_WIDTH, BENCH_HEIGHT, &grid) != 0))
+    {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+
+    nt_ctx_output_set_sink(ctx, nt_vt_sink_write, vt);
+
+    nt_gfx_id ids[16];
+    size_t i, j;
+    for(i = 0; i < 16; i++)
+    {
+        struct nt_gfx gfx = NT_GFX_DEFAULT;
+        gfx.fg = nt_color_new_auto(i * 16, 255 - (i * 16), 128);
+        nt_gfx_intern(gfx, &ids[i]);
+    }
+
+    nt_grid_clear(grid, ids[0]);
+    nt_ctx_grid_present(ctx, screen, grid);
+    nt_vt_reset_stats(vt);
+
+    srand(1);
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_FRAMES; i++)
+    {
+        for(j = 0; j < BENCH_CHANGES; j++)
+        {
+            if((j % BENCH_WIDE_EVERY) == 0)
+            {
+                nt_grid_set(grid, rand() % (BENCH_WIDTH - 1),
+                        rand() % BENCH_HEIGHT, (struct nt_cell) {
+                            .cp = 0x4E00 + (rand() % 256),
+                            .gfx = ids[rand() % 16], .flags = NT_CELL_WIDE });
+                continue;
+            }
+
+            nt_grid_set(grid, rand() % BENCH_WIDTH, rand() % BENCH_HEIGHT,
+                    (struct nt_cell) {
+                        .cp = 'a' + (rand() % 26), .gfx = ids[rand() % 16] });
+        }
+
+        status = nt_ctx_grid_present(ctx, screen, grid);
+        if(status != 0)
+        {
+            fprintf(stderr, "nt_ctx_grid_present() failed: %d\n", status);
+            return 1;
+        }
+    }
+    unsigned long long total_ns = bench_now_ns() - start_ns;
+
+    struct nt_vt_stats stats;
+    nt_vt_get_stats(vt, &stats);
+
+    fprintf(stderr, "%s %s: %d frames, %llu bytes, %llu changes, "
+            "%.2f bytes/change, %.1f us/frame, %zu mismatched cells\n",
+            term, colorterm, BENCH_FRAMES, stats.bytes, stats.changes,
+            (stats.changes > 0) ? ((double)stats.bytes / stats.changes) : 0.0,
+            (total_ns / 1000.0) / BENCH_FRAMES, bench_mismatches(grid, vt));
+
+    nt_ctx_destroy(ctx);
+    nt_vt_destroy(vt);
+    nt_grid_destroy(grid);
+    nt_grid_destroy(screen);
+
+    return 0;
+}
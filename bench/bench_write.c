@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+
+/* Measures nt_write_str() and nt_write_str_id() throughput. Output goes to
+ * stdout, so redirect it to /dev/null to measure encoding alone. stdin must be
+ * a terminal. Results are printed to stderr. */
+
+#include "nt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 2000000
+#define BENCH_BUFF_CAP 65536
+
+static unsigned long long bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((unsigned long long)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+static void bench_report(const char* name, unsigned long long total_ns)
+{
+    fprintf(stderr, "%s: %d calls, %.1f ns/call, %.2f Mcalls/s\n",
+            name, BENCH_ITERATIONS, (double)total_ns / BENCH_ITERATIONS,
+            (BENCH_ITERATIONS * 1000.0) / total_ns);
+}
+
+int main(void)
+{
+    int status = nt_init();
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        fprintf(stderr, "nt_init() failed: %d\n", status);
+        return 1;
+    }
+
+    static char buff[BENCH_BUFF_CAP];
+    nt_buffer_enable(buff, sizeof(buff));
+
+    struct nt_gfx gfxs[64];
+    size_t i;
+    for(i = 0; i < 64; i++)
+    {
+        gfxs[i] = NT_GFX_DEFAULT;
+        gfxs[i].fg = nt_color_new_auto(i * 4, 255 - (i * 4), 128);
+        gfxs[i].bg = nt_color_new_auto(255 - (i * 4), 64, i * 4);
+        gfxs[i].style = nt_style_new_uniform(i & NT_STYLE_BOLD);
+    }
+
+    const char* str = "cell";
+    unsigned long long start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+        nt_write_str(str, 4, gfxs[i % 64]);
+    nt_buffer_flush();
+    unsigned long long total_ns = bench_now_ns() - start_ns;
+
+    nt_gfx_id ids[64];
+    for(i = 0; i < 64; i++)
+        nt_gfx_intern(gfxs[i], &ids[i]);
+
+    start_ns = bench_now_ns();
+    for(i = 0; i < BENCH_ITERATIONS; i++)
+        nt_write_str_id(str, 4, ids[i % 64]);
+    nt_buffer_flush();
+    unsigned long long total_id_ns = bench_now_ns() - start_ns;
+
+    nt_buffer_disable(NT_BUFF_DISCARD, NULL);
+    nt_deinit();
+
+    bench_report("nt_write_str", total_ns);
+    bench_report("nt_write_str_id", total_id_ns);
+
+    return 0;
+}
@@ -101,6 +101,45 @@ void loop_lib()
     if(ENABLE_PRINT) printf("Done\n\r");
 }
 
+void on_key(const struct nt_event* event, void* data)
+{
+    struct nt_key key;
+    NT_EVENT_FILL_DATA((*event), &key);
+
+    if(nt_key_utf32_match(key, 'q'))
+        nt_loop_stop();
+    else
+        (*(size_t*)data)++;
+}
+
+void on_idle(void* data)
+{
+    if(ENABLE_PRINT) printf("I | ");
+    fflush(stdout);
+}
+
+void on_frame(void* data)
+{
+    if(ENABLE_PRINT) printf("F(%zu) | ", *(size_t*)data);
+    fflush(stdout);
+}
+
+void loop_callbacks()
+{
+    size_t key_count = 0;
+    struct nt_loop loop = {
+        .idle = { on_idle },
+        .idle_timeout = 1000,
+        .frame = on_frame,
+        .data = &key_count
+    };
+    nt_loop_set_handler(&loop, NT_EVENT_KEY, on_key);
+
+    nt_loop_run(&loop);
+
+    if(ENABLE_PRINT) printf("Done\n\r");
+}
+
 void loop_lib_byte()
 {
     char c;
@@ -141,6 +180,14 @@ int main(int argc, char *argv[])
     _status = nt_init();
     assert((_status == 0) || (_status == NT_ERR_TERM_NOT_SUPP));
 
+    // ./demo loop - nt_loop_run() with key, idle and frame callbacks
+    if((argc > 1) && (strcmp(argv[1], "loop") == 0))
+    {
+        loop_callbacks();
+        nt_deinit();
+        return 0;
+    }
+
     // pthread_t test_threads[1];
     // long int i;
     // for(i = 0; i < 1; i++)
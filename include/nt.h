@@ -8,6 +8,8 @@
 #include "nt_shared.h"
 #include "nt_event.h"
 #include "nt_gfx.h"
+#include "nt_grid.h"
+#include "nt_vt.h"
 #include "nt_error.h"
 
 /* ========================================================================== */
@@ -28,10 +30,72 @@ NT_API int nt_init(void);
 /* ------------------------------------------------------ */
 
 /* Deinitializes the library and restores terminal state. Buffered output is
- * discarded without being flushed. */
+ * discarded without being flushed. Pooled payloads of events still queued are
+ * released and the payload pool's free blocks are freed. Threads started by
+ * nt_grid_set_present_threads() are stopped. */
 
 NT_API void nt_deinit(void);
 
+/* ========================================================================== */
+/* CONTEXT */
+/* ========================================================================== */
+
+/* A context is one terminal session: its input and output descriptors,
+ * terminal description, output buffer, frame pacing and event queue. The
+ * functions of this header act on the default context, set up by nt_init()
+ * on stdin and stdout. Each has an nt_ctx_* variant, listed at the end of
+ * this header, that acts on the context passed as its first argument, or on
+ * the default context if that is NULL. This lets one process drive several
+ * terminals, such as ptys of remote clients.
+ *
+ * Separate contexts may be used from separate threads at once. The payload
+ * pool, the gfx intern table and the nt_grid_present() thread count are shared
+ * by all contexts. Signals and SIGWINCH are only delivered to the default
+ * context; resizes of other contexts are reported with nt_ctx_set_term_size().
+ * Writes to a closed pty raise SIGPIPE, which the caller should block or
+ * ignore when nt_init() is not used. */
+
+/* Creates a context that reads input from `in_fd` and writes output to
+ * `out_fd`, for the terminal described by `term` and `colorterm`, as the TERM
+ * and COLORTERM environment variables would. `colorterm` may be NULL. If
+ * `in_fd` is a terminal, it is put into raw mode until the context is
+ * destroyed. The descriptors are not closed by nt_ctx_destroy().
+ *
+ * `in_fd` may be -1 for a context without input, and `out_fd` may be -1 for
+ * a context that only writes to a sink, see nt_output_set_sink().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_ctx` is NULL, or `in_fd` or `out_fd` is below
+ * -1.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed.
+ * 3) NT_ERR_INIT_PIPE - Failed to create an internal pipe.
+ * 4) NT_ERR_INIT_TERM_ENV - `term` is NULL.
+ * 5) NT_ERR_TERM_NOT_SUPP - The terminal was not recognized. The context is
+ * created and assumes xterm compatibility.
+ * 6) NT_ERR_UNEXPECTED - Terminal setup failed. */
+
+NT_API int nt_ctx_new(int in_fd, int out_fd, const char* term,
+                      const char* colorterm, struct nt_ctx** out_ctx);
+
+/* Destroys `ctx` like nt_deinit() does for the default context, but leaves
+ * the shared payload pool and present threads alone. Does nothing if `ctx`
+ * is NULL or the default context. */
+
+NT_API void nt_ctx_destroy(struct nt_ctx* ctx);
+
+/* ------------------------------------------------------ */
+
+/* Sets the size reported by nt_ctx_get_term_size() for `ctx` and queues a
+ * resize event. Used for terminals whose size isn't known to `in_fd`, such as
+ * remote clients reporting a window change.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_UNEXPECTED - Queueing the resize event failed. The size is still
+ * set. */
+
+NT_API int nt_ctx_set_term_size(struct nt_ctx* ctx,
+                                size_t width, size_t height);
+
 /* ========================================================================== */
 /* TERMINAL FUNCTIONS */
 /* ========================================================================== */
@@ -70,13 +134,153 @@ NT_API int nt_buffer_disable(enum nt_buffact buffact, char** out_buff);
 /* ------------------------------------------------------ */
 
 /* Flushes pending buffered output. Attempted contents are discarded even if
- * writing fails.
+ * writing fails. Also marks the end of a frame for the frame budget, so it
+ * should be called once per frame even when buffering is disabled.
  *
  * ERROR CODES:
  * 1) NT_ERR_UNEXPECTED - Writing to stdout failed. */
 
 NT_API int nt_buffer_flush(void);
 
+/* ------------------------------------------------------ */
+/* OUTPUT SINKS */
+/* ------------------------------------------------------ */
+
+/* Receives `len` bytes of encoded output, valid only during the call.
+ * `sink_data` is the pointer the sink was set with. Returns 0 on success. Any
+ * other value fails the output call that produced the bytes with
+ * NT_ERR_UNEXPECTED. */
+typedef int (*nt_output_sink)(const char* data, size_t len, void* sink_data);
+
+/* Sends output to `sink` instead of stdout, so no system calls are made for
+ * it. Buffering still applies: while enabled, `sink` receives each flushed
+ * buffer in one call. A NULL `sink` restores writing to stdout. Buffered
+ * output is not flushed first. */
+
+NT_API void nt_output_set_sink(nt_output_sink sink, void* sink_data);
+
+/* ------------------------------------------------------ */
+
+/* Memory sink. Output is appended to `buff` until `cap` bytes are used. */
+struct nt_mem_sink
+{
+    char* buff;
+    size_t cap;
+    size_t len;
+
+    /* Set once a write did not fit. Such writes append nothing. */
+    bool overflow;
+};
+
+/* An nt_output_sink appending to the struct nt_mem_sink passed as
+ * `sink_data`. */
+
+NT_API int nt_mem_sink_write(const char* data, size_t len, void* sink_data);
+
+/* ------------------------------------------------------ */
+
+typedef int (*nt_render_fn)(void* data);
+
+/* Calls `render` with `data`, sending everything it writes into `buff`
+ * instead of stdout, and stores the number of bytes written in `out_len` when
+ * provided. The output buffer and sink are set aside during the call and
+ * restored after it, so `render` must not change them. The frame budget only
+ * counts the bytes written by `render`. Returns the status of `render` unless
+ * the output did not fit.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `render` is NULL, or `buff` is NULL while `cap` is
+ * not 0.
+ * 2) NT_ERR_OUT_OF_BOUNDS - The output did not fit in `cap` bytes. `buff`
+ * holds the writes that fit, `out_len` their size.
+ * 3) Errors returned by `render`. */
+
+NT_API int nt_render_to(nt_render_fn render, void* data,
+                        char* buff, size_t cap, size_t* out_len);
+
+/* ------------------------------------------------------ */
+/* OUTPUT RECORDING */
+/* ------------------------------------------------------ */
+
+enum nt_output_record_fmt
+{
+    /* asciicast v2, playable with asciinema. Output is stored as "o" events.
+     * Dropped output is noted with "m" marker events. */
+    NT_OUTPUT_RECORD_ASCIICAST,
+
+    /* NT_OUTPUT_RECORD_MAGIC_LEN bytes of NT_OUTPUT_RECORD_MAGIC, followed by
+     * records. Each record is a struct nt_output_record, in native byte
+     * order, followed by `len` bytes of output. */
+    NT_OUTPUT_RECORD_BINARY
+};
+
+#define NT_OUTPUT_RECORD_MAGIC "NTOUTPT1"
+#define NT_OUTPUT_RECORD_MAGIC_LEN 8
+
+struct nt_output_record
+{
+    uint64_t time_us; // since the recording started, see nt_clock_get_us()
+    uint32_t len;
+
+    /* Bytes of output lost before this record, because the recording fell
+     * behind. */
+    uint32_t dropped;
+};
+
+/* Starts recording all output written to the terminal or sink to `fd`, in
+ * format `fmt`. Written output is copied to a ring of `ring_cap` bytes, 0 for
+ * 1 MiB, and a background thread writes it to `fd`, so the output path never
+ * waits for `fd`. Output that doesn't fit in the ring is dropped and noted in
+ * the recording. Output of nt_render_to() isn't recorded. `fd` is never
+ * closed. Starting again stops the current recording first.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `fd` is negative, `fmt` is invalid or `ring_cap` is
+ * too large.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed.
+ * 3) NT_ERR_UNEXPECTED - Writing the header failed, or the thread could not
+ * be started. */
+
+NT_API int nt_output_record_start(int fd, enum nt_output_record_fmt fmt,
+                                  size_t ring_cap);
+
+/* Writes out the rest of the recording and stops it. */
+
+NT_API void nt_output_record_stop(void);
+
+/* ------------------------------------------------------ */
+/* OUTPUT BACKPRESSURE */
+/* ------------------------------------------------------ */
+
+#define NT_OUTPUT_CONGESTION_LIMIT_DEFAULT 4096
+
+struct nt_output_state
+{
+    /* Bytes written to the terminal but not yet transmitted, as of the last
+     * flush or congestion check. Always 0 where this can't be queried.
+     * Pseudo-terminals hand output to the master side right away, so there a
+     * slow reader mostly shows up as longer flushes instead. */
+    size_t queued;
+
+    unsigned int flush_us; // duration of the last flush
+    unsigned int flush_avg_us; // moving average of flush durations
+
+    /* `queued` exceeds the congestion limit. While set, NT_EVENT_FRAME is held
+     * back and redraw requests keep being coalesced, so only the latest state
+     * is drawn once the terminal catches up. */
+    bool congested;
+};
+
+/* Stores the current output state in `out_state`. Thread-safe. */
+
+NT_API void nt_output_get_state(struct nt_output_state* out_state);
+
+/* Sets the number of queued output bytes above which output is considered
+ * congested. 0 disables congestion detection. The default is
+ * NT_OUTPUT_CONGESTION_LIMIT_DEFAULT. Thread-safe. */
+
+NT_API void nt_output_set_congestion_limit(size_t limit);
+
 /* ------------------------------------------------------ */
 /* WRITE */
 /* ------------------------------------------------------ */
@@ -102,6 +306,71 @@ nt_write_str(const char* str, size_t len, struct nt_gfx gfx);
 NT_API int
 nt_write_str_unsafe(const char* str, struct nt_gfx gfx);
 
+/* ------------------------------------------------------ */
+/* GFX INTERNING */
+/* ------------------------------------------------------ */
+
+/* Stores in `out_id` the id of `gfx`, interning it on first use. Equal gfx
+ * values always get the same id, so ids can be compared directly. Ids stay
+ * valid for the lifetime of the process, also across nt_deinit() and
+ * nt_init(). NT_GFX_DEFAULT has id NT_GFX_ID_DEFAULT. Thread-safe.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_id` is NULL.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed.
+ * 3) NT_ERR_OUT_OF_BOUNDS - All 65535 ids are in use. */
+
+NT_API int nt_gfx_intern(struct nt_gfx gfx, nt_gfx_id* out_id);
+
+/* ------------------------------------------------------ */
+
+/* Stores the gfx interned as `id` in `out_gfx`. Thread-safe.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_gfx` is NULL.
+ * 2) NT_ERR_OUT_OF_BOUNDS - `id` wasn't returned by nt_gfx_intern(). */
+
+NT_API int nt_gfx_get(nt_gfx_id id, struct nt_gfx* out_gfx);
+
+/* ------------------------------------------------------ */
+
+/* Like nt_write_str(), but uses the gfx interned as `id`. The sequences
+ * setting the gfx are rendered on first use and copied afterwards. They are
+ * rendered again after the terminal or the color encoding changes.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_OUT_OF_BOUNDS - `id` wasn't returned by nt_gfx_intern().
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed.
+ * 3) NT_ERR_FUNC_NOT_SUPP - A required terminal function is unsupported.
+ * 4) NT_ERR_UNEXPECTED - Output could not be completed. */
+
+NT_API int nt_write_str_id(const char* str, size_t len, nt_gfx_id id);
+
+/* ------------------------------------------------------ */
+
+enum nt_color_enc
+{
+    /* Colors are always sent in the terminal's color mode. */
+    NT_COLOR_ENC_DEFAULT,
+
+    /* Colors are sent with the shortest sequence that reproduces them
+     * exactly. In truecolor mode, an RGB value that equals one of the
+     * standard 256-color palette entries [16, 255] is sent as that entry.
+     * Entries [0, 16) are theme-dependent and are never substituted. */
+    NT_COLOR_ENC_SHORTEST
+};
+
+/* Selects how colors are encoded. The default is NT_COLOR_ENC_DEFAULT. */
+
+NT_API void nt_output_set_color_enc(enum nt_color_enc enc);
+
+/* Sets a per-frame output budget of `budget` bytes, where a frame is
+ * everything written since the last flush. Once a frame exceeds the budget,
+ * the rest of it is drawn with at most 256 colors, and past twice the budget
+ * with 8 colors. 0 disables the budget, which is the default. */
+
+NT_API void nt_output_set_frame_budget(size_t budget);
+
 /* ------------------------------------------------------ */
 
 /* The terminal-control functions below buffer output when buffering is enabled.
@@ -173,7 +442,24 @@ nt_event_wait(struct nt_event* out_event, unsigned int timeout,
 
 /* ------------------------------------------------------ */
 
-/* Removes all queued events.
+/* Like nt_event_wait(), but only delivers events whose type is in `mask`.
+ * Non-matching events are kept, in order, in an internal deferred list and are
+ * delivered by later waits whose mask matches them. Event sources that cannot
+ * produce a type in `mask` are not polled. A timeout event is delivered
+ * regardless of `mask`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `mask` is 0.
+ * 2) NT_ERR_ALLOC_FAIL - Failed to defer a non-matching event.
+ * 3) NT_ERR_UNEXPECTED - A hard event I/O failure occurred. */
+
+NT_API int
+nt_event_wait_mask(struct nt_event* out_event, uint32_t mask,
+                   unsigned int timeout, unsigned int* out_elapsed);
+
+/* ------------------------------------------------------ */
+
+/* Removes all queued events. Pooled payloads of removed events are released.
  *
  * ERROR CODES:
  * 1) NT_ERR_UNEXPECTED - A hard event I/O failure occurred. */
@@ -182,6 +468,33 @@ NT_API int nt_event_queue_drain(void);
 
 /* ------------------------------------------------------ */
 
+/* Stores in `out_fd` a file descriptor that is readable whenever an event is
+ * available, for use with an external event loop (epoll, poll, libuv...). Once
+ * it becomes readable, fetch events with nt_event_dispatch(). The descriptor is
+ * owned by the library and stays valid until nt_deinit().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_fd` is NULL.
+ * 2) NT_ERR_FUNC_NOT_SUPP - Not supported on this platform.
+ * 3) NT_ERR_UNEXPECTED - Failed to create the descriptor. */
+
+NT_API int nt_event_get_fd(int* out_fd);
+
+/* ------------------------------------------------------ */
+
+/* Stores up to `cap` available events in `out_events` without blocking.
+ * `out_count` receives the number of stored events, even if an error occurs.
+ * Never stores timeout events.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_events` or `out_count` is NULL.
+ * 2) NT_ERR_UNEXPECTED - A hard event I/O failure occurred. */
+
+NT_API int nt_event_dispatch(struct nt_event* out_events, size_t cap,
+                             size_t* out_count);
+
+/* ------------------------------------------------------ */
+
 /* Pushes `event` to the event queue and wakes a waiting thread. Thread-safe.
  *
  * ERROR CODES:
@@ -190,6 +503,389 @@ NT_API int nt_event_queue_drain(void);
 
 NT_API int nt_event_push(const struct nt_event* event);
 
+/* ------------------------------------------------------ */
+
+/* Pushes an event with `type` that carries `payload`, allocated with
+ * nt_event_payload_alloc(). Only the pointer passes through the queue. On
+ * success, ownership of `payload` transfers to the receiver, which must release
+ * it with nt_event_payload_release(). On failure, the caller keeps ownership.
+ * Thread-safe.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `payload` is NULL or `type` is invalid.
+ * 2) NT_ERR_UNEXPECTED - Writing the event to the queue failed. */
+
+NT_API int nt_event_push_payload(uint32_t type, void* payload);
+
+/* ------------------------------------------------------ */
+
+/* Pushes `event` under the coalescing `key`. If an event pushed with the same
+ * `key` has not been delivered yet, it is replaced in place: the new event
+ * takes over its position in the queue and no wakeup is issued. Otherwise, the
+ * event is queued like with nt_event_push(). A replaced event's pooled payload
+ * is released. Thread-safe.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `event` is NULL or invalid.
+ * 2) NT_ERR_ALLOC_FAIL - Failed to allocate space for a new key.
+ * 3) NT_ERR_UNEXPECTED - Writing the event to the queue failed. The event
+ * pending under `key` is discarded. */
+
+NT_API int nt_event_push_keyed(const struct nt_event* event, uint32_t key);
+
+/* ------------------------------------------------------ */
+/* FRAME PACING */
+/* ------------------------------------------------------ */
+
+#define NT_PRESENT_FPS_DEFAULT 60
+#define NT_PRESENT_FPS_MAX 1000
+
+/* Requests a redraw. Requests are coalesced: an NT_EVENT_FRAME event is
+ * delivered by nt_event_wait() once the next pacing deadline is reached, no
+ * matter how many requests were made until then. Without requests, no frame
+ * events are generated and waiting costs nothing. Thread-safe. */
+
+NT_API void nt_request_redraw(void);
+
+/* ------------------------------------------------------ */
+
+/* Sets the target frame rate to `fps` frames per second. The effective rate
+ * is lowered automatically while flushing output takes a large share of the
+ * frame interval or while output is congested, so frames are dropped rather
+ * than queued.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `fps` is 0 or greater than NT_PRESENT_FPS_MAX. */
+
+NT_API int nt_present_set_fps(unsigned int fps);
+
+/* ------------------------------------------------------ */
+
+/* Returns the number of milliseconds until a requested frame is due, 0 if it
+ * is due already, or NT_EVENT_WAIT_FOREVER if no redraw is requested. Meant for
+ * external loops that use nt_event_get_fd(). */
+
+NT_API unsigned int nt_present_get_timeout(void);
+
+/* ------------------------------------------------------ */
+/* VIRTUAL CLOCK */
+/* ------------------------------------------------------ */
+
+/* Replaces the monotonic clock used for event timeouts, frame pacing and
+ * input recording with a virtual clock starting at the current time, which
+ * only moves with nt_clock_advance() and with event waits. While it is set,
+ * nt_event_wait() never sleeps. If no event is ready, it advances the clock to
+ * the next frame deadline and delivers NT_EVENT_FRAME when that is within the
+ * timeout, and otherwise advances the clock by the timeout and delivers
+ * NT_EVENT_TIMEOUT. Waiting forever delivers NT_EVENT_TIMEOUT at once.
+ * Flushes take no time. This makes timing-dependent behavior reproducible,
+ * e.g. when replaying recorded input. Disabling returns to the monotonic
+ * clock. Not thread-safe. */
+
+NT_API void nt_clock_set_virtual(bool enable);
+
+/* Moves the virtual clock `us` microseconds forward. Does nothing while the
+ * clock is not virtual. */
+
+NT_API void nt_clock_advance(unsigned long long us);
+
+/* Returns the current time of the clock, virtual or monotonic, in
+ * microseconds. */
+
+NT_API unsigned long long nt_clock_get_us(void);
+
+/* ------------------------------------------------------ */
+/* INPUT RECORDING */
+/* ------------------------------------------------------ */
+
+/* A recording starts with the NT_INPUT_RECORD_MAGIC_LEN bytes of
+ * NT_INPUT_RECORD_MAGIC, followed by records. Each record is a struct
+ * nt_input_record, in native byte order, followed by `len` bytes of raw
+ * input. */
+#define NT_INPUT_RECORD_MAGIC "NTINPUT1"
+#define NT_INPUT_RECORD_MAGIC_LEN 8
+
+struct nt_input_record
+{
+    uint64_t time_us; // since the recording started, see nt_clock_get_us()
+    uint32_t len;
+    uint32_t reserved; // 0
+};
+
+/* Starts writing the raw input read from the terminal to `fd`. The bytes
+ * parsed into one event, or skipped as one unsupported sequence, form one
+ * record, timestamped when parsing began. Replaying the records with their
+ * timing reproduces the event stream. Recording stops by itself if writing to
+ * `fd` fails, and `fd` is never closed. Starting again restarts the recording
+ * on the new `fd`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `fd` is negative.
+ * 2) NT_ERR_UNEXPECTED - Writing NT_INPUT_RECORD_MAGIC failed. */
+
+NT_API int nt_input_record_start(int fd);
+
+NT_API void nt_input_record_stop(void);
+
+/* ------------------------------------------------------ */
+/* STATISTICS */
+/* ------------------------------------------------------ */
+
+enum nt_stats_bytes
+{
+    NT_STATS_BYTES_TEXT,
+    NT_STATS_BYTES_SGR, // gfx sequences
+    NT_STATS_BYTES_CURSOR, // cursor moves, showing and hiding the cursor
+    NT_STATS_BYTES_ERASE,
+    NT_STATS_BYTES_OTHER, // alt screen, mouse mode, ...
+    NT_STATS_BYTES_COUNT
+};
+
+#define NT_STATS_HIST_BUCKETS 16
+
+/* Bucket 0 counts durations below 1 microsecond, bucket `i` durations from
+ * 2^(i - 1) up to 2^i microseconds. The last bucket also counts all longer
+ * durations. */
+struct nt_stats_hist
+{
+    uint64_t counts[NT_STATS_HIST_BUCKETS];
+};
+
+struct nt_stats
+{
+    /* Bytes of output by what they encode, counted when encoded, so they
+     * include bytes still in the output buffer. A newline inside text is
+     * emitted with gfx resets around it and counts as SGR. */
+    uint64_t bytes[NT_STATS_BYTES_COUNT];
+
+    uint64_t bytes_written; // handed to the terminal or the sink
+    uint64_t writes; // write() and writev() calls on the terminal
+    /* Non-empty flushes, see nt_buffer_flush(), and buffered presents written
+     * out with the frame in one writev() because they didn't fit. */
+    uint64_t flushes;
+    uint64_t flushes_forced; // the buffer was written out because it was full
+    struct nt_stats_hist flush_us;
+
+    uint64_t reads; // read() calls on the terminal
+
+    /* Events returned by nt_event_wait() and the calls built on it, indexed
+     * by the bit position of their type. Includes NT_EVENT_TIMEOUT. */
+    uint64_t events[32];
+
+    /* Escape sequences that were not recognized. They are returned as
+     * NT_ESC_KEY_OTHER, unless they are mouse reports, which are skipped. */
+    uint64_t ignored_seqs;
+
+    /* Reads from the pipes waking nt_event_wait(): signals, resizes, pushed
+     * events and redraw requests. */
+    uint64_t wakeups;
+
+    /* Time from nt_event_push() to the event being returned, on the
+     * monotonic clock even while the context clock is virtual. */
+    struct nt_stats_hist queue_wait_us;
+};
+
+/* Stores the statistics gathered since nt_init() in `out_stats`. Counters
+ * are updated with relaxed atomic stores by the thread writing output or
+ * waiting for events, so this may be called from any thread. Each counter is
+ * read whole, but counters updated while this runs may be one step apart.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_stats` is NULL. */
+
+NT_API int nt_stats_get(struct nt_stats* out_stats);
+
+/* ------------------------------------------------------ */
+/* TRACING */
+/* ------------------------------------------------------ */
+
+/* Tracing is compiled in only when the library is built with NT_TRACE
+ * defined (make TRACE=1). It then records how long gfx rendering,
+ * nt_write_str(), buffer flushes, input parsing and the poll in
+ * nt_event_wait() take. Each thread records into its own ring, which keeps
+ * the last NT_TRACE_RING_CAP spans. Rings take about 24 bytes per span and
+ * aren't freed. The spans of an exited thread are kept until a thread that
+ * starts tracing later takes over its ring, so there are only as many rings
+ * as threads have traced at once. Without NT_TRACE the trace points compile
+ * to nothing and the functions below report NT_ERR_FUNC_NOT_SUPP. */
+
+#define NT_TRACE_RING_CAP 8192
+
+struct nt_trace_span
+{
+    const char* name; // static string, e.g. "buffer_flush"
+    uint64_t start_ns; // monotonic clock
+    uint64_t dur_ns;
+    uint32_t tid; // numbered from 1 in the order threads first traced
+};
+
+typedef void (*nt_trace_fn)(const struct nt_trace_span* span, void* data);
+
+/* Calls `fn` with `data` for each recorded span, thread by thread, oldest
+ * first within a thread. Threads may keep tracing while this runs; spans
+ * they overwrite in the meantime are skipped.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_FUNC_NOT_SUPP - The library was built without NT_TRACE.
+ * 2) NT_ERR_INVALID_ARG - `fn` is NULL.
+ * 3) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_trace_dump(nt_trace_fn fn, void* data);
+
+/* Writes the recorded spans to `fd` as a Chrome trace-event JSON document,
+ * which chrome://tracing and Perfetto open.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_FUNC_NOT_SUPP - The library was built without NT_TRACE.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed.
+ * 3) NT_ERR_UNEXPECTED - Writing to `fd` failed. */
+
+NT_API int nt_trace_write_json(int fd);
+
+/* Discards the spans recorded so far, including those that began before the
+ * call and end after it. */
+
+NT_API void nt_trace_clear(void);
+
+/* ------------------------------------------------------ */
+/* RUN LOOP */
+/* ------------------------------------------------------ */
+
+typedef void (*nt_loop_handler)(const struct nt_event* event, void* data);
+typedef void (*nt_loop_hook)(void* data);
+
+#define NT_LOOP_IDLE_MAX 8
+
+struct nt_loop
+{
+    /* Indexed by the bit position of the event type. NULL handlers skip the
+     * event. A handler that keeps a pooled payload must release it; payloads of
+     * unhandled events are released by the loop. */
+    nt_loop_handler handlers[32];
+
+    /* Called, in order, when no event arrives for `idle_timeout` ms. NULL
+     * entries are skipped. If all are NULL, the loop waits indefinitely. */
+    nt_loop_hook idle[NT_LOOP_IDLE_MAX];
+    unsigned int idle_timeout;
+
+    /* Called at most once per iteration, after all pending events were
+     * handled. Rendering here happens once per batch of input. */
+    nt_loop_hook frame;
+
+    /* Passed to all callbacks. */
+    void* data;
+};
+
+/* Sets the handler for events of `type` in `loop`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `loop` is NULL or `type` does not have exactly one
+ * bit set. */
+
+NT_API int nt_loop_set_handler(struct nt_loop* loop, uint32_t type,
+                               nt_loop_handler handler);
+
+/* Runs `loop` until nt_loop_stop() is called. Each iteration waits for an
+ * event (or the idle timeout), handles it and every other pending event, then
+ * calls the frame callback.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `loop` is NULL.
+ * 2) NT_ERR_UNEXPECTED - A hard event I/O failure occurred. */
+
+NT_API int nt_loop_run(const struct nt_loop* loop);
+
+/* Makes nt_loop_run() return once the current callback finishes. Events that
+ * were not handled yet stay queued. Must be called from the thread running the
+ * loop, typically from a callback. Other threads can push an event whose
+ * handler stops the loop. */
+
+NT_API void nt_loop_stop(void);
+
+/* ========================================================================== */
+/* CONTEXT VARIANTS */
+/* ========================================================================== */
+
+/* Each behaves like the function without the ctx_ infix, on `ctx`. A NULL
+ * `ctx` selects the default context. */
+
+NT_API int nt_ctx_buffer_enable(struct nt_ctx* ctx, char* buff, size_t cap);
+NT_API int nt_ctx_buffer_disable(struct nt_ctx* ctx, enum nt_buffact buffact,
+                                 char** out_buff);
+NT_API int nt_ctx_buffer_flush(struct nt_ctx* ctx);
+
+NT_API void nt_ctx_output_set_sink(struct nt_ctx* ctx, nt_output_sink sink,
+                                   void* sink_data);
+NT_API int nt_ctx_render_to(struct nt_ctx* ctx, nt_render_fn render,
+                            void* data, char* buff, size_t cap,
+                            size_t* out_len);
+NT_API int nt_ctx_output_record_start(struct nt_ctx* ctx, int fd,
+                                      enum nt_output_record_fmt fmt,
+                                      size_t ring_cap);
+NT_API void nt_ctx_output_record_stop(struct nt_ctx* ctx);
+
+NT_API void nt_ctx_output_get_state(struct nt_ctx* ctx,
+                                    struct nt_output_state* out_state);
+NT_API void nt_ctx_output_set_congestion_limit(struct nt_ctx* ctx,
+                                               size_t limit);
+NT_API void nt_ctx_output_set_color_enc(struct nt_ctx* ctx,
+                                        enum nt_color_enc enc);
+NT_API void nt_ctx_output_set_frame_budget(struct nt_ctx* ctx, size_t budget);
+
+NT_API int nt_ctx_write_str(struct nt_ctx* ctx, const char* str, size_t len,
+                            struct nt_gfx gfx);
+NT_API int nt_ctx_write_str_unsafe(struct nt_ctx* ctx, const char* str,
+                                   struct nt_gfx gfx);
+NT_API int nt_ctx_write_str_id(struct nt_ctx* ctx, const char* str,
+                               size_t len, nt_gfx_id id);
+
+NT_API int nt_ctx_cursor_hide(struct nt_ctx* ctx);
+NT_API int nt_ctx_cursor_show(struct nt_ctx* ctx);
+NT_API int nt_ctx_cursor_move(struct nt_ctx* ctx, size_t x, size_t y);
+NT_API int nt_ctx_erase_screen(struct nt_ctx* ctx);
+NT_API int nt_ctx_erase_line(struct nt_ctx* ctx);
+NT_API int nt_ctx_erase_scrollback(struct nt_ctx* ctx);
+NT_API int nt_ctx_alt_screen_enable(struct nt_ctx* ctx);
+NT_API int nt_ctx_alt_screen_disable(struct nt_ctx* ctx);
+NT_API int nt_ctx_mouse_mode_enable(struct nt_ctx* ctx);
+NT_API int nt_ctx_mouse_mode_disable(struct nt_ctx* ctx);
+
+NT_API void nt_ctx_get_term_size(struct nt_ctx* ctx,
+                                 size_t* out_width, size_t* out_height);
+
+NT_API int nt_ctx_event_wait(struct nt_ctx* ctx, struct nt_event* out_event,
+                             unsigned int timeout, unsigned int* out_elapsed);
+NT_API int nt_ctx_event_wait_mask(struct nt_ctx* ctx,
+                                  struct nt_event* out_event, uint32_t mask,
+                                  unsigned int timeout,
+                                  unsigned int* out_elapsed);
+NT_API int nt_ctx_event_queue_drain(struct nt_ctx* ctx);
+NT_API int nt_ctx_event_get_fd(struct nt_ctx* ctx, int* out_fd);
+NT_API int nt_ctx_event_dispatch(struct nt_ctx* ctx,
+                                 struct nt_event* out_events, size_t cap,
+                                 size_t* out_count);
+NT_API int nt_ctx_event_push(struct nt_ctx* ctx, const struct nt_event* event);
+NT_API int nt_ctx_event_push_payload(struct nt_ctx* ctx, uint32_t type,
+                                     void* payload);
+NT_API int nt_ctx_event_push_keyed(struct nt_ctx* ctx,
+                                   const struct nt_event* event, uint32_t key);
+
+NT_API void nt_ctx_request_redraw(struct nt_ctx* ctx);
+NT_API int nt_ctx_present_set_fps(struct nt_ctx* ctx, unsigned int fps);
+NT_API unsigned int nt_ctx_present_get_timeout(struct nt_ctx* ctx);
+
+NT_API void nt_ctx_clock_set_virtual(struct nt_ctx* ctx, bool enable);
+NT_API void nt_ctx_clock_advance(struct nt_ctx* ctx, unsigned long long us);
+NT_API unsigned long long nt_ctx_clock_get_us(struct nt_ctx* ctx);
+
+NT_API int nt_ctx_input_record_start(struct nt_ctx* ctx, int fd);
+NT_API void nt_ctx_input_record_stop(struct nt_ctx* ctx);
+
+NT_API int nt_ctx_stats_get(struct nt_ctx* ctx, struct nt_stats* out_stats);
+
+NT_API int nt_ctx_loop_run(struct nt_ctx* ctx, const struct nt_loop* loop);
+NT_API void nt_ctx_loop_stop(struct nt_ctx* ctx);
+
 /* ========================================================================== */
 
 #endif // NT_H
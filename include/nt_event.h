@@ -21,22 +21,31 @@
 #define NT_EVENT_SIGNAL (1u << 2)
 #define NT_EVENT_RESIZE (1u << 3)
 #define NT_EVENT_TIMEOUT (1u << 4)
+#define NT_EVENT_FRAME (1u << 5)
 
 /* Bit positions [0, 15) are reserved for library events. Bit positions
  * [15, 32) are available for user-defined events. */
 #define NT_EVENT_CUSTOM_BASE (1u << 15)
 
+/* Matches every event type. */
+#define NT_EVENT_MASK_ALL UINT32_MAX
+
 /* Payload types for built-in events:
  * 1) NT_EVENT_KEY - struct nt_key_event.
  * 2) NT_EVENT_MOUSE - struct nt_mouse_event.
  * 3) NT_EVENT_SIGNAL - unsigned int signal number.
  * 4) NT_EVENT_RESIZE - struct nt_resize_event.
- * 5) NT_EVENT_TIMEOUT - no payload. */
+ * 5) NT_EVENT_TIMEOUT - no payload.
+ * 6) NT_EVENT_FRAME - struct nt_frame. */
 
 /* ------------------------------------------------------ */
 
 #define NT_EVENT_DATA_MAX_SIZE 64
 
+/* The event carries a pooled payload by reference. See
+ * nt_event_new_payload(). */
+#define NT_EVENT_FLAG_PAYLOAD (1u << 0)
+
 struct nt_event
 {
     union
@@ -46,6 +55,12 @@ struct nt_event
     } u;
     uint32_t type; // only 1 bit set
     uint8_t data_size;
+
+    /* NT_EVENT_FLAG_*, other bits are ignored. An event that isn't created
+     * by one of the nt_event_new_*() functions must be zero-initialized, or
+     * at least have `flags` cleared, since a stray NT_EVENT_FLAG_PAYLOAD makes
+     * its data be taken as a payload pointer. */
+    uint8_t flags;
 };
 
 #define NT_EVENT_FILL_DATA(event, out_ptr) \
@@ -64,9 +79,50 @@ NT_API int nt_event_new_custom(
         uint8_t data_size,
         struct nt_event* out_event);
 
-/* Checks whether `event` has a valid type and payload size. */
+/* Checks whether `event` has a valid type and payload size. Unknown bits of
+ * `flags` are ignored, NT_EVENT_FLAG_PAYLOAD requires a pointer-sized
+ * payload. */
 NT_API bool nt_event_is_valid(const struct nt_event* event);
 
+/* ------------------------------------------------------ */
+/* POOLED PAYLOADS */
+/* ------------------------------------------------------ */
+
+/* Allocates a payload of at least `size` bytes for events that do not fit in
+ * NT_EVENT_DATA_MAX_SIZE. Payloads are served from per-size-class free lists
+ * shared by all threads. Thread-safe.
+ *
+ * Returns NULL if `size` is 0 or allocation fails. */
+
+NT_API void* nt_event_payload_alloc(size_t size);
+
+/* Returns `payload` to the pool. Does nothing if `payload` is NULL.
+ * Thread-safe. */
+
+NT_API void nt_event_payload_release(void* payload);
+
+/* Returns the size that `payload` was allocated with. */
+
+NT_API size_t nt_event_payload_size(const void* payload);
+
+/* Creates an event with `type` that carries `payload` by reference. Only the
+ * pointer is stored in the event, so the payload is never copied.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_event` or `payload` is NULL, or `type` is
+ * invalid. */
+
+NT_API int nt_event_new_payload(
+        uint32_t type,
+        void* payload,
+        struct nt_event* out_event);
+
+/* Returns the payload carried by `event`, or NULL if `event` does not carry
+ * one. The receiver owns the payload and must release it with
+ * nt_event_payload_release(). */
+
+NT_API void* nt_event_get_payload(const struct nt_event* event);
+
 /* -------------------------------------------------------------------------- */
 /* NT_KEY_EVENT */
 /* -------------------------------------------------------------------------- */
@@ -160,4 +216,13 @@ struct nt_resize
     size_t new_x, new_y;
 };
 
+/* -------------------------------------------------------------------------- */
+/* NT_FRAME_EVENT */
+/* -------------------------------------------------------------------------- */
+
+struct nt_frame
+{
+    unsigned int interval_us; // current pacing interval
+};
+
 #endif // NT_EVENT_H
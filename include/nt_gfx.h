@@ -114,6 +114,12 @@ nt_style_are_eql(struct nt_style style1, struct nt_style style2)
 
 NT_API extern const struct nt_gfx NT_GFX_DEFAULT;
 
+/* Handle of an interned gfx, see nt_gfx_intern(). */
+typedef uint16_t nt_gfx_id;
+
+/* Id of NT_GFX_DEFAULT. */
+#define NT_GFX_ID_DEFAULT ((nt_gfx_id)0)
+
 static inline bool 
 nt_gfx_are_eql(struct nt_gfx gfx1, struct nt_gfx gfx2)
 {
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#ifndef NT_GRID_H
+#define NT_GRID_H
+
+#include "nt_shared.h"
+#include "nt_gfx.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+/* CELL */
+/* -------------------------------------------------------------------------- */
+
+/* `cp` is an index into the grid's grapheme table instead of a code point. */
+#define NT_CELL_GRAPHEME (1u << 0)
+
+/* The cell holds a double-width character. The cell to its right is marked
+ * with NT_CELL_CONT. */
+#define NT_CELL_WIDE (1u << 1)
+
+/* The cell is covered by the double-width character to its left and is never
+ * drawn on its own. */
+#define NT_CELL_CONT (1u << 2)
+
+/* Cells are packed into 8 bytes: a 32-bit code point (or grapheme index) and
+ * a 32-bit attribute word holding the interned gfx id in the lower 16 bits and
+ * the NT_CELL_* flags in the upper 16 bits. */
+struct nt_cell
+{
+    uint32_t cp;
+    nt_gfx_id gfx;
+    uint16_t flags;
+};
+
+static inline uint32_t nt_cell_attr_new(nt_gfx_id gfx, uint16_t flags)
+{
+    return (((uint32_t)flags) << 16) | gfx;
+}
+
+static inline nt_gfx_id nt_cell_attr_gfx(uint32_t attr)
+{
+    return (nt_gfx_id)(attr & 0xFFFF);
+}
+
+static inline uint16_t nt_cell_attr_flags(uint32_t attr)
+{
+    return (uint16_t)(attr >> 16);
+}
+
+static inline bool nt_cell_are_eql(struct nt_cell cell1, struct nt_cell cell2)
+{
+    return ((cell1.cp == cell2.cp) && (cell1.gfx == cell2.gfx) &&
+            (cell1.flags == cell2.flags));
+}
+
+/* -------------------------------------------------------------------------- */
+/* GRID */
+/* -------------------------------------------------------------------------- */
+
+/* A `width` x `height` grid of cells in a structure-of-arrays layout: code
+ * points and attribute words are kept in two separate arrays. Each row is
+ * contiguous and starts at a multiple of NT_GRID_ROW_ALIGN cells, so rows can
+ * be compared with memcmp() or vector loads. The padding past `width` is
+ * always zero. */
+struct nt_grid;
+
+#define NT_GRID_ROW_ALIGN 8
+
+/* Creates a grid of `width` x `height` cells, filled with spaces drawn with
+ * NT_GFX_ID_DEFAULT.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_grid` is NULL.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_grid_new(size_t width, size_t height, struct nt_grid** out_grid);
+
+NT_API void nt_grid_destroy(struct nt_grid* grid);
+
+/* ------------------------------------------------------ */
+
+/* Resizes `grid` to `width` x `height` cells. Contents are cleared as by
+ * nt_grid_clear() with NT_GFX_ID_DEFAULT.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `grid` is NULL.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed. The grid is unchanged. */
+
+NT_API int nt_grid_resize(struct nt_grid* grid, size_t width, size_t height);
+
+/* Stores the size of `grid` in `out_width` and `out_height` when provided. */
+
+NT_API void nt_grid_get_size(const struct nt_grid* grid,
+        size_t* out_width, size_t* out_height);
+
+/* ------------------------------------------------------ */
+
+/* Fills `grid` with spaces drawn with `gfx` and empties its grapheme table. */
+
+NT_API void nt_grid_clear(struct nt_grid* grid, nt_gfx_id gfx);
+
+/* ------------------------------------------------------ */
+
+/* Sets the cell at (`x`, `y`). If `cell` has NT_CELL_WIDE set and there is a
+ * cell to its right, that cell becomes its NT_CELL_CONT continuation. A
+ * double-width character that loses either half this way has its other half
+ * replaced by a space.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `grid` is NULL.
+ * 2) NT_ERR_OUT_OF_BOUNDS - (`x`, `y`) is outside the grid. */
+
+NT_API int nt_grid_set(struct nt_grid* grid, size_t x, size_t y,
+        struct nt_cell cell);
+
+/* Sets the cell at (`x`, `y`) to the grapheme cluster of `len` UTF-8 bytes
+ * from `str`, like nt_grid_set(). The cluster is copied into the grid's
+ * grapheme table, which only shrinks on nt_grid_clear().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `grid` or `str` is NULL, or `len` is 0.
+ * 2) NT_ERR_OUT_OF_BOUNDS - (`x`, `y`) is outside the grid.
+ * 3) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_grid_set_grapheme(struct nt_grid* grid, size_t x, size_t y,
+        const char* str, size_t len, nt_gfx_id gfx, uint16_t flags);
+
+/* Stores the cell at (`x`, `y`) in `out_cell`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `grid` or `out_cell` is NULL.
+ * 2) NT_ERR_OUT_OF_BOUNDS - (`x`, `y`) is outside the grid. */
+
+NT_API int nt_grid_get(const struct nt_grid* grid, size_t x, size_t y,
+        struct nt_cell* out_cell);
+
+/* Returns the UTF-8 bytes of grapheme `idx` and stores their count in
+ * `out_len`. Returns NULL if `idx` is not in the grapheme table. */
+
+NT_API const char* nt_grid_get_grapheme(const struct nt_grid* grid,
+        uint32_t idx, size_t* out_len);
+
+/* ------------------------------------------------------ */
+
+/* Return the code points and attribute words of row `y`, or NULL if `y` is
+ * outside the grid. Both arrays hold nt_grid_get_stride() elements. */
+
+NT_API const uint32_t* nt_grid_row_cps(const struct nt_grid* grid, size_t y);
+NT_API const uint32_t* nt_grid_row_attrs(const struct nt_grid* grid, size_t y);
+
+/* Returns the number of elements between the starts of consecutive rows. */
+
+NT_API size_t nt_grid_get_stride(const struct nt_grid* grid);
+
+/* ------------------------------------------------------ */
+
+/* Draws the whole of `grid` with its top-left corner at the top-left corner
+ * of the terminal. Rows and columns past the terminal size are drawn anyway,
+ * the terminal clips them.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `grid` is NULL.
+ * 2) NT_ERR_OUT_OF_BOUNDS - A cell uses a gfx id that wasn't interned.
+ * 3) NT_ERR_FUNC_NOT_SUPP - A required terminal function is unsupported.
+ * 4) NT_ERR_UNEXPECTED - Output could not be completed. */
+
+NT_API int nt_grid_draw(const struct nt_grid* grid);
+
+/* Draws only what differs between `grid` and `screen`, which must hold what
+ * the terminal shows, then updates `screen` to match `grid`. Each row is
+ * redrawn from its first to its last changed cell. Rows are skipped by their
+ * cached 64-bit hashes where possible and compared with SSE2/AVX2 when the
+ * CPU supports it. If the sizes differ, `screen` is resized and `grid` is
+ * drawn in full.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `screen` or `grid` is NULL, or they are the same.
+ * 2) NT_ERR_ALLOC_FAIL - Resizing `screen` failed.
+ * 3) NT_ERR_OUT_OF_BOUNDS - A cell uses a gfx id that wasn't interned.
+ * 4) NT_ERR_FUNC_NOT_SUPP - A required terminal function is unsupported.
+ * 5) NT_ERR_UNEXPECTED - Output could not be completed. `screen` keeps the
+ * rows drawn before the failure. */
+
+NT_API int nt_grid_present(struct nt_grid* screen, struct nt_grid* grid);
+
+/* Like nt_grid_draw() and nt_grid_present(), on `ctx`, see nt_ctx_new(). A
+ * NULL `ctx` selects the default context. When several contexts present at
+ * once, only one of them encodes on the threads set by
+ * nt_grid_set_present_threads(), the others encode on their own thread. */
+
+NT_API int nt_ctx_grid_draw(struct nt_ctx* ctx, const struct nt_grid* grid);
+NT_API int nt_ctx_grid_present(struct nt_ctx* ctx,
+        struct nt_grid* screen, struct nt_grid* grid);
+
+/* ------------------------------------------------------ */
+
+#define NT_GRID_PRESENT_THREADS_MAX 64
+
+/* Sets the number of threads nt_grid_present() encodes with, counting the
+ * calling thread. With more than 1, the grid is split into that many bands of
+ * rows, each band is encoded on its own thread, and the encoded bands are
+ * written in order with one writev() call, or buffered if they fit. The
+ * output is byte-identical to encoding with 1 thread. While a frame budget
+ * is set, frames are encoded on the calling thread only. The default is 1,
+ * and nt_deinit() sets it back to 1, stopping the threads. Not thread-safe.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `threads` is 0 or above
+ * NT_GRID_PRESENT_THREADS_MAX.
+ * 2) NT_ERR_UNEXPECTED - Starting a thread failed. Encoding falls back to
+ * the calling thread only. */
+
+NT_API int nt_grid_set_present_threads(unsigned int threads);
+
+/* -------------------------------------------------------------------------- */
+/* FRAME BUFFER */
+/* -------------------------------------------------------------------------- */
+
+/* A triple-buffered grid for handing frames from one producer thread to one
+ * presenting thread without locks or copies. The producer draws into the back
+ * grid and publishes it, the presenting thread acquires the newest published
+ * grid. Frames published in between are dropped. */
+struct nt_frame_buff;
+
+/* Creates a frame buffer of three `width` x `height` grids, as by
+ * nt_grid_new().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_fbuff` is NULL.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_frame_buff_new(size_t width, size_t height,
+        struct nt_frame_buff** out_fbuff);
+
+NT_API void nt_frame_buff_destroy(struct nt_frame_buff* fbuff);
+
+/* ------------------------------------------------------ */
+
+/* Producer side. Returns the grid to draw the next frame into. After a
+ * publish, it holds an older frame, or the initial contents. The producer may
+ * resize it. Returns NULL if `fbuff` is NULL. */
+
+NT_API struct nt_grid* nt_frame_buff_get_back(struct nt_frame_buff* fbuff);
+
+/* Producer side. Publishes the back grid and takes a new one. */
+
+NT_API void nt_frame_buff_publish(struct nt_frame_buff* fbuff);
+
+/* ------------------------------------------------------ */
+
+/* Presenting side. Takes the newest published grid, if there is one that
+ * wasn't acquired yet, and stores the current front grid in `out_front` when
+ * provided. The front grid stays valid until the next call. Returns true if
+ * the front grid changed. */
+
+NT_API bool nt_frame_buff_acquire(struct nt_frame_buff* fbuff,
+        struct nt_grid** out_front);
+
+/* Presenting side. Acquires the newest published grid and presents it onto
+ * `screen` with nt_grid_present(). Does nothing if no grid was published since
+ * the last acquire.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `fbuff` or `screen` is NULL.
+ * 2) Errors of nt_grid_present(). */
+
+NT_API int nt_frame_buff_present(struct nt_frame_buff* fbuff,
+        struct nt_grid* screen);
+
+/* Like nt_frame_buff_present(), presenting with nt_ctx_grid_present(). */
+
+NT_API int nt_ctx_frame_buff_present(struct nt_ctx* ctx,
+        struct nt_frame_buff* fbuff, struct nt_grid* screen);
+
+/* -------------------------------------------------------------------------- */
+/* BROADCAST */
+/* -------------------------------------------------------------------------- */
+
+/* Presents the same grid to many viewers, each a descriptor of a terminal.
+ * Viewers are grouped into classes of terminals that encode output the same
+ * way, and each frame is encoded once per class, not once per viewer. Writes
+ * never block. A viewer that can't take a whole frame gets the rest of it
+ * written on later frames, skipping those frames, and then a full redraw
+ * instead of the skipped frames. Not thread-safe. */
+struct nt_broadcast;
+
+/* ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_bcast` is NULL.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_broadcast_new(struct nt_broadcast** out_bcast);
+
+/* Destroys `bcast`. Descriptors of viewers are left open. */
+
+NT_API void nt_broadcast_destroy(struct nt_broadcast* bcast);
+
+/* ------------------------------------------------------ */
+
+/* Adds a viewer writing to `fd`, for the terminal described by `term` and
+ * `colorterm`, as by nt_ctx_new(). `fd` is made non-blocking. The first frame
+ * presented to the viewer is a full redraw.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `bcast` is NULL, `fd` is negative or already
+ * subscribed.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed.
+ * 3) NT_ERR_INIT_TERM_ENV - `term` is NULL.
+ * 4) NT_ERR_INIT_PIPE - Failed to create an internal pipe.
+ * 5) NT_ERR_TERM_NOT_SUPP - The terminal was not recognized. The viewer is
+ * added and assumes xterm compatibility.
+ * 6) NT_ERR_UNEXPECTED - Making `fd` non-blocking failed. */
+
+NT_API int nt_broadcast_subscribe(struct nt_broadcast* bcast, int fd,
+        const char* term, const char* colorterm);
+
+/* Removes the viewer writing to `fd`, if any. Unwritten output is dropped
+ * and `fd` is left open. */
+
+NT_API void nt_broadcast_unsubscribe(struct nt_broadcast* bcast, int fd);
+
+/* Returns the number of viewers. */
+
+NT_API size_t nt_broadcast_get_count(const struct nt_broadcast* bcast);
+
+/* ------------------------------------------------------ */
+
+/* Presents `grid` to every viewer, like nt_grid_present() does to the
+ * terminal. Viewers whose descriptor fails with an error other than EAGAIN
+ * are removed, see nt_broadcast_get_count().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `bcast` or `grid` is NULL.
+ * 2) Errors of nt_grid_present(). Only the rest of earlier frames was
+ * written to viewers. Viewers whose frame was lost are redrawn in full by
+ * the next call. */
+
+NT_API int nt_broadcast_present(struct nt_broadcast* bcast,
+        struct nt_grid* grid);
+
+#endif // NT_GRID_H
@@ -7,6 +7,7 @@
 
 #include "nt_shared.h"
 #include "nt_error.h"
+#include "nt_gfx.h"
 
 /* Internally used. */
 enum nt_esc_func
@@ -52,6 +53,30 @@ struct nt_term_info
     char* name;
 };
 
+#define NT__ESC_FRAG_CAP 23
+
+/* Pre-rendered escape sequence, emitted with a single copy of `len` bytes. */
+struct nt__esc_frag
+{
+    uint8_t len; // 0 if the terminal doesn't support the function
+    char seq[NT__ESC_FRAG_CAP];
+};
+
+/* Escape sequences of the selected terminal, rendered by nt__term_init(). */
+struct nt__esc_cache
+{
+    /* Indexed by enum nt_esc_func. Parametrized functions (cursor move, RGB
+     * colors, c8 and c256 colors) are left empty. */
+    struct nt__esc_frag funcs[NT_ESC_FUNC_OTHER];
+
+    /* Indexed by color code. */
+    struct nt__esc_frag fg_c8[8], bg_c8[8];
+    struct nt__esc_frag fg_c256[256], bg_c256[256];
+
+    /* Part of the RGB sequences preceding the color components. */
+    struct nt__esc_frag fg_rgb, bg_rgb;
+};
+
 typedef enum nt_term_color_count
 {
     NT_TERM_COLOR_C8,
@@ -60,21 +85,224 @@ typedef enum nt_term_color_count
     NT_TERM_COLOR_OTHER // Must be last because internally used as count
 } nt_term_color_count;
 
-/* Detects the terminal and color mode from TERM and COLORTERM.
+/* Terminal selected for a context. While unset, `info` is zero-initialized,
+ * `colors` is NT_TERM_COLOR_OTHER and all fragments of `esc_cache` are
+ * empty. */
+struct nt__term
+{
+    struct nt_term_info info;
+    nt_term_color_count colors;
+    struct nt__esc_cache esc_cache;
+};
+
+/* Detects the terminal and color mode from the values of TERM and COLORTERM.
+ * `env_colorterm` may be NULL.
  *
  * ERROR CODES:
- * 1) NT_ERR_INIT_TERM_ENV - TERM is not set.
+ * 1) NT_ERR_INIT_TERM_ENV - `env_term` is NULL.
  * 2) NT_ERR_TERM_NOT_SUPP - The terminal was not recognized and xterm
  * compatibility was assumed. */
-int nt__term_init(void);
+int nt__term_init(struct nt__term* term,
+        const char* env_term, const char* env_colorterm);
+
+/* Unsets `term`. */
+void nt__term_deinit(struct nt__term* term);
+
+/* Frees the blocks retained by the payload pool's free lists. */
+void nt__payload_pool_trim(void);
+
+/* Consumes a SIGPIPE raised by a failed write while it is blocked, so it
+ * isn't delivered later. */
+void nt__clear_pending_sigpipe(void);
+
+/* ------------------------------------------------------ */
+
+/* Highest id nt_gfx_intern() hands out. */
+#define NT__GFX_ID_MAX (UINT16_MAX - 1)
+
+struct nt__gfx_entry
+{
+    struct nt_gfx gfx; // immutable once interned
+};
+
+/* Returns the entry of `id`, or NULL if `id` wasn't handed out. */
+const struct nt__gfx_entry* nt__gfx_entry_get(nt_gfx_id id);
+
+/* ------------------------------------------------------ */
+
+/* Growable output buffer, used to encode output away from stdout. */
+struct nt__chunk
+{
+    char* data;
+    size_t len, cap;
+
+    /* Bytes of SGR and cursor sequences emitted to the chunk, the rest is
+     * text. Counted by nt__write_chunks(), reset along with `len`. */
+    size_t sgr_len, cursor_len;
+};
+
+/* Upper bound of chunks passed to nt__write_chunks(). */
+#define NT__CHUNKS_MAX 64
+
+/* Appends `len` bytes of `str` to `chunk`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_ALLOC_FAIL - Growing the chunk failed. */
+int nt__chunk_put(struct nt__chunk* chunk, const char* str, size_t len);
+
+/* Like nt_ctx_cursor_move() and nt_ctx_write_str_id(), but append to `chunk`
+ * instead, producing the same bytes. With a NULL `chunk`, they write as the
+ * public functions do. With a chunk, they don't modify `ctx`, so multiple
+ * threads can encode at once, and they ignore the frame budget. */
+int nt__encode_cursor_move(struct nt_ctx* ctx, struct nt__chunk* chunk,
+        size_t x, size_t y);
+int nt__encode_str_id(struct nt_ctx* ctx, struct nt__chunk* chunk,
+        const char* str, size_t len, nt_gfx_id id);
+
+/* Returns true if chunk encoding produces the same bytes as writing directly.
+ * It doesn't while a frame budget is set. */
+bool nt__encode_is_exact(struct nt_ctx* ctx);
+
+/* Writes `count` chunks in order to the output of `ctx`. Chunks that fit in
+ * the output buffer are buffered. Otherwise the buffer and the chunks go out
+ * with one writev().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `count` is above NT__CHUNKS_MAX.
+ * 2) NT_ERR_UNEXPECTED - Output could not be completed. */
+int nt__write_chunks(struct nt_ctx* ctx,
+        const struct nt__chunk* chunks, size_t count);
+
+/* ------------------------------------------------------ */
+
+/* Returns the stop flag of nt_ctx_loop_run() for `ctx`, the default context
+ * if NULL. */
+bool* nt__ctx_loop_stop(struct nt_ctx* ctx);
+
+/* Returns the number of bytes held in the output buffer of `ctx`, the default
+ * context if NULL. */
+size_t nt__output_buffered(struct nt_ctx* ctx);
+
+/* ------------------------------------------------------ */
+
+struct nt__verify;
+struct nt_grid;
+
+/* Returns the verification state of `ctx`, the default context if NULL. It
+ * is NULL while verification is disabled. */
+struct nt__verify** nt__ctx_verify(struct nt_ctx* ctx);
+
+void nt__verify_destroy(struct nt__verify* verify);
+
+/* Feeds output of the context to its shadow model. */
+void nt__verify_feed(struct nt__verify* verify, const void* data, size_t len);
+
+/* Called around drawing `grid` as a frame. `full` is set if every cell of the
+ * frame is drawn. Once the frame is flushed, it is checked against the
+ * shadow model. */
+void nt__verify_frame_begin(struct nt_ctx* ctx, const struct nt_grid* grid,
+        bool full);
+void nt__verify_frame_end(struct nt_ctx* ctx, const struct nt_grid* grid);
+
+/* Called after the output buffer of `ctx` was flushed. */
+void nt__verify_on_flush(struct nt_ctx* ctx);
+
+/* Stores in `out`, which must hold 4 bytes, the UTF-8 bytes drawn for the
+ * cell at (`x`, `y`) and returns their count, or points `out_ext` to them if
+ * they are stored in the grapheme table. */
+size_t nt__grid_get_utf8(const struct nt_grid* grid, size_t x, size_t y,
+        char* out, const char** out_ext);
+
+/* Makes `dst` a copy of `src`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+int nt__grid_copy(struct nt_grid* dst, const struct nt_grid* src);
+
+/* ------------------------------------------------------ */
+
+struct nt__tee;
+
+/* Returns the output recording of `ctx`, the default context if NULL. It is
+ * NULL while output isn't recorded. */
+struct nt__tee** nt__ctx_tee(struct nt_ctx* ctx);
+
+/* Writes out the rest of the recording and frees it. */
+void nt__tee_destroy(struct nt__tee* tee);
+
+/* Adds output of the context, written at `now_us` on its clock, to the
+ * recording. */
+void nt__tee_feed(struct nt__tee* tee, unsigned long long now_us,
+        const void* data, size_t len);
+
+/* Returns the time on the clock of `ctx`, the default context if NULL. */
+unsigned long long nt__ctx_clock_us(struct nt_ctx* ctx);
+
+/* ------------------------------------------------------ */
+
+/* Trace points, compiled in only when NT_TRACE is defined. Otherwise they
+ * expand to nothing, so `var` must not be used outside of them:
+ *
+ *     NT__TRACE_BEGIN(trace);
+ *     ...
+ *     NT__TRACE_END(trace, "buffer_flush");
+ *
+ * `name` must be a string literal. */
+#ifdef NT_TRACE
+
+uint64_t nt__trace_now_ns(void);
+
+/* Adds a span from `start_ns` to now to the ring of the calling thread. */
+void nt__trace_add(const char* name, uint64_t start_ns);
+
+#define NT__TRACE_BEGIN(var) uint64_t var = nt__trace_now_ns()
+#define NT__TRACE_END(var, name) nt__trace_add((name), (var))
+
+#else
+
+#define NT__TRACE_BEGIN(var) ((void)0)
+#define NT__TRACE_END(var, name) ((void)0)
+
+#endif // NT_TRACE
+
+/* ------------------------------------------------------ */
+
+/* Upper bound of worker threads. */
+#define NT__WORKERS_MAX 63
+
+typedef void (*nt__task_fn)(void* arg, size_t idx);
+
+/* Sets the number of worker threads, stopping or starting them as needed.
+ * Not thread-safe, like nt__workers_run().
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `count` is above NT__WORKERS_MAX.
+ * 2) NT_ERR_UNEXPECTED - Starting a thread failed. No workers are left. */
+int nt__workers_set(unsigned int count);
+
+unsigned int nt__workers_get(void);
+
+/* Calls `fn` with `arg` for every index in [0, `count`), spread across the
+ * workers and the calling thread. Returns once all calls have returned. */
+void nt__workers_run(nt__task_fn fn, void* arg, size_t count);
 
-/* Returns the selected terminal info, or a zero-initialized value if unset. */
-struct nt_term_info nt__term_get_used(void);
+/* ------------------------------------------------------ */
 
-/* Returns the selected color mode, or NT_TERM_COLOR_OTHER if unset. */
-nt_term_color_count nt__term_get_color_count(void);
+/* Finds the first and last index in [0, `len`) at which the cells of two grid
+ * rows differ. `len` must be a multiple of NT_GRID_ROW_ALIGN. Returns false if
+ * the rows are equal. Uses the widest vector unit the CPU supports. */
+bool nt__row_diff(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2,
+        size_t len,
+        size_t* out_first,
+        size_t* out_last);
 
-void nt__term_deinit(void);
+/* Hashes `len` cells of a grid row. `len` must be a multiple of
+ * NT_GRID_ROW_ALIGN. */
+uint64_t nt__row_hash(const uint32_t* cps, const uint32_t* attrs, size_t len);
 
 
 #endif // NT_INTERNAL_H
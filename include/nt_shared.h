@@ -27,6 +27,9 @@ typedef union nt__max_align {
 } nt__max_align_t;
 #endif
 
+/* Terminal session, see nt_ctx_new(). */
+struct nt_ctx;
+
 #ifdef NT_EXPORT
 #define NT_API __attribute__((visibility("default")))
 #else
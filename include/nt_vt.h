@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#ifndef NT_VT_H
+#define NT_VT_H
+
+#include "nt_shared.h"
+#include "nt_gfx.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* -------------------------------------------------------------------------- */
+/* CELL */
+/* -------------------------------------------------------------------------- */
+
+enum nt_vt_color_type
+{
+    NT_VT_COLOR_DEFAULT,
+    NT_VT_COLOR_C8, // `idx` in [0, 8)
+    NT_VT_COLOR_C256, // `idx`
+    NT_VT_COLOR_RGB // `rgb`
+};
+
+/* A color as set by SGR. Fields not used by `type` are 0. */
+struct nt_vt_color
+{
+    uint8_t type;
+    uint8_t idx;
+    struct nt_rgb rgb;
+};
+
+/* SGR state: colors and NT_STYLE_* flags. */
+struct nt_vt_pen
+{
+    struct nt_vt_color fg, bg;
+    uint8_t style;
+};
+
+static inline bool nt_vt_pen_are_eql(struct nt_vt_pen pen1,
+        struct nt_vt_pen pen2)
+{
+    return ((pen1.fg.type == pen2.fg.type) && (pen1.fg.idx == pen2.fg.idx) &&
+            nt_rgb_are_eql(pen1.fg.rgb, pen2.fg.rgb) &&
+            (pen1.bg.type == pen2.bg.type) && (pen1.bg.idx == pen2.bg.idx) &&
+            nt_rgb_are_eql(pen1.bg.rgb, pen2.bg.rgb) &&
+            (pen1.style == pen2.style));
+}
+
+/* Longest grapheme cluster kept in a cell. Longer ones are truncated. */
+#define NT_VT_TEXT_CAP 24
+
+/* `text` holds the UTF-8 bytes shown in the cell, a space if the cell is
+ * blank. `flags` holds NT_CELL_WIDE or NT_CELL_CONT, see nt_grid.h. A
+ * NT_CELL_CONT cell has no text. */
+struct nt_vt_cell
+{
+    char text[NT_VT_TEXT_CAP];
+    uint8_t len;
+    uint16_t flags;
+    struct nt_vt_pen pen;
+};
+
+/* -------------------------------------------------------------------------- */
+/* VT */
+/* -------------------------------------------------------------------------- */
+
+/* In-process model of a terminal screen, fed with the bytes the library
+ * writes. It understands the sequences the library emits: cursor movement
+ * and visibility, SGR, erase, the alternate screen and the control
+ * characters CR, LF, BS and TAB. It wraps at the right margin and scrolls at
+ * the bottom like xterm. Other sequences are parsed and ignored. Character
+ * widths follow a built-in approximation of wcwidth(), so the model does not
+ * depend on the locale. */
+struct nt_vt;
+
+/* Creates a `width` x `height` model with a blank screen and the cursor at
+ * the top-left corner.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `out_vt` is NULL, or `width` or `height` is 0.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_vt_new(size_t width, size_t height, struct nt_vt** out_vt);
+
+NT_API void nt_vt_destroy(struct nt_vt* vt);
+
+/* ------------------------------------------------------ */
+
+/* Interprets `len` bytes of terminal output. Sequences may be split across
+ * calls. */
+
+NT_API void nt_vt_feed(struct nt_vt* vt, const char* data, size_t len);
+
+/* An nt_output_sink feeding the struct nt_vt passed as `sink_data`, see
+ * nt_output_set_sink(). Always succeeds. */
+
+NT_API int nt_vt_sink_write(const char* data, size_t len, void* sink_data);
+
+/* ------------------------------------------------------ */
+
+NT_API void nt_vt_get_size(const struct nt_vt* vt,
+        size_t* out_width, size_t* out_height);
+
+/* Stores the cell at (`x`, `y`) of the shown screen in `out_cell`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `vt` or `out_cell` is NULL.
+ * 2) NT_ERR_OUT_OF_BOUNDS - (`x`, `y`) is outside the screen. */
+
+NT_API int nt_vt_get_cell(const struct nt_vt* vt, size_t x, size_t y,
+        struct nt_vt_cell* out_cell);
+
+/* Stores the cursor position and visibility when provided. */
+
+NT_API void nt_vt_get_cursor(const struct nt_vt* vt,
+        size_t* out_x, size_t* out_y, bool* out_visible);
+
+/* Stores the current SGR state in `out_pen` when provided. */
+
+NT_API void nt_vt_get_pen(const struct nt_vt* vt, struct nt_vt_pen* out_pen);
+
+/* ------------------------------------------------------ */
+
+struct nt_vt_stats
+{
+    unsigned long long bytes; // bytes fed
+    unsigned long long changes; // cell writes and erases that changed a cell
+};
+
+/* Stores the counters since creation or the last reset in `out_stats`.
+ * `bytes` / `changes` is the number of bytes emitted per visible change. */
+
+NT_API void nt_vt_get_stats(const struct nt_vt* vt,
+        struct nt_vt_stats* out_stats);
+
+NT_API void nt_vt_reset_stats(struct nt_vt* vt);
+
+/* -------------------------------------------------------------------------- */
+/* VERIFICATION */
+/* -------------------------------------------------------------------------- */
+
+/* First cell of a frame shown differently than intended. */
+struct nt_verify_mismatch
+{
+    size_t x, y;
+
+    /* The frame cell: the UTF-8 bytes drawn for it, truncated to
+     * NT_VT_TEXT_CAP, its gfx and the SGR state the gfx is rendered to. */
+    char expected_text[NT_VT_TEXT_CAP];
+    uint8_t expected_len;
+    uint16_t expected_flags;
+    nt_gfx_id expected_gfx;
+    struct nt_vt_pen expected_pen;
+
+    /* The cell of the shadow model. */
+    struct nt_vt_cell actual;
+};
+
+typedef void (*nt_verify_fn)(const struct nt_verify_mismatch* mismatch,
+        void* data);
+
+/* Debug mode checking the output against the frames it is meant to show.
+ * Everything written from now on is also fed to a shadow nt_vt model the size
+ * of the frame. Once a frame drawn with nt_grid_present() or nt_grid_draw()
+ * is flushed, each of its cells is compared with the model: text, width and
+ * SGR state. `fn` is called with `data` and the first cell that differs,
+ * once per frame.
+ *
+ * The model does not know what was on screen before it was created, so
+ * checking starts with the first frame drawn in full, such as an
+ * nt_grid_present() with an empty `screen`. The same applies after the frame
+ * size changes. Colors lowered to stay within the frame budget are reported
+ * as mismatches. Enabling again replaces `fn` and `data`.
+ *
+ * ERROR CODES:
+ * 1) NT_ERR_INVALID_ARG - `fn` is NULL.
+ * 2) NT_ERR_ALLOC_FAIL - Memory allocation failed. */
+
+NT_API int nt_verify_enable(nt_verify_fn fn, void* data);
+
+NT_API void nt_verify_disable(void);
+
+NT_API int nt_ctx_verify_enable(struct nt_ctx* ctx,
+        nt_verify_fn fn, void* data);
+NT_API void nt_ctx_verify_disable(struct nt_ctx* ctx);
+
+#endif // NT_VT_H
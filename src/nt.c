@@ -18,8 +18,15 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <signal.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#define NT__HAVE_EPOLL
+#endif
+
 #define UCONV_IMPLEMENTATION
 #include "uconv.h"
 
@@ -31,6 +38,16 @@
 #define CUSTOM_POLL_FD 3
 #define POLL_FD_COUNT 4
 
+/* Custom event pipe header layout: type bit index, data size, flags. Pushed
+ * events follow their data with the time they were pushed, see
+ * nt_stats.queue_wait_us. */
+#define NT__EVENT_HEADER_SIZE 3
+#define NT__EVENT_STAMP_SIZE sizeof(unsigned long long)
+
+/* Used in place of the type bit index for internal tokens. */
+#define NT__EVENT_TOKEN_KEYED 0xFF
+#define NT__EVENT_TOKEN_WAKE 0xFE
+
 /* ------------------------------------------------------------------------- */
 /* GENERAL */
 /* ------------------------------------------------------------------------- */
@@ -39,21 +56,159 @@ static pthread_t sigthread;
 static pthread_mutex_t sigthread_lock;
 static volatile bool sigthread_stop;
 
-static int signal_pipe[2];
-static int resize_pipe[2];
-static int custom_event_pipe[2];
-static struct pollfd poll_fds[POLL_FD_COUNT];
-static struct termios init_term_opts;
+static bool init_sigmask_set, init_sigthread_create, init_sigthread_lock;
+
+/* Renders the sequences that set `gfx` into `out`, which must hold at least
+ * NT__GFX_SEQ_MAX bytes. See GFX EMITTERS. */
+typedef int (*nt__gfx_emitter)(
+        const struct nt__esc_cache* cache,
+        const struct nt_gfx* gfx,
+        char* out,
+        size_t* out_len);
+
+/* Undelivered events pushed with nt_event_push_keyed(). Only a token holding
+ * the key passes through the custom event pipe. The event is looked up when
+ * the token is read, so later pushes can replace it in the meantime. */
+struct nt__keyed_slot
+{
+    struct nt_event event;
+    uint32_t key;
+    bool pending;
+};
+
+/* Gfx reset followed by the sequences setting an interned gfx, rendered for
+ * generation `gen` of the context's output settings. */
+struct nt__sgr
+{
+    char* seq;
+    uint16_t len, reset_len;
+    unsigned int gen;
+};
+
+struct nt_ctx
+{
+    int in_fd, out_fd;
+
+    int signal_pipe[2]; // only opened for the default context
+    int resize_pipe[2];
+    int custom_event_pipe[2];
+    struct pollfd poll_fds[POLL_FD_COUNT];
+    struct termios init_term_opts;
+
+    struct nt__term term;
+
+    char* out_buff;
+    size_t out_buff_pos;
+    size_t out_buff_cap;
+
+    /* Receives output in place of `out_fd` when set. */
+    nt_output_sink sink;
+    void* sink_data;
+
+    /* Shadow model all output is fed to, see nt_ctx_verify_enable(). */
+    struct nt__verify* verify;
+
+    /* Output recording, see nt_ctx_output_record_start(). */
+    struct nt__tee* tee;
+
+    /* See nt_ctx_stats_get(). */
+    struct nt_stats stats;
+
+    /* See nt_ctx_clock_set_virtual(). */
+    bool clock_virtual;
+    unsigned long long clock_us;
+
+    /* Input recording, see nt_ctx_input_record_start(). `record` collects the
+     * header and bytes of the event being parsed. */
+    int record_fd;
+    unsigned long long record_start_us;
+    struct nt__chunk record;
+
+    /* Bytes written since the last flush, checked against `frame_budget`. */
+    size_t frame_bytes;
+    size_t frame_budget;
+    enum nt_color_enc color_enc;
+
+    /* Selected by nt__gfx_emitter_select(), see GFX EMITTERS. */
+    nt__gfx_emitter gfx_emitter;
+
+    /* Indexed by gfx id, rendered on first use. `sgr_gen` is bumped whenever
+     * the rendering of gfx changes, which stales all of them. */
+    struct nt__sgr* sgrs;
+    size_t sgr_cap;
+    unsigned int sgr_gen;
+
+    pthread_mutex_t keyed_lock;
+    struct nt__keyed_slot* keyed_slots;
+    size_t keyed_count;
+    size_t keyed_cap;
+
+    /* Events read by nt_event_wait_mask() that did not match its mask. Only
+     * accessed by the waiting thread. */
+    struct nt_event* deferred;
+    size_t deferred_count;
+    size_t deferred_cap;
+
+    /* Readiness descriptor returned by nt_event_get_fd(), created on first
+     * use. It is an epoll instance over `poll_fds` and `deferred_fd`.
+     * `deferred_fd` is an eventfd kept readable while the deferred list is not
+     * empty. */
+    int ready_fd;
+    int deferred_fd;
+    bool deferred_fd_set;
+
+    /* Frame pacing state, guarded by `present_lock`. `present_token` is set
+     * while a wake token is in the custom event pipe. `present_waiter` is the
+     * last thread that waited for events. */
+    pthread_mutex_t present_lock;
+    bool present_requested;
+    bool present_token;
+    pthread_t present_waiter;
+    bool present_waiter_set;
+    unsigned long long present_target_us;
+    unsigned long long present_interval_us;
+    unsigned long long present_last_us;
+    unsigned long long present_flush_avg_us;
+
+    /* Output backpressure, guarded by `present_lock`. */
+    size_t output_queued;
+    unsigned long long output_flush_us;
+    size_t output_congestion_limit;
+    bool output_congested;
+
+    /* Set by nt_ctx_set_term_size(), guarded by `present_lock`. */
+    bool term_size_set;
+    size_t term_width;
+    size_t term_height;
+
+    bool loop_stop;
+
+    bool init_get_term_opts, init_set_term_opts, init_term;
+};
+
+/* Used by the functions without a context parameter and when a NULL context
+ * is passed. It is bound to stdin/stdout and receives process signals. */
+static struct nt_ctx default_ctx = {
+    .signal_pipe = { -1, -1 },
+    .resize_pipe = { -1, -1 },
+    .custom_event_pipe = { -1, -1 },
+    .term = { .colors = NT_TERM_COLOR_OTHER },
+    .sgr_gen = 1,
+    .keyed_lock = PTHREAD_MUTEX_INITIALIZER,
+    .ready_fd = -1,
+    .deferred_fd = -1,
+    .present_lock = PTHREAD_MUTEX_INITIALIZER,
+    .record_fd = -1
+};
 
-static char* stdout_buff;
-static size_t stdout_buff_pos;
-static size_t stdout_buff_cap;
+static inline struct nt_ctx* nt__ctx_get(struct nt_ctx* ctx)
+{
+    return (ctx != NULL) ? ctx : &default_ctx;
+}
 
-static bool init_get_term_opts, init_set_term_opts,
-            init_sigmask_set, init_sigthread_create,
-            init_sigthread_lock, init_term;
+static void nt__gfx_emitter_select(struct nt_ctx* ctx);
 
-static void nt__clear_pending_sigpipe(void)
+void nt__clear_pending_sigpipe(void)
 {
     sigset_t pending;
     if(sigpending(&pending) != 0)
@@ -69,12 +224,45 @@ static void nt__clear_pending_sigpipe(void)
     sigwait(&set, &signal);
 }
 
-static int nt__write_all(int fd, const void* data, size_t size)
+/* ------------------------------------------------------ */
+/* STATISTICS */
+/* ------------------------------------------------------ */
+
+/* Each counter has one writer, the thread writing output or the one waiting
+ * for events, so a relaxed load and store is enough for other threads to read
+ * it whole, without the cost of an atomic add. */
+static inline void nt__stat_add(uint64_t* counter, uint64_t n)
+{
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + n,
+            __ATOMIC_RELAXED);
+}
+
+static void nt__stat_hist_add(struct nt_stats_hist* hist,
+        unsigned long long us)
+{
+    size_t bucket = 0;
+    while((us > 0) && (bucket < (NT_STATS_HIST_BUCKETS - 1)))
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    nt__stat_add(&hist->counts[bucket], 1);
+}
+
+/* ------------------------------------------------------ */
+
+/* Counts each write() in `calls` if not NULL. */
+static int nt__write_all(int fd, const void* data, size_t size,
+        uint64_t* calls)
 {
     const char* it = data;
 
     while(size > 0)
     {
+        if(calls != NULL)
+            nt__stat_add(calls, 1);
+
         ssize_t written = write(fd, it, size);
         if(written < 0)
         {
@@ -117,12 +305,16 @@ static int nt__write_pipe_event(int fd, const void* data, size_t size)
     return 0;
 }
 
-static int nt__read_exact(int fd, void* data, size_t size)
+/* Counts each read() in `calls` if not NULL. */
+static int nt__read_exact(int fd, void* data, size_t size, uint64_t* calls)
 {
     char* it = data;
 
     while(size > 0)
     {
+        if(calls != NULL)
+            nt__stat_add(calls, 1);
+
         ssize_t read_count = read(fd, it, size);
         if(read_count < 0)
         {
@@ -153,38 +345,327 @@ static int nt__poll_retry(struct pollfd* fds, nfds_t count, int timeout)
     return status;
 }
 
-static inline int nt__write_to_stdout(const char* str, size_t str_len)
+static unsigned long long nt__now_us(void)
+{
+    struct timespec now;
+    if(clock_gettime(CLOCK_MONOTONIC, &now) != 0)
+        return 0;
+
+    return ((unsigned long long)now.tv_sec * 1000000ULL) +
+        ((unsigned long long)now.tv_nsec / 1000ULL);
+}
+
+/* Returns the time on the clock of `ctx`, which may be virtual. */
+static inline unsigned long long nt__clock_us(struct nt_ctx* ctx)
+{
+    return ctx->clock_virtual ? ctx->clock_us : nt__now_us();
+}
+
+/* Writes `size` bytes to the sink of `ctx` if set, otherwise to its output
+ * descriptor. */
+static int nt__output_write(struct nt_ctx* ctx, const void* data, size_t size)
+{
+    if(ctx->verify != NULL)
+        nt__verify_feed(ctx->verify, data, size);
+    if(ctx->tee != NULL)
+        nt__tee_feed(ctx->tee, nt__clock_us(ctx), data, size);
+
+    nt__stat_add(&ctx->stats.bytes_written, size);
+
+    if(ctx->sink == NULL)
+        return nt__write_all(ctx->out_fd, data, size, &ctx->stats.writes);
+
+    if(size == 0)
+        return 0;
+
+    return (ctx->sink(data, size, ctx->sink_data) == 0) ? 0 :
+        NT_ERR_UNEXPECTED;
+}
+
+/* Returns the number of bytes written to the terminal but not yet
+ * transmitted, or 0 if it can't be queried. */
+static size_t nt__output_queued(struct nt_ctx* ctx)
+{
+    if(ctx->sink != NULL)
+        return 0;
+
+#ifdef TIOCOUTQ
+    int queued = 0;
+    if((ioctl(ctx->out_fd, TIOCOUTQ, &queued) == 0) && (queued > 0))
+        return (size_t)queued;
+#endif // TIOCOUTQ
+
+    return 0;
+}
+
+/* Feeds the duration of a buffer flush and the resulting output queue size to
+ * frame pacing. */
+static void nt__present_on_flush(struct nt_ctx* ctx,
+        unsigned long long flush_us, size_t queued);
+
+/* Called after the output buffer was written out, by a flush that began at
+ * `start_us`. Feeds frame pacing, the statistics and verification. */
+static void nt__buffer_on_flush(struct nt_ctx* ctx,
+        unsigned long long start_us)
+{
+    unsigned long long flush_us = nt__clock_us(ctx) - start_us;
+    nt__present_on_flush(ctx, flush_us, nt__output_queued(ctx));
+
+    nt__stat_add(&ctx->stats.flushes, 1);
+    nt__stat_hist_add(&ctx->stats.flush_us, flush_us);
+
+    if(ctx->verify != NULL)
+        nt__verify_on_flush(ctx);
+}
+
+/* Writes out and empties the output buffer. */
+static int nt__buffer_flush(struct nt_ctx* ctx)
+{
+    ctx->frame_bytes = 0;
+
+    if(ctx->out_buff_pos == 0)
+        return 0;
+
+    NT__TRACE_BEGIN(trace);
+    unsigned long long start_us = nt__clock_us(ctx);
+    int status = nt__output_write(ctx,
+            ctx->out_buff, ctx->out_buff_pos);
+
+    /* A failed write may be partial, so the attempted contents cannot
+     * be safely retried as a whole. */
+    ctx->out_buff_pos = 0;
+
+    nt__buffer_on_flush(ctx, start_us);
+
+    NT__TRACE_END(trace, "buffer_flush");
+
+    return status;
+}
+
+static inline int nt__write_out(struct nt_ctx* ctx,
+        const char* str, size_t str_len)
 {
     if(str_len == 0)
         return 0;
 
-    if(stdout_buff == NULL)
-        return nt__write_all(STDOUT_FILENO, str, str_len);
+    ctx->frame_bytes += str_len;
+
+    if(ctx->out_buff == NULL)
+        return nt__output_write(ctx, str, str_len);
 
-    if(stdout_buff_pos + str_len <= stdout_buff_cap)
+    if(ctx->out_buff_pos + str_len <= ctx->out_buff_cap)
     {
-        memcpy(stdout_buff + stdout_buff_pos, str, str_len);
-        stdout_buff_pos += str_len;
+        memcpy(ctx->out_buff + ctx->out_buff_pos, str, str_len);
+        ctx->out_buff_pos += str_len;
         return 0;
     }
 
-    int status = nt__write_all(STDOUT_FILENO, stdout_buff, stdout_buff_pos);
-    stdout_buff_pos = 0;
+    if(ctx->out_buff_pos > 0)
+        nt__stat_add(&ctx->stats.flushes_forced, 1);
+
+    int status = nt__output_write(ctx,
+            ctx->out_buff, ctx->out_buff_pos);
+    ctx->out_buff_pos = 0;
     if(status)
         return status;
 
-    if(str_len <= stdout_buff_cap)
+    if(str_len <= ctx->out_buff_cap)
+    {
+        memcpy(ctx->out_buff, str, str_len);
+        ctx->out_buff_pos = str_len;
+        return 0;
+    }
+
+    return nt__output_write(ctx, str, str_len);
+}
+
+/* ------------------------------------------------------ */
+/* CHUNKS */
+/* ------------------------------------------------------ */
+
+int nt__chunk_put(struct nt__chunk* chunk, const char* str, size_t len)
+{
+    if((chunk->len + len) > chunk->cap)
+    {
+        size_t new_cap = (chunk->cap > 0) ? chunk->cap : 4096;
+        while(new_cap < (chunk->len + len))
+            new_cap *= 2;
+
+        char* new_data = realloc(chunk->data, new_cap);
+        if(new_data == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        chunk->data = new_data;
+        chunk->cap = new_cap;
+    }
+
+    memcpy(chunk->data + chunk->len, str, len);
+    chunk->len += len;
+
+    return 0;
+}
+
+/* Bytes emitted to a chunk are counted in its tally, and added to the
+ * statistics of the context by nt__write_chunks(). Chunks may be encoded on
+ * other threads. */
+static inline int nt__emit(struct nt_ctx* ctx, struct nt__chunk* chunk,
+        const char* str, size_t len, enum nt_stats_bytes stat)
+{
+    if(len == 0)
+        return 0;
+
+    if(chunk != NULL)
+    {
+        if(stat == NT_STATS_BYTES_SGR)
+            chunk->sgr_len += len;
+        else if(stat == NT_STATS_BYTES_CURSOR)
+            chunk->cursor_len += len;
+
+        return nt__chunk_put(chunk, str, len);
+    }
+
+    nt__stat_add(&ctx->stats.bytes[stat], len);
+
+    return nt__write_out(ctx, str, len);
+}
+
+/* Counts each writev() in `calls`. */
+static int nt__writev_all(int fd, struct iovec* iov, int count,
+        uint64_t* calls)
+{
+    while(count > 0)
+    {
+        nt__stat_add(calls, 1);
+
+        ssize_t written = writev(fd, iov, count);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if(errno == EPIPE)
+                nt__clear_pending_sigpipe();
+
+            return NT_ERR_UNEXPECTED;
+        }
+        if(written == 0)
+            return NT_ERR_UNEXPECTED;
+
+        while((count > 0) && ((size_t)written >= iov->iov_len))
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if(count > 0)
+        {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+int nt__write_chunks(struct nt_ctx* ctx,
+        const struct nt__chunk* chunks, size_t count)
+{
+    ctx = nt__ctx_get(ctx);
+
+    size_t total = 0;
+    size_t sgr_len = 0, cursor_len = 0;
+    size_t i;
+    for(i = 0; i < count; i++)
+    {
+        total += chunks[i].len;
+        sgr_len += chunks[i].sgr_len;
+        cursor_len += chunks[i].cursor_len;
+    }
+
+    if(total == 0)
+        return 0;
+
+    nt__stat_add(&ctx->stats.bytes[NT_STATS_BYTES_TEXT],
+            total - sgr_len - cursor_len);
+    nt__stat_add(&ctx->stats.bytes[NT_STATS_BYTES_SGR], sgr_len);
+    nt__stat_add(&ctx->stats.bytes[NT_STATS_BYTES_CURSOR], cursor_len);
+
+    /* Chunks that fit stay in the buffer until the frame is flushed. */
+    if((ctx->out_buff != NULL) &&
+       ((ctx->out_buff_pos + total) <= ctx->out_buff_cap))
     {
-        memcpy(stdout_buff, str, str_len);
-        stdout_buff_pos = str_len;
+        for(i = 0; i < count; i++)
+            nt__write_out(ctx, chunks[i].data, chunks[i].len);
         return 0;
     }
 
-    return nt__write_all(STDOUT_FILENO, str, str_len);
+    if(count > NT__CHUNKS_MAX)
+        return NT_ERR_INVALID_ARG;
+
+    struct iovec iov[NT__CHUNKS_MAX + 1];
+    int iov_count = 0;
+
+    if((ctx->out_buff != NULL) && (ctx->out_buff_pos > 0))
+    {
+        iov[iov_count++] = (struct iovec) {
+            .iov_base = ctx->out_buff,
+            .iov_len = ctx->out_buff_pos
+        };
+        nt__stat_add(&ctx->stats.flushes_forced, 1);
+    }
+    for(i = 0; i < count; i++)
+    {
+        if(chunks[i].len == 0)
+            continue;
+
+        iov[iov_count++] = (struct iovec) {
+            .iov_base = chunks[i].data,
+            .iov_len = chunks[i].len
+        };
+    }
+
+    ctx->frame_bytes += total;
+
+    /* With buffering on, this write takes the place of the flush ending the
+     * frame, so it is accounted as one. */
+    unsigned long long start_us = nt__clock_us(ctx);
+    int status = 0;
+    if(ctx->sink == NULL)
+    {
+        if(ctx->verify != NULL)
+        {
+            for(i = 0; i < (size_t)iov_count; i++)
+                nt__verify_feed(ctx->verify, iov[i].iov_base, iov[i].iov_len);
+        }
+        if(ctx->tee != NULL)
+        {
+            unsigned long long now_us = nt__clock_us(ctx);
+            for(i = 0; i < (size_t)iov_count; i++)
+            {
+                nt__tee_feed(ctx->tee, now_us,
+                        iov[i].iov_base, iov[i].iov_len);
+            }
+        }
+        nt__stat_add(&ctx->stats.bytes_written, total +
+                ((ctx->out_buff != NULL) ? ctx->out_buff_pos : 0));
+        status = nt__writev_all(ctx->out_fd, iov, iov_count,
+                &ctx->stats.writes);
+    }
+    else
+    {
+        for(i = 0; (i < (size_t)iov_count) && (status == 0); i++)
+            status = nt__output_write(ctx, iov[i].iov_base, iov[i].iov_len);
+    }
+    ctx->out_buff_pos = 0;
+
+    if(ctx->out_buff != NULL)
+        nt__buffer_on_flush(ctx, start_us);
+
+    return status;
 }
 
 static void* nt__sigthread_fn(void* data)
 {
+    struct nt_ctx* ctx = data;
     sigset_t set;
     sigfillset(&set);
     int signal = 0;
@@ -201,10 +682,10 @@ static void* nt__sigthread_fn(void* data)
 
         if(sigwait(&set, &signal) != 0)
         {
-            close(resize_pipe[1]);
-            resize_pipe[1] = -1;
-            close(signal_pipe[1]);
-            signal_pipe[1] = -1;
+            close(ctx->resize_pipe[1]);
+            ctx->resize_pipe[1] = -1;
+            close(ctx->signal_pipe[1]);
+            ctx->signal_pipe[1] = -1;
             break;
         }
 
@@ -212,27 +693,27 @@ static void* nt__sigthread_fn(void* data)
         if(signal == SIGWINCH)
         {
             if(nt__write_pipe_event(
-                    resize_pipe[1],
+                    ctx->resize_pipe[1],
                     &usignal,
                     sizeof(unsigned int)))
             {
-                close(resize_pipe[1]);
-                resize_pipe[1] = -1;
-                close(signal_pipe[1]);
-                signal_pipe[1] = -1;
+                close(ctx->resize_pipe[1]);
+                ctx->resize_pipe[1] = -1;
+                close(ctx->signal_pipe[1]);
+                ctx->signal_pipe[1] = -1;
                 break;
             }
         }
 
         if(nt__write_pipe_event(
-                signal_pipe[1],
+                ctx->signal_pipe[1],
                 &usignal,
                 sizeof(unsigned int)))
         {
-            close(resize_pipe[1]);
-            resize_pipe[1] = -1;
-            close(signal_pipe[1]);
-            signal_pipe[1] = -1;
+            close(ctx->resize_pipe[1]);
+            ctx->resize_pipe[1] = -1;
+            close(ctx->signal_pipe[1]);
+            ctx->signal_pipe[1] = -1;
             break;
         }
     }
@@ -253,99 +734,188 @@ static inline void nt__term_opts_raw(struct termios* term_opts)
     term_opts->c_cc[VTIME] = 0;
 }
 
-static void nt__init_default_values(void)
+/* Resets everything but the locks. */
+static void nt__init_default_values(struct nt_ctx* ctx)
 {
-    sigthread = 0;
-    sigthread_stop = false;
-
-    signal_pipe[0] = -1;
-    signal_pipe[1] = -1;
-    resize_pipe[0] = -1;
-    resize_pipe[1] = -1;
-    custom_event_pipe[0] = -1;
-    custom_event_pipe[1] = -1;
+    ctx->in_fd = -1;
+    ctx->out_fd = -1;
+
+    ctx->signal_pipe[0] = -1;
+    ctx->signal_pipe[1] = -1;
+    ctx->resize_pipe[0] = -1;
+    ctx->resize_pipe[1] = -1;
+    ctx->custom_event_pipe[0] = -1;
+    ctx->custom_event_pipe[1] = -1;
     
     size_t i;
     for(i = 0; i < POLL_FD_COUNT; i++)
-        poll_fds[i] = (struct pollfd) {0};
+        ctx->poll_fds[i] = (struct pollfd) { .fd = -1 };
         
-    init_term_opts = (struct termios) {0};
+    ctx->init_term_opts = (struct termios) {0};
 
-    stdout_buff = NULL;
-    stdout_buff_pos = 0;
-    stdout_buff_cap = 0;
+    nt__term_deinit(&ctx->term);
 
-    init_get_term_opts = false;
-    init_set_term_opts = false;
-    init_sigmask_set = false;
-    init_sigthread_create = false;
-    init_sigthread_lock = false;
-    init_term = false;
-}
+    ctx->out_buff = NULL;
+    ctx->out_buff_pos = 0;
+    ctx->out_buff_cap = 0;
 
-int nt_init(void)
-{
-    nt__init_default_values();
+    ctx->sink = NULL;
+    ctx->sink_data = NULL;
 
-    int status;
+    ctx->verify = NULL;
+    ctx->tee = NULL;
 
-    status = tcgetattr(STDIN_FILENO, &init_term_opts);
-    if(status == -1)
-    {
-        nt_deinit();
-        return NT_ERR_UNEXPECTED;
-    }
-    init_get_term_opts = true;
+    ctx->stats = (struct nt_stats) {0};
+
+    ctx->clock_virtual = false;
+    ctx->clock_us = 0;
 
-    struct termios raw_opts = init_term_opts;
+    ctx->record_fd = -1;
+    ctx->record_start_us = 0;
+    ctx->record = (struct nt__chunk) {0};
+
+    ctx->frame_bytes = 0;
+    ctx->frame_budget = 0;
+    ctx->color_enc = NT_COLOR_ENC_DEFAULT;
+    ctx->gfx_emitter = NULL;
+
+    ctx->sgrs = NULL;
+    ctx->sgr_cap = 0;
+    ctx->sgr_gen = 1;
+
+    ctx->keyed_slots = NULL;
+    ctx->keyed_count = 0;
+    ctx->keyed_cap = 0;
+
+    ctx->deferred = NULL;
+    ctx->deferred_count = 0;
+    ctx->deferred_cap = 0;
+
+    ctx->ready_fd = -1;
+    ctx->deferred_fd = -1;
+    ctx->deferred_fd_set = false;
+
+    ctx->present_requested = false;
+    ctx->present_token = false;
+    ctx->present_waiter_set = false;
+    ctx->present_target_us = 1000000ULL / NT_PRESENT_FPS_DEFAULT;
+    ctx->present_interval_us = ctx->present_target_us;
+    ctx->present_last_us = 0;
+    ctx->present_flush_avg_us = 0;
+
+    ctx->output_queued = 0;
+    ctx->output_flush_us = 0;
+    ctx->output_congestion_limit = NT_OUTPUT_CONGESTION_LIMIT_DEFAULT;
+    ctx->output_congested = false;
+
+    ctx->term_size_set = false;
+    ctx->term_width = 0;
+    ctx->term_height = 0;
+
+    ctx->loop_stop = false;
+
+    ctx->init_get_term_opts = false;
+    ctx->init_set_term_opts = false;
+    ctx->init_term = false;
+}
+
+/* Puts `in_fd` into raw mode. `required` makes failing to read its settings an
+ * error, otherwise a non-terminal `in_fd` is left as it is. */
+static int nt__ctx_init_term_opts(struct nt_ctx* ctx, bool required)
+{
+    if(tcgetattr(ctx->in_fd, &ctx->init_term_opts) == -1)
+        return required ? NT_ERR_UNEXPECTED : 0;
+    ctx->init_get_term_opts = true;
+
+    struct termios raw_opts = ctx->init_term_opts;
     nt__term_opts_raw(&raw_opts);
-    status = tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw_opts);
-    if(status == -1)
-    {
-        nt_deinit();
+    if(tcsetattr(ctx->in_fd, TCSAFLUSH, &raw_opts) == -1)
         return NT_ERR_UNEXPECTED;
-    }
-    init_set_term_opts = true;
+    ctx->init_set_term_opts = true;
 
-    if(pipe(signal_pipe) != 0)
-    {
-        nt_deinit();
+    return 0;
+}
+
+/* Opens the event pipes and sets up `poll_fds`. The signal pipe is only
+ * opened if `signals` is set. */
+static int nt__ctx_init_pipes(struct nt_ctx* ctx, bool signals)
+{
+    if(signals && (pipe(ctx->signal_pipe) != 0))
         return NT_ERR_INIT_PIPE;
-    }
 
-    if(pipe(custom_event_pipe) != 0)
-    {
-        nt_deinit();
+    if(pipe(ctx->custom_event_pipe) != 0)
         return NT_ERR_INIT_PIPE;
-    }
 
-    if(pipe(resize_pipe) != 0)
-    {
-        nt_deinit();
+    if(pipe(ctx->resize_pipe) != 0)
         return NT_ERR_INIT_PIPE;
-    }
 
-    poll_fds[STDIN_POLL_FD] = (struct pollfd) {
-        .fd = STDIN_FILENO,
+    ctx->poll_fds[STDIN_POLL_FD] = (struct pollfd) {
+        .fd = ctx->in_fd,
         .events = POLLIN,
         .revents = 0
     };
-    poll_fds[RESIZE_POLL_FD] = (struct pollfd) {
-        .fd = resize_pipe[0],
+    ctx->poll_fds[RESIZE_POLL_FD] = (struct pollfd) {
+        .fd = ctx->resize_pipe[0],
         .events = POLLIN,
         .revents = 0
     };
-    poll_fds[SIGNAL_POLL_FD] = (struct pollfd) {
-        .fd = signal_pipe[0],
+    ctx->poll_fds[SIGNAL_POLL_FD] = (struct pollfd) {
+        .fd = ctx->signal_pipe[0],
         .events = POLLIN,
         .revents = 0
     };
-    poll_fds[CUSTOM_POLL_FD] = (struct pollfd) {
-        .fd = custom_event_pipe[0],
+    ctx->poll_fds[CUSTOM_POLL_FD] = (struct pollfd) {
+        .fd = ctx->custom_event_pipe[0],
         .events = POLLIN,
         .revents = 0
     };
 
+    return 0;
+}
+
+static int nt__ctx_init_term(struct nt_ctx* ctx,
+        const char* term, const char* colorterm)
+{
+    int status = nt__term_init(&ctx->term, term, colorterm);
+    switch(status)
+    {
+        case 0:
+        case NT_ERR_TERM_NOT_SUPP:
+            ctx->init_term = true;
+            nt__gfx_emitter_select(ctx);
+            return status;
+        case NT_ERR_INIT_TERM_ENV:
+            return NT_ERR_INIT_TERM_ENV;
+        default:
+            return NT_ERR_UNEXPECTED;
+    }
+}
+
+static void nt__ctx_deinit(struct nt_ctx* ctx);
+
+int nt_init(void)
+{
+    struct nt_ctx* ctx = &default_ctx;
+    nt__init_default_values(ctx);
+    ctx->in_fd = STDIN_FILENO;
+    ctx->out_fd = STDOUT_FILENO;
+
+    int status;
+
+    status = nt__ctx_init_term_opts(ctx, true);
+    if(status != 0)
+    {
+        nt_deinit();
+        return status;
+    }
+
+    status = nt__ctx_init_pipes(ctx, true);
+    if(status != 0)
+    {
+        nt_deinit();
+        return status;
+    }
+
     sigset_t set;
     sigfillset(&set);
     if(pthread_sigmask(SIG_BLOCK, &set, NULL) != 0)
@@ -362,37 +932,121 @@ int nt_init(void)
     }
     init_sigthread_lock = true;
 
-    if(pthread_create(&sigthread, NULL, nt__sigthread_fn, NULL) != 0)
+    sigthread_stop = false;
+    if(pthread_create(&sigthread, NULL, nt__sigthread_fn, ctx) != 0)
     {
         nt_deinit();
         return NT_ERR_UNEXPECTED;
     }
     init_sigthread_create = true;
 
-    status = nt__term_init();
-    switch(status)
-    {
-        case 0:
-            init_term = true;
-            return 0;
-        case NT_ERR_TERM_NOT_SUPP:
-            init_term = true;
-            return NT_ERR_TERM_NOT_SUPP;
-        case NT_ERR_INIT_TERM_ENV:
-            nt_deinit();
-            return NT_ERR_INIT_TERM_ENV;
-        default:
-            nt_deinit();
-            return NT_ERR_UNEXPECTED;
-    }
+    status = nt__ctx_init_term(ctx, getenv("TERM"), getenv("COLORTERM"));
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+        nt_deinit();
+
+    return status;
 }
 
-static void nt__close_pipe(int p[2])
+int nt_ctx_new(int in_fd, int out_fd, const char* term, const char* colorterm,
+        struct nt_ctx** out_ctx)
 {
-    if(p[0] >= 0) { close(p[0]); p[0] = -1; }
+    if((out_ctx == NULL) || (in_fd < -1) || (out_fd < -1))
+        return NT_ERR_INVALID_ARG;
+
+    struct nt_ctx* ctx = malloc(sizeof(struct nt_ctx));
+    if(ctx == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    if(pthread_mutex_init(&ctx->keyed_lock, NULL) != 0)
+    {
+        free(ctx);
+        return NT_ERR_UNEXPECTED;
+    }
+    if(pthread_mutex_init(&ctx->present_lock, NULL) != 0)
+    {
+        pthread_mutex_destroy(&ctx->keyed_lock);
+        free(ctx);
+        return NT_ERR_UNEXPECTED;
+    }
+
+    nt__init_default_values(ctx);
+    ctx->in_fd = in_fd;
+    ctx->out_fd = out_fd;
+
+    int status;
+
+    status = nt__ctx_init_term_opts(ctx, false);
+    if(status == 0)
+        status = nt__ctx_init_pipes(ctx, false);
+    if(status == 0)
+        status = nt__ctx_init_term(ctx, term, colorterm);
+
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        nt_ctx_destroy(ctx);
+        return status;
+    }
+
+    *out_ctx = ctx;
+
+    return status;
+}
+
+/* Releases pooled payloads of events left in the custom event pipe. */
+static void nt__release_pending_payloads(struct nt_ctx* ctx);
+
+static void nt__close_pipe(int p[2])
+{
+    if(p[0] >= 0) { close(p[0]); p[0] = -1; }
     if(p[1] >= 0) { close(p[1]); p[1] = -1; }
 }
 
+static void nt__ctx_deinit(struct nt_ctx* ctx)
+{
+    if(ctx->init_term)
+    {
+        nt_ctx_write_str(ctx, "", 0, NT_GFX_DEFAULT);
+
+        nt__term_deinit(&ctx->term);
+        ctx->init_term = false;
+    }
+    if(ctx->init_set_term_opts)
+    {
+        tcsetattr(ctx->in_fd, TCSAFLUSH, &ctx->init_term_opts);
+        ctx->init_set_term_opts = false;
+    }
+
+    nt__release_pending_payloads(ctx);
+
+    size_t i;
+    for(i = 0; i < ctx->deferred_count; i++)
+        nt_event_payload_release(nt_event_get_payload(&ctx->deferred[i]));
+    free(ctx->deferred);
+    ctx->deferred = NULL;
+
+    if(ctx->ready_fd >= 0) close(ctx->ready_fd);
+    if(ctx->deferred_fd >= 0) close(ctx->deferred_fd);
+
+    nt__close_pipe(ctx->signal_pipe);
+    nt__close_pipe(ctx->custom_event_pipe);
+    nt__close_pipe(ctx->resize_pipe);
+
+    pthread_mutex_lock(&ctx->keyed_lock);
+    free(ctx->keyed_slots);
+    ctx->keyed_slots = NULL;
+    pthread_mutex_unlock(&ctx->keyed_lock);
+
+    for(i = 0; i < ctx->sgr_cap; i++)
+        free(ctx->sgrs[i].seq);
+    free(ctx->sgrs);
+
+    nt__verify_destroy(ctx->verify);
+    nt__tee_destroy(ctx->tee);
+    free(ctx->record.data);
+
+    nt__init_default_values(ctx);
+}
+
 void nt_deinit(void)
 {
     if(init_sigthread_create)
@@ -411,18 +1065,15 @@ void nt_deinit(void)
         pthread_mutex_destroy(&sigthread_lock);
         init_sigthread_lock = false;
     }
-    if(init_term)
-    {
-        nt_write_str("", 0, NT_GFX_DEFAULT);
 
-        nt__term_deinit();
-        init_term = false;
-    }
-    if(init_set_term_opts)
-    {
-        tcsetattr(STDIN_FILENO, TCSAFLUSH, &init_term_opts);
-        init_set_term_opts = false;
-    }
+    nt__ctx_deinit(&default_ctx);
+
+    /* The pool is shared by all contexts, so only the library trims it. */
+    nt__payload_pool_trim();
+
+    /* Parked present workers would outlive the library otherwise. */
+    nt_grid_set_present_threads(1);
+
     if(init_sigmask_set)
     {
         sigset_t set;
@@ -430,84 +1081,148 @@ void nt_deinit(void)
         pthread_sigmask(SIG_SETMASK, &set, NULL);
         init_sigmask_set = false;
     }
+}
+
+void nt_ctx_destroy(struct nt_ctx* ctx)
+{
+    if((ctx == NULL) || (ctx == &default_ctx))
+        return;
+
+    nt__ctx_deinit(ctx);
+    pthread_mutex_destroy(&ctx->keyed_lock);
+    pthread_mutex_destroy(&ctx->present_lock);
+    free(ctx);
+}
 
-    nt__close_pipe(signal_pipe);
-    nt__close_pipe(custom_event_pipe);
-    nt__close_pipe(resize_pipe);
+bool* nt__ctx_loop_stop(struct nt_ctx* ctx)
+{
+    return &nt__ctx_get(ctx)->loop_stop;
+}
+
+struct nt__verify** nt__ctx_verify(struct nt_ctx* ctx)
+{
+    return &nt__ctx_get(ctx)->verify;
+}
+
+struct nt__tee** nt__ctx_tee(struct nt_ctx* ctx)
+{
+    return &nt__ctx_get(ctx)->tee;
+}
 
-    nt__init_default_values();
+unsigned long long nt__ctx_clock_us(struct nt_ctx* ctx)
+{
+    return nt__clock_us(nt__ctx_get(ctx));
 }
 
 /* -------------------------------------------------------------------------- */
 /* TERMINAL FUNCTIONS */
 /* -------------------------------------------------------------------------- */
 
+static enum nt_stats_bytes nt__esc_func_stat(enum nt_esc_func func)
+{
+    switch(func)
+    {
+        case NT_ESC_FUNC_CURSOR_SHOW:
+        case NT_ESC_FUNC_CURSOR_HIDE:
+        case NT_ESC_FUNC_CURSOR_MOVE:
+            return NT_STATS_BYTES_CURSOR;
+        case NT_ESC_FUNC_ERASE_SCREEN:
+        case NT_ESC_FUNC_ERASE_SCROLLBACK:
+        case NT_ESC_FUNC_ERASE_LINE:
+            return NT_STATS_BYTES_ERASE;
+        case NT_ESC_FUNC_ALT_BUFF_ENTER:
+        case NT_ESC_FUNC_ALT_BUFF_EXIT:
+        case NT_ESC_FUNC_MOUSE_ENABLE:
+        case NT_ESC_FUNC_MOUSE_DISABLE:
+        case NT_ESC_FUNC_OTHER:
+            return NT_STATS_BYTES_OTHER;
+        default:
+            return NT_STATS_BYTES_SGR;
+    }
+}
+
+static inline int nt__write_func(struct nt_ctx* ctx, enum nt_esc_func func,
+        const char* seq, size_t len)
+{
+    nt__stat_add(&ctx->stats.bytes[nt__esc_func_stat(func)], len);
+
+    return nt__write_out(ctx, seq, len);
+}
+
+/* Functions without parameters are served from the escape sequence cache. */
 static int nt__execute_used_term_func(
+        struct nt_ctx* ctx,
         enum nt_esc_func func,
         int use_va,
         ...)
 {
     int status;
 
-    struct nt_term_info used_term = nt__term_get_used();
+    if(!use_va)
+    {
+        const struct nt__esc_frag* frag = &ctx->term.esc_cache.funcs[func];
+        if(frag->len == 0)
+            return NT_ERR_FUNC_NOT_SUPP;
+
+        return nt__write_func(ctx, func, frag->seq, frag->len);
+    }
+
+    const struct nt_term_info* used_term = &ctx->term.info;
+    if(used_term->esc_func_seqs == NULL)
+        return NT_ERR_FUNC_NOT_SUPP;
 
-    const char* esc_func = used_term.esc_func_seqs[func];
+    const char* esc_func = used_term->esc_func_seqs[func];
     if(esc_func == NULL)
         return NT_ERR_FUNC_NOT_SUPP;
 
-    const char* term_func;
     char buff[100];
-    if(use_va)
-    {
-        va_list list;
-        va_start(list, use_va);
-
-        status = vsnprintf(buff, sizeof(buff), esc_func, list);
-        va_end(list);
-        if((status < 0) || ((size_t)status >= sizeof(buff)))
-            return NT_ERR_UNEXPECTED;
+    va_list list;
+    va_start(list, use_va);
 
-        term_func = buff;
-    }
-    else
-    {
-        term_func = esc_func;
-    }
+    status = vsnprintf(buff, sizeof(buff), esc_func, list);
+    va_end(list);
+    if((status < 0) || ((size_t)status >= sizeof(buff)))
+        return NT_ERR_UNEXPECTED;
 
-    return nt__write_to_stdout(term_func, strlen(term_func));
+    return nt__write_func(ctx, func, buff, (size_t)status);
 }
 
 /* -------------------------------------------------------------------------- */
 
-int nt_buffer_enable(char* buff, size_t cap)
+int nt_ctx_buffer_enable(struct nt_ctx* ctx, char* buff, size_t cap)
 {
+    ctx = nt__ctx_get(ctx);
+
     if((buff == NULL) || (cap == 0))
         return NT_ERR_INVALID_ARG;
 
-    if(stdout_buff != NULL)
+    if(ctx->out_buff != NULL)
         return NT_ERR_ALR_BUFF;
 
-    stdout_buff = buff;
-    stdout_buff_cap = cap;
-    stdout_buff_pos = 0;
+    ctx->out_buff = buff;
+    ctx->out_buff_cap = cap;
+    ctx->out_buff_pos = 0;
 
     return 0;
 }
 
-int nt_buffer_disable(enum nt_buffact buffact, char** out_buff)
+int nt_ctx_buffer_disable(struct nt_ctx* ctx,
+        enum nt_buffact buffact, char** out_buff)
 {
-    char* old = stdout_buff;
+    ctx = nt__ctx_get(ctx);
+
+    char* old = ctx->out_buff;
     int status = 0;
 
-    if(stdout_buff != NULL)
+    if(ctx->out_buff != NULL)
     {
-        if((buffact == NT_BUFF_FLUSH) && (stdout_buff_pos > 0))
-            status = nt__write_all(STDOUT_FILENO, stdout_buff, stdout_buff_pos);
+        if(buffact == NT_BUFF_FLUSH)
+            status = nt__buffer_flush(ctx);
 
         /* Disable buffering regardless of the flush result. */
-        stdout_buff = NULL;
-        stdout_buff_pos = 0;
-        stdout_buff_cap = 0;
+        ctx->out_buff = NULL;
+        ctx->out_buff_pos = 0;
+        ctx->out_buff_cap = 0;
     }
 
     if(out_buff != NULL)
@@ -516,257 +1231,571 @@ int nt_buffer_disable(enum nt_buffact buffact, char** out_buff)
     return status;
 }
 
-int nt_buffer_flush(void)
+int nt_ctx_buffer_flush(struct nt_ctx* ctx)
 {
-    int status = 0;
+    return nt__buffer_flush(nt__ctx_get(ctx));
+}
 
-    if((stdout_buff != NULL) && (stdout_buff_pos > 0))
-    {
-        status = nt__write_all(STDOUT_FILENO, stdout_buff, stdout_buff_pos);
+size_t nt__output_buffered(struct nt_ctx* ctx)
+{
+    return nt__ctx_get(ctx)->out_buff_pos;
+}
+
+/* ----------------------------------------------------- */
+
+void nt_ctx_output_set_sink(struct nt_ctx* ctx,
+        nt_output_sink sink, void* sink_data)
+{
+    ctx = nt__ctx_get(ctx);
+
+    ctx->sink = sink;
+    ctx->sink_data = (sink != NULL) ? sink_data : NULL;
+}
 
-        /* A failed write may be partial, so the attempted contents cannot
-         * be safely retried as a whole. */
-        stdout_buff_pos = 0;
+int nt_mem_sink_write(const char* data, size_t len, void* sink_data)
+{
+    struct nt_mem_sink* mem = sink_data;
+
+    if(len > (mem->cap - mem->len))
+    {
+        mem->overflow = true;
+        return NT_ERR_OUT_OF_BOUNDS;
     }
 
-    return status;
+    memcpy(mem->buff + mem->len, data, len);
+    mem->len += len;
+
+    return 0;
+}
+
+int nt_ctx_render_to(struct nt_ctx* ctx, nt_render_fn render, void* data,
+        char* buff, size_t cap, size_t* out_len)
+{
+    if(out_len != NULL)
+        *out_len = 0;
+    if((render == NULL) || ((buff == NULL) && (cap > 0)))
+        return NT_ERR_INVALID_ARG;
+
+    ctx = nt__ctx_get(ctx);
+
+    struct nt_mem_sink mem = { .buff = buff, .cap = cap };
+
+    /* The output buffer and sink are set aside, so `buff` receives exactly
+     * what `render` writes. The frame budget only counts those bytes. They
+     * aren't recorded or fed to the verification model since they don't reach
+     * the terminal, and frames presented by `render` aren't checked. */
+    nt_output_sink old_sink = ctx->sink;
+    struct nt__tee* old_tee = ctx->tee;
+    struct nt__verify* old_verify = ctx->verify;
+    void* old_sink_data = ctx->sink_data;
+    char* old_buff = ctx->out_buff;
+    size_t old_buff_pos = ctx->out_buff_pos;
+    size_t old_buff_cap = ctx->out_buff_cap;
+    size_t old_frame_bytes = ctx->frame_bytes;
+    uint64_t old_stats[NT_STATS_BYTES_COUNT + 1];
+    memcpy(old_stats, ctx->stats.bytes, sizeof(ctx->stats.bytes));
+    old_stats[NT_STATS_BYTES_COUNT] = ctx->stats.bytes_written;
+
+    ctx->sink = nt_mem_sink_write;
+    ctx->sink_data = &mem;
+    ctx->tee = NULL;
+    ctx->verify = NULL;
+    ctx->out_buff = NULL;
+    ctx->out_buff_pos = 0;
+    ctx->out_buff_cap = 0;
+    ctx->frame_bytes = 0;
+
+    int status = render(data);
+
+    ctx->sink = old_sink;
+    ctx->sink_data = old_sink_data;
+    ctx->tee = old_tee;
+    ctx->verify = old_verify;
+    ctx->out_buff = old_buff;
+    ctx->out_buff_pos = old_buff_pos;
+    ctx->out_buff_cap = old_buff_cap;
+    ctx->frame_bytes = old_frame_bytes;
+
+    /* The bytes never reached the terminal, so they aren't counted. */
+    size_t i;
+    for(i = 0; i < NT_STATS_BYTES_COUNT; i++)
+        __atomic_store_n(&ctx->stats.bytes[i], old_stats[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&ctx->stats.bytes_written, old_stats[NT_STATS_BYTES_COUNT],
+            __ATOMIC_RELAXED);
+
+    if(out_len != NULL)
+        *out_len = mem.len;
+
+    return mem.overflow ? NT_ERR_OUT_OF_BOUNDS : status;
 }
 
 /* ----------------------------------------------------- */
 
-int nt_cursor_hide(void)
+int nt_ctx_cursor_hide(struct nt_ctx* ctx)
 {
-    return nt__execute_used_term_func(NT_ESC_FUNC_CURSOR_HIDE, false);
+    return nt__execute_used_term_func(nt__ctx_get(ctx),
+            NT_ESC_FUNC_CURSOR_HIDE, false);
 }
 
-int nt_cursor_show(void)
+int nt_ctx_cursor_show(struct nt_ctx* ctx)
 {
-    return nt__execute_used_term_func(NT_ESC_FUNC_CURSOR_SHOW, false);
+    return nt__execute_used_term_func(nt__ctx_get(ctx),
+            NT_ESC_FUNC_CURSOR_SHOW, false);
 }
 
-int nt_cursor_move(size_t x, size_t y)
+int nt_ctx_cursor_move(struct nt_ctx* ctx, size_t x, size_t y)
 {
-    return nt__execute_used_term_func(
-            NT_ESC_FUNC_CURSOR_MOVE, true, y + 1, x + 1);
+    return nt__encode_cursor_move(ctx, NULL, x, y);
 }
 
-int nt_erase_screen(void)
+int nt__encode_cursor_move(struct nt_ctx* ctx, struct nt__chunk* chunk,
+        size_t x, size_t y)
 {
-    int status = nt__execute_used_term_func(NT_ESC_FUNC_BG_SET_DEFAULT, false);
-    if(status != 0)
-        return status;
+    ctx = nt__ctx_get(ctx);
+
+    if((x >= INT_MAX) || (y >= INT_MAX))
+        return NT_ERR_INVALID_ARG;
+
+    const struct nt_term_info* used_term = &ctx->term.info;
+    if(used_term->esc_func_seqs == NULL)
+        return NT_ERR_FUNC_NOT_SUPP;
 
-    return nt__execute_used_term_func(NT_ESC_FUNC_ERASE_SCREEN, false);
+    const char* esc_func = used_term->esc_func_seqs[NT_ESC_FUNC_CURSOR_MOVE];
+    if(esc_func == NULL)
+        return NT_ERR_FUNC_NOT_SUPP;
+
+    char buff[100];
+    int status = snprintf(buff, sizeof(buff), esc_func,
+            (int)(y + 1), (int)(x + 1));
+    if((status < 0) || ((size_t)status >= sizeof(buff)))
+        return NT_ERR_UNEXPECTED;
+
+    return nt__emit(ctx, chunk, buff, (size_t)status, NT_STATS_BYTES_CURSOR);
 }
 
-int nt_erase_line(void)
+/* Sets the default background, then erases with `func`. */
+static int nt__erase(struct nt_ctx* ctx, enum nt_esc_func func)
 {
-    int status = nt__execute_used_term_func(NT_ESC_FUNC_BG_SET_DEFAULT, false);
+    int status = nt__execute_used_term_func(ctx,
+            NT_ESC_FUNC_BG_SET_DEFAULT, false);
     if(status != 0)
         return status;
 
-    return nt__execute_used_term_func(NT_ESC_FUNC_ERASE_LINE, false);
+    return nt__execute_used_term_func(ctx, func, false);
 }
 
-int nt_erase_scrollback(void)
+int nt_ctx_erase_screen(struct nt_ctx* ctx)
 {
-    int status = nt__execute_used_term_func(NT_ESC_FUNC_BG_SET_DEFAULT, false);
-    if(status != 0)
-        return status;
+    return nt__erase(nt__ctx_get(ctx), NT_ESC_FUNC_ERASE_SCREEN);
+}
 
-    return nt__execute_used_term_func(NT_ESC_FUNC_ERASE_SCROLLBACK, false);
+int nt_ctx_erase_line(struct nt_ctx* ctx)
+{
+    return nt__erase(nt__ctx_get(ctx), NT_ESC_FUNC_ERASE_LINE);
 }
 
-int nt_alt_screen_enable(void)
+int nt_ctx_erase_scrollback(struct nt_ctx* ctx)
 {
-    return nt__execute_used_term_func(NT_ESC_FUNC_ALT_BUFF_ENTER, false);
+    return nt__erase(nt__ctx_get(ctx), NT_ESC_FUNC_ERASE_SCROLLBACK);
 }
 
-int nt_alt_screen_disable(void)
+int nt_ctx_alt_screen_enable(struct nt_ctx* ctx)
 {
-    return nt__execute_used_term_func(NT_ESC_FUNC_ALT_BUFF_EXIT, false);
+    return nt__execute_used_term_func(nt__ctx_get(ctx),
+            NT_ESC_FUNC_ALT_BUFF_ENTER, false);
 }
 
-int nt_mouse_mode_enable(void)
+int nt_ctx_alt_screen_disable(struct nt_ctx* ctx)
 {
-    return nt__execute_used_term_func(NT_ESC_FUNC_MOUSE_ENABLE, false);
+    return nt__execute_used_term_func(nt__ctx_get(ctx),
+            NT_ESC_FUNC_ALT_BUFF_EXIT, false);
 }
 
-int nt_mouse_mode_disable(void)
+int nt_ctx_mouse_mode_enable(struct nt_ctx* ctx)
 {
-    return nt__execute_used_term_func(NT_ESC_FUNC_MOUSE_DISABLE, false);
+    return nt__execute_used_term_func(nt__ctx_get(ctx),
+            NT_ESC_FUNC_MOUSE_ENABLE, false);
 }
 
-void nt_get_term_size(size_t* out_width, size_t* out_height)
+int nt_ctx_mouse_mode_disable(struct nt_ctx* ctx)
+{
+    return nt__execute_used_term_func(nt__ctx_get(ctx),
+            NT_ESC_FUNC_MOUSE_DISABLE, false);
+}
+
+void nt_ctx_get_term_size(struct nt_ctx* ctx,
+        size_t* out_width, size_t* out_height)
 {
+    ctx = nt__ctx_get(ctx);
+
     struct winsize size;
-    int status = ioctl(STDIN_FILENO, TIOCGWINSZ, &size);
+    int status;
     size_t ret_width, ret_height;
-    if(status == -1)
-    {
-        ret_width = 0;
-        ret_height = 0;
-    }
-    else
+
+    pthread_mutex_lock(&ctx->present_lock);
+    bool size_set = ctx->term_size_set;
+    ret_width = ctx->term_width;
+    ret_height = ctx->term_height;
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    if(!size_set)
     {
-        ret_width = size.ws_col;
-        ret_height = size.ws_row;
+        status = ioctl(ctx->in_fd, TIOCGWINSZ, &size);
+        if(status == -1)
+        {
+            ret_width = 0;
+            ret_height = 0;
+        }
+        else
+        {
+            ret_width = size.ws_col;
+            ret_height = size.ws_row;
+        }
     }
 
     if(out_width != NULL) *out_width = ret_width;
     if(out_height != NULL) *out_height = ret_height;
 }
 
+int nt_ctx_set_term_size(struct nt_ctx* ctx, size_t width, size_t height)
+{
+    ctx = nt__ctx_get(ctx);
+
+    pthread_mutex_lock(&ctx->present_lock);
+    ctx->term_size_set = true;
+    ctx->term_width = width;
+    ctx->term_height = height;
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    /* Resizes are coalesced when read, so the value doesn't matter. */
+    unsigned int token = 0;
+    return nt__write_pipe_event(ctx->resize_pipe[1], &token, sizeof(token));
+}
+
 /* ------------------------------------------------------------------------- */
 /* WRITE TO TERMINAL */
 /* ------------------------------------------------------------------------- */
 
-/* This function assumes:
- * 1) The terminal has the capability to set default fg and bg colors.
- * 2) If the terminal supports RGB, then the library holds the terminal's
- * esc sequence to set the RGB color for bg/fg. Same with 256 colors and
- * 8 colors */
-static int nt__set_gfx(struct nt_gfx gfx)
+void nt_ctx_output_set_color_enc(struct nt_ctx* ctx, enum nt_color_enc enc)
 {
-    int status;
-    nt_term_color_count colors = nt__term_get_color_count();
+    ctx = nt__ctx_get(ctx);
+
+    ctx->color_enc = enc;
+    nt__gfx_emitter_select(ctx);
+}
+
+bool nt__encode_is_exact(struct nt_ctx* ctx)
+{
+    ctx = nt__ctx_get(ctx);
+
+    return ((ctx->frame_budget == 0) && (ctx->gfx_emitter != NULL));
+}
+
+void nt_ctx_output_set_frame_budget(struct nt_ctx* ctx, size_t budget)
+{
+    nt__ctx_get(ctx)->frame_budget = budget;
+}
+
+/* Returns the color mode to draw with, lowered if the frame is over budget. */
+static nt_term_color_count nt__get_frame_color_count(struct nt_ctx* ctx)
+{
+    nt_term_color_count colors = ctx->term.colors;
+
+    if((ctx->frame_budget == 0) || (ctx->frame_bytes <= ctx->frame_budget) ||
+       (colors == NT_TERM_COLOR_OTHER))
+        return colors;
+
+    nt_term_color_count cap = (ctx->frame_bytes <= (ctx->frame_budget * 2)) ?
+        NT_TERM_COLOR_C256 : NT_TERM_COLOR_C8;
+
+    return (colors > cap) ? cap : colors;
+}
 
-    /* Set foreground --------------------------------------------------- */
+/* Standard xterm channel levels of the 6x6x6 color cube (entries 16-231). */
+static const uint8_t cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
 
-    if(nt_color_are_eql(NT_COLOR_DEFAULT, gfx.fg))
+/* Finds the palette entry in range [16, 255] whose standard xterm value is
+ * exactly `rgb`. */
+static bool nt__rgb_to_c256_exact(struct nt_rgb rgb, uint8_t* out_code)
+{
+    if((rgb.r == rgb.g) && (rgb.g == rgb.b) && (rgb.r >= 8) &&
+       (((rgb.r - 8) % 10) == 0) && (((rgb.r - 8) / 10) < 24))
     {
-        status = nt__execute_used_term_func(NT_ESC_FUNC_FG_SET_DEFAULT, false);
+        *out_code = 232 + ((rgb.r - 8) / 10);
+        return true;
     }
-    else
-    {
-        gfx.fg = (gfx.fg.code8 <= NT_COLOR_C8_WHITE) ? gfx.fg : NT_COLOR_DEFAULT;
 
-        if(colors == NT_TERM_COLOR_TC)
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_FG_SET_RGB,
-                    true,
-                    gfx.fg.rgb.r,
-                    gfx.fg.rgb.g,
-                    gfx.fg.rgb.b);
-        }
-        else if(colors == NT_TERM_COLOR_C256)
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_FG_SET_C256,
-                    true,
-                    gfx.fg.code256);
-        }
-        else if(colors == NT_TERM_COLOR_C8)
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_FG_SET_C8,
-                    true,
-                    gfx.fg.code8);
-        }
-        else
+    const uint8_t channels[3] = { rgb.r, rgb.g, rgb.b };
+    uint8_t code = 16;
+    const uint8_t weights[3] = { 36, 6, 1 };
+    size_t i, j;
+    for(i = 0; i < 3; i++)
+    {
+        for(j = 0; j < 6; j++)
         {
-            return NT_ERR_UNEXPECTED;
+            if(cube_levels[j] == channels[i])
+                break;
         }
+        if(j == 6)
+            return false;
+
+        code += weights[i] * j;
     }
 
-    if(status != 0)
-        return NT_ERR_UNEXPECTED;
+    *out_code = code;
+    return true;
+}
+
+/* ------------------------------------------------------ */
+/* GFX EMITTERS */
+/* ------------------------------------------------------ */
+
+/* Upper bound of an emitted gfx reset, newline and gfx sequence: 11
+ * fragments, 2 of them followed by RGB components, plus the excess of
+ * nt__put_frag(). */
+#define NT__GFX_SEQ_MAX 384
 
-    /* Set background --------------------------------------------------- */
+/* Copies the whole fragment storage, a fixed-size copy compiles to a few
+ * moves. Callers leave room for the excess. */
+static inline char* nt__put_frag(char* out, const struct nt__esc_frag* frag)
+{
+    memcpy(out, frag->seq, sizeof(frag->seq));
+    return out + frag->len;
+}
 
-    if(nt_color_are_eql(NT_COLOR_DEFAULT, gfx.bg))
+static inline char* nt__put_u8(char* out, uint8_t val)
+{
+    if(val >= 100)
     {
-        status = nt__execute_used_term_func(NT_ESC_FUNC_BG_SET_DEFAULT, false);
+        *out++ = '0' + (val / 100);
+        val %= 100;
+        *out++ = '0' + (val / 10);
     }
-    else
+    else if(val >= 10)
     {
-        gfx.bg = (gfx.bg.code8 <= NT_COLOR_C8_WHITE) ? gfx.bg : NT_COLOR_DEFAULT;
+        *out++ = '0' + (val / 10);
+    }
+    *out++ = '0' + (val % 10);
 
-        if(colors == NT_TERM_COLOR_TC)
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_BG_SET_RGB,
-                    true,
-                    gfx.bg.rgb.r,
-                    gfx.bg.rgb.g,
-                    gfx.bg.rgb.b);
-        }
-        else if(colors == NT_TERM_COLOR_C256)
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_BG_SET_C256,
-                    true,
-                    gfx.bg.code256);
-        }
-        else if(colors == NT_TERM_COLOR_C8)
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_BG_SET_C8,
-                    true,
-                    gfx.bg.code8);
-        }
-        else
-        {
+    return out;
+}
+
+/* This function assumes that the terminal has the capability to set default
+ * fg and bg colors. A color that can't be expressed in `colors` fails the
+ * whole gfx. `bg`, `colors` and `enc` are constants in every caller, so each
+ * emitter gets its own branch-free copy. */
+static inline int nt__emit_color(
+        const struct nt__esc_cache* cache,
+        const struct nt_color* color,
+        bool bg,
+        nt_term_color_count colors,
+        enum nt_color_enc enc,
+        char** it)
+{
+    const struct nt__esc_frag* frag;
+    uint8_t code_exact;
+
+    if(nt_color_are_eql(NT_COLOR_DEFAULT, *color) ||
+       (color->code8 > NT_COLOR_C8_WHITE))
+    {
+        frag = &cache->funcs[bg ?
+            NT_ESC_FUNC_BG_SET_DEFAULT : NT_ESC_FUNC_FG_SET_DEFAULT];
+    }
+    else if((colors == NT_TERM_COLOR_TC) && (enc == NT_COLOR_ENC_SHORTEST) &&
+            nt__rgb_to_c256_exact(color->rgb, &code_exact))
+    {
+        frag = bg ? &cache->bg_c256[code_exact] : &cache->fg_c256[code_exact];
+    }
+    else if(colors == NT_TERM_COLOR_TC)
+    {
+        frag = bg ? &cache->bg_rgb : &cache->fg_rgb;
+        if(frag->len == 0)
             return NT_ERR_UNEXPECTED;
-        }
+
+        char* out = nt__put_frag(*it, frag);
+        out = nt__put_u8(out, color->rgb.r);
+        *out++ = ';';
+        out = nt__put_u8(out, color->rgb.g);
+        *out++ = ';';
+        out = nt__put_u8(out, color->rgb.b);
+        *out++ = 'm';
+
+        *it = out;
+        return 0;
+    }
+    else if(colors == NT_TERM_COLOR_C256)
+    {
+        frag = bg ? &cache->bg_c256[color->code256] :
+            &cache->fg_c256[color->code256];
+    }
+    else
+    {
+        frag = bg ? &cache->bg_c8[color->code8] : &cache->fg_c8[color->code8];
     }
 
-    if(status != 0)
+    if(frag->len == 0)
         return NT_ERR_UNEXPECTED;
 
-    /* Set style -------------------------------------------------------- */
+    *it = nt__put_frag(*it, frag);
+    return 0;
+}
+
+static inline int nt__emit_gfx(
+        const struct nt__esc_cache* cache,
+        const struct nt_gfx* gfx,
+        char* out,
+        size_t* out_len,
+        nt_term_color_count colors,
+        enum nt_color_enc enc)
+{
+    char* it = out;
+    int status;
 
-    uint8_t style;
+    status = nt__emit_color(cache, &gfx->fg, false, colors, enc, &it);
+    if(status != 0)
+        return status;
+
+    status = nt__emit_color(cache, &gfx->bg, true, colors, enc, &it);
+    if(status != 0)
+        return status;
 
+    uint8_t style;
     switch(colors)
     {
         case NT_TERM_COLOR_TC:
-            style = gfx.style.value_rgb;
+            style = gfx->style.value_rgb;
             break;
         case NT_TERM_COLOR_C256:
-            style = gfx.style.value_c256;
-            break;
-        case NT_TERM_COLOR_C8:
-            style = gfx.style.value_c8;
+            style = gfx->style.value_c256;
             break;
         default:
-            return NT_ERR_UNEXPECTED;
+            style = gfx->style.value_c8;
+            break;
     }
 
+    /* Styles the terminal doesn't support have empty fragments. */
     size_t i;
-    size_t count = 8;
-    for(i = 0; i < count; i++)
+    for(i = 0; i < 8; i++)
     {
         if(style & (NT_STYLE_BOLD << i))
-        {
-            status = nt__execute_used_term_func(
-                    NT_ESC_FUNC_STYLE_SET_BOLD + i,
-                    true);
-
-            if((status != 0) && (status != NT_ERR_FUNC_NOT_SUPP))
-                return status;
-        }
+            it = nt__put_frag(it, &cache->funcs[NT_ESC_FUNC_STYLE_SET_BOLD + i]);
     }
 
+    *out_len = it - out;
     return 0;
 }
 
-int nt_write_str(const char* str, size_t len, struct nt_gfx gfx)
-{
-    int status;
+/* X(name, colors, enc) */
+#define NT__GFX_EMITTERS(X)                                                    \
+    X(nt__emit_gfx_c8, NT_TERM_COLOR_C8, NT_COLOR_ENC_DEFAULT)                 \
+    X(nt__emit_gfx_c256, NT_TERM_COLOR_C256, NT_COLOR_ENC_DEFAULT)             \
+    X(nt__emit_gfx_tc, NT_TERM_COLOR_TC, NT_COLOR_ENC_DEFAULT)                 \
+    X(nt__emit_gfx_tc_short, NT_TERM_COLOR_TC, NT_COLOR_ENC_SHORTEST)
+
+#define NT__GFX_EMITTER_DEFINE(name, colors, enc)                              \
+    static int name(                                                           \
+            const struct nt__esc_cache* cache,                                 \
+            const struct nt_gfx* gfx,                                          \
+            char* out,                                                         \
+            size_t* out_len)                                                   \
+    {                                                                          \
+        return nt__emit_gfx(cache, gfx, out, out_len, colors, enc);            \
+    }
+
+NT__GFX_EMITTERS(NT__GFX_EMITTER_DEFINE)
+
+/* Indexed by enum nt_color_enc and nt_term_color_count. */
+static const nt__gfx_emitter gfx_emitters[2][NT_TERM_COLOR_OTHER] = {
+    [NT_COLOR_ENC_DEFAULT] = {
+        [NT_TERM_COLOR_C8] = nt__emit_gfx_c8,
+        [NT_TERM_COLOR_C256] = nt__emit_gfx_c256,
+        [NT_TERM_COLOR_TC] = nt__emit_gfx_tc
+    },
+    [NT_COLOR_ENC_SHORTEST] = {
+        [NT_TERM_COLOR_C8] = nt__emit_gfx_c8,
+        [NT_TERM_COLOR_C256] = nt__emit_gfx_c256,
+        [NT_TERM_COLOR_TC] = nt__emit_gfx_tc_short
+    }
+};
+
+/* Selects the emitter matching the terminal's color mode and the color
+ * encoding. Called when either changes. */
+static void nt__gfx_emitter_select(struct nt_ctx* ctx)
+{
+    nt_term_color_count colors = ctx->term.colors;
+
+    ctx->gfx_emitter = (colors < NT_TERM_COLOR_OTHER) ?
+        gfx_emitters[ctx->color_enc][colors] : NULL;
+
+    ctx->sgr_gen++;
+    if(ctx->sgr_gen == 0)
+        ctx->sgr_gen = 1;
+}
+
+static inline nt__gfx_emitter nt__get_gfx_emitter(struct nt_ctx* ctx)
+{
+    if((ctx->frame_budget == 0) || (ctx->frame_bytes <= ctx->frame_budget) ||
+       (ctx->gfx_emitter == NULL))
+        return ctx->gfx_emitter;
+
+    return gfx_emitters[ctx->color_enc][nt__get_frame_color_count(ctx)];
+}
 
-    status = nt__execute_used_term_func(NT_ESC_FUNC_GFX_RESET, false);
+/* Renders a gfx reset followed by the sequences setting `gfx` into `out`,
+ * which must hold at least NT__GFX_SEQ_MAX bytes. */
+static int nt__render_gfx(
+        const struct nt_ctx* ctx,
+        nt__gfx_emitter emitter,
+        const struct nt_gfx* gfx,
+        char* out,
+        size_t* out_len,
+        size_t* out_reset_len)
+{
+    if(emitter == NULL)
+        return NT_ERR_UNEXPECTED;
+
+    const struct nt__esc_cache* cache = &ctx->term.esc_cache;
+    const struct nt__esc_frag* reset = &cache->funcs[NT_ESC_FUNC_GFX_RESET];
+    if(reset->len == 0)
+        return NT_ERR_FUNC_NOT_SUPP;
+
+    NT__TRACE_BEGIN(trace);
+    char* it = nt__put_frag(out, reset);
+
+    size_t gfx_len;
+    int status = emitter(cache, gfx, it, &gfx_len);
+    NT__TRACE_END(trace, "render_gfx");
     if(status != 0)
         return status;
 
-    status = nt__set_gfx(gfx);
+    *out_len = reset->len + gfx_len;
+    *out_reset_len = reset->len;
+
+    return 0;
+}
+
+/* Writes `str` using `seq`, rendered by nt__render_gfx(), to `chunk`, or to
+ * the output of `ctx` if `chunk` is NULL. */
+static int nt__write_str_seq(
+        struct nt_ctx* ctx,
+        struct nt__chunk* chunk,
+        const char* str,
+        size_t len,
+        const char* seq,
+        size_t seq_len,
+        size_t reset_len)
+{
+    int status;
+
+    status = nt__emit(ctx, chunk, seq, seq_len, NT_STATS_BYTES_SGR);
     if(status != 0)
         return status;
 
     /* In some terminals, a newline will fill the next row with currently set bg.
      * To avoid this, any time we run into a newline, we will reset the gfx,
      * print it in default GFX, and then resume printing */
+    char nl_seq[NT__GFX_SEQ_MAX];
+    size_t nl_seq_len = 0;
     size_t rem;
     if(len > 0)
     {
@@ -779,19 +1808,22 @@ int nt_write_str(const char* str, size_t len, struct nt_gfx gfx)
 
             if(it_end != NULL)
             {
-                status = nt__write_to_stdout(it_begin, it_end - it_begin);
+                status = nt__emit(ctx, chunk, it_begin, it_end - it_begin,
+                        NT_STATS_BYTES_TEXT);
                 if(status != 0)
                     return status;
 
-                status = nt__execute_used_term_func(NT_ESC_FUNC_GFX_RESET, false);
-                if(status != 0)
-                    return status;
-
-                status = nt__write_to_stdout("\n", 1);
-                if(status != 0)
-                    return status;
+                if(nl_seq_len == 0)
+                {
+                    memcpy(nl_seq, seq, reset_len);
+                    nl_seq[reset_len] = '\n';
+                    memcpy(nl_seq + reset_len + 1, seq + reset_len,
+                            seq_len - reset_len);
+                    nl_seq_len = seq_len + 1;
+                }
 
-                status = nt__set_gfx(gfx);
+                status = nt__emit(ctx, chunk, nl_seq, nl_seq_len,
+                        NT_STATS_BYTES_SGR);
                 if(status != 0)
                     return status;
 
@@ -802,7 +1834,8 @@ int nt_write_str(const char* str, size_t len, struct nt_gfx gfx)
             }
             else
             {
-                status = nt__write_to_stdout(it_begin, (str + len) - it_begin);
+                status = nt__emit(ctx, chunk, it_begin,
+                        (str + len) - it_begin, NT_STATS_BYTES_TEXT);
                 if(status != 0)
                     return status;
                 break;
@@ -813,23 +1846,415 @@ int nt_write_str(const char* str, size_t len, struct nt_gfx gfx)
     return 0;
 }
 
-int nt_write_str_unsafe(const char* str, struct nt_gfx gfx)
+int nt_ctx_write_str(struct nt_ctx* ctx,
+        const char* str, size_t len, struct nt_gfx gfx)
+{
+    ctx = nt__ctx_get(ctx);
+
+    char seq[NT__GFX_SEQ_MAX];
+    size_t seq_len, reset_len;
+    int status;
+
+    NT__TRACE_BEGIN(trace);
+    status = nt__render_gfx(ctx, nt__get_gfx_emitter(ctx), &gfx, seq,
+            &seq_len, &reset_len);
+    if(status == 0)
+    {
+        status = nt__write_str_seq(ctx, NULL, str, len,
+                seq, seq_len, reset_len);
+    }
+    NT__TRACE_END(trace, "write_str");
+
+    return status;
+}
+
+/* Returns the cached sequences of `id`, growing the cache to hold it, or NULL
+ * if that fails. */
+static struct nt__sgr* nt__sgr_get(struct nt_ctx* ctx, nt_gfx_id id)
+{
+    if(id >= ctx->sgr_cap)
+    {
+        size_t new_cap = (ctx->sgr_cap > 0) ? ctx->sgr_cap : 64;
+        while(new_cap <= id)
+            new_cap *= 2;
+
+        struct nt__sgr* new_sgrs = realloc(
+                ctx->sgrs, new_cap * sizeof(struct nt__sgr));
+        if(new_sgrs == NULL)
+            return NULL;
+
+        /* Generation 0 is never current. */
+        memset(new_sgrs + ctx->sgr_cap, 0,
+                (new_cap - ctx->sgr_cap) * sizeof(struct nt__sgr));
+        ctx->sgrs = new_sgrs;
+        ctx->sgr_cap = new_cap;
+    }
+
+    return &ctx->sgrs[id];
+}
+
+int nt_ctx_write_str_id(struct nt_ctx* ctx,
+        const char* str, size_t len, nt_gfx_id id)
+{
+    ctx = nt__ctx_get(ctx);
+
+    const struct nt__gfx_entry* entry = nt__gfx_entry_get(id);
+    if(entry == NULL)
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    char seq[NT__GFX_SEQ_MAX];
+    size_t seq_len, reset_len;
+    int status;
+
+    /* Over the frame budget, the gfx is rendered with a fallback emitter and
+     * the cached sequences are left as they are. */
+    nt__gfx_emitter emitter = nt__get_gfx_emitter(ctx);
+    if((emitter != ctx->gfx_emitter) || (ctx->gfx_emitter == NULL))
+    {
+        status = nt__render_gfx(ctx, emitter, &entry->gfx, seq,
+                &seq_len, &reset_len);
+        if(status != 0)
+            return status;
+
+        return nt__write_str_seq(ctx, NULL, str, len, seq, seq_len, reset_len);
+    }
+
+    struct nt__sgr* sgr = nt__sgr_get(ctx, id);
+    if(sgr == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    if(sgr->gen != ctx->sgr_gen)
+    {
+        status = nt__render_gfx(ctx, emitter, &entry->gfx, seq,
+                &seq_len, &reset_len);
+        if(status != 0)
+            return status;
+
+        char* new_seq = realloc(sgr->seq, seq_len);
+        if(new_seq == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        memcpy(new_seq, seq, seq_len);
+        sgr->seq = new_seq;
+        sgr->len = (uint16_t)seq_len;
+        sgr->reset_len = (uint16_t)reset_len;
+        sgr->gen = ctx->sgr_gen;
+    }
+
+    return nt__write_str_seq(ctx, NULL, str, len, sgr->seq, sgr->len,
+            sgr->reset_len);
+}
+
+/* ------------------------------------------------------ */
+
+int nt__encode_str_id(struct nt_ctx* ctx, struct nt__chunk* chunk,
+        const char* str, size_t len, nt_gfx_id id)
+{
+    if(chunk == NULL)
+        return nt_ctx_write_str_id(ctx, str, len, id);
+
+    ctx = nt__ctx_get(ctx);
+
+    const struct nt__gfx_entry* entry = nt__gfx_entry_get(id);
+    if(entry == NULL)
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    /* The cache is only read here, so encoding threads can share it. */
+    const struct nt__sgr* sgr = (id < ctx->sgr_cap) ? &ctx->sgrs[id] : NULL;
+    if((sgr != NULL) && (sgr->gen == ctx->sgr_gen))
+    {
+        return nt__write_str_seq(ctx, chunk, str, len, sgr->seq, sgr->len,
+                sgr->reset_len);
+    }
+
+    char seq[NT__GFX_SEQ_MAX];
+    size_t seq_len, reset_len;
+    int status;
+
+    status = nt__render_gfx(ctx, ctx->gfx_emitter, &entry->gfx, seq,
+            &seq_len, &reset_len);
+    if(status != 0)
+        return status;
+
+    return nt__write_str_seq(ctx, chunk, str, len, seq, seq_len, reset_len);
+}
+
+int nt_ctx_write_str_unsafe(struct nt_ctx* ctx,
+        const char* str, struct nt_gfx gfx)
 {
     size_t len = str ? strlen(str) : 0;
-    return nt_write_str(str, len, gfx);
+    return nt_ctx_write_str(ctx, str, len, gfx);
 }
 
 /* -------------------------------------------------------------------------- */
-/* EVENT */
+/* FRAME PACING */
 /* -------------------------------------------------------------------------- */
 
-#define NT__EVENT_HEADER_SIZE 2
+#define NT__PRESENT_NONE ULLONG_MAX
+#define NT__PRESENT_INTERVAL_MAX_US 1000000ULL
+
+/* Flushing may take up to 1/NT__PRESENT_FLUSH_FACTOR of the frame interval.
+ * Beyond that, the interval is stretched and intermediate frames are
+ * dropped. */
+#define NT__PRESENT_FLUSH_FACTOR 2
+
+/* Must be called with `present_lock` held. */
+static void nt__present_adapt(struct nt_ctx* ctx)
+{
+    unsigned long long interval_us = ctx->present_target_us;
+    unsigned long long flush_bound_us =
+        ctx->present_flush_avg_us * NT__PRESENT_FLUSH_FACTOR;
+
+    if(flush_bound_us > interval_us)
+        interval_us = flush_bound_us;
+    if(interval_us > NT__PRESENT_INTERVAL_MAX_US)
+        interval_us = NT__PRESENT_INTERVAL_MAX_US;
+
+    ctx->present_interval_us = interval_us;
+}
+
+/* Must be called with `present_lock` held. */
+static void nt__output_set_queued(struct nt_ctx* ctx, size_t queued)
+{
+    ctx->output_queued = queued;
+    ctx->output_congested = (ctx->output_congestion_limit > 0) &&
+        (queued > ctx->output_congestion_limit);
+}
+
+static void nt__present_on_flush(struct nt_ctx* ctx,
+        unsigned long long flush_us, size_t queued)
+{
+    pthread_mutex_lock(&ctx->present_lock);
+
+    ctx->output_flush_us = flush_us;
+    nt__output_set_queued(ctx, queued);
+
+    /* Exponential moving average with weight 1/8. */
+    if(ctx->present_flush_avg_us == 0)
+        ctx->present_flush_avg_us = flush_us;
+    else
+        ctx->present_flush_avg_us = ((ctx->present_flush_avg_us * 7) + flush_us) / 8;
+
+    nt__present_adapt(ctx);
+
+    pthread_mutex_unlock(&ctx->present_lock);
+}
+
+/* Returns microseconds until the requested frame is due, or NT__PRESENT_NONE
+ * if no redraw is requested. While output is congested, a due frame is held
+ * back and the queue is checked again one interval later. */
+static unsigned long long nt__present_until_due(struct nt_ctx* ctx,
+        unsigned long long now_us)
+{
+    unsigned long long until_us = NT__PRESENT_NONE;
+
+    pthread_mutex_lock(&ctx->present_lock);
+    if(ctx->present_requested)
+    {
+        unsigned long long due_us = ctx->present_last_us + ctx->present_interval_us;
+        until_us = (now_us >= due_us) ? 0 : (due_us - now_us);
+
+        if((until_us == 0) && ctx->output_congested)
+        {
+            nt__output_set_queued(ctx, nt__output_queued(ctx));
+            if(ctx->output_congested)
+                until_us = ctx->present_interval_us;
+        }
+    }
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    return until_us;
+}
+
+static int nt__present_take_frame(
+        struct nt_ctx* ctx,
+        unsigned long long now_us,
+        struct nt_event* out_event)
+{
+    struct nt_frame frame;
+    memset(&frame, 0, sizeof(frame));
+
+    pthread_mutex_lock(&ctx->present_lock);
+    ctx->present_requested = false;
+    ctx->present_last_us = now_us;
+    frame.interval_us = (unsigned int)ctx->present_interval_us;
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    int status = nt_event_new_custom(
+            NT_EVENT_FRAME, &frame, sizeof(frame), out_event);
+    return (status == 0) ? 0 : NT_ERR_UNEXPECTED;
+}
+
+void nt_ctx_request_redraw(struct nt_ctx* ctx)
+{
+    ctx = nt__ctx_get(ctx);
+
+    bool wake;
+
+    pthread_mutex_lock(&ctx->present_lock);
+    if(ctx->present_requested)
+    {
+        pthread_mutex_unlock(&ctx->present_lock);
+        return;
+    }
+    ctx->present_requested = true;
+
+    /* The waiting thread only needs a wakeup if it may be blocked, so
+     * requests made from it don't touch the pipe. */
+    wake = !ctx->present_token && !(ctx->present_waiter_set &&
+            pthread_equal(ctx->present_waiter, pthread_self()));
+    if(wake)
+        ctx->present_token = true;
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    if(!wake)
+        return;
+
+    uint8_t buff[NT__EVENT_HEADER_SIZE] = { NT__EVENT_TOKEN_WAKE, 0, 0 };
+    if(nt__write_pipe_event(ctx->custom_event_pipe[1], buff, sizeof(buff)) != 0)
+    {
+        pthread_mutex_lock(&ctx->present_lock);
+        ctx->present_token = false;
+        pthread_mutex_unlock(&ctx->present_lock);
+    }
+}
+
+int nt_ctx_present_set_fps(struct nt_ctx* ctx, unsigned int fps)
+{
+    ctx = nt__ctx_get(ctx);
+
+    if((fps == 0) || (fps > NT_PRESENT_FPS_MAX))
+        return NT_ERR_INVALID_ARG;
+
+    pthread_mutex_lock(&ctx->present_lock);
+    ctx->present_target_us = 1000000ULL / fps;
+    nt__present_adapt(ctx);
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    return 0;
+}
+
+void nt_ctx_output_get_state(struct nt_ctx* ctx,
+        struct nt_output_state* out_state)
+{
+    ctx = nt__ctx_get(ctx);
+
+    if(out_state == NULL)
+        return;
+
+    pthread_mutex_lock(&ctx->present_lock);
+    *out_state = (struct nt_output_state) {
+        .queued = ctx->output_queued,
+        .flush_us = (unsigned int)ctx->output_flush_us,
+        .flush_avg_us = (unsigned int)ctx->present_flush_avg_us,
+        .congested = ctx->output_congested
+    };
+    pthread_mutex_unlock(&ctx->present_lock);
+}
+
+void nt_ctx_output_set_congestion_limit(struct nt_ctx* ctx, size_t limit)
+{
+    ctx = nt__ctx_get(ctx);
+
+    pthread_mutex_lock(&ctx->present_lock);
+    ctx->output_congestion_limit = limit;
+    nt__output_set_queued(ctx, ctx->output_queued);
+    pthread_mutex_unlock(&ctx->present_lock);
+}
+
+unsigned int nt_ctx_present_get_timeout(struct nt_ctx* ctx)
+{
+    ctx = nt__ctx_get(ctx);
 
-/* Called by nt_event_wait() internally. */
-static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore);
-static int nt__process_resize(struct nt_event* out_event, bool* out_ignore);
-static int nt__process_signal(struct nt_event* out_event, bool* out_ignore);
-static int nt__process_custom(struct nt_event* out_event, bool* out_ignore);
+    unsigned long long until_us = nt__present_until_due(ctx, nt__clock_us(ctx));
+    if(until_us == NT__PRESENT_NONE)
+        return NT_EVENT_WAIT_FOREVER;
+
+    return (unsigned int)((until_us + 999) / 1000);
+}
+
+/* ------------------------------------------------------ */
+
+void nt_ctx_clock_set_virtual(struct nt_ctx* ctx, bool enable)
+{
+    ctx = nt__ctx_get(ctx);
+
+    if(enable && !ctx->clock_virtual)
+        ctx->clock_us = nt__now_us();
+
+    ctx->clock_virtual = enable;
+}
+
+void nt_ctx_clock_advance(struct nt_ctx* ctx, unsigned long long us)
+{
+    ctx = nt__ctx_get(ctx);
+
+    if(ctx->clock_virtual)
+        ctx->clock_us += us;
+}
+
+unsigned long long nt_ctx_clock_get_us(struct nt_ctx* ctx)
+{
+    return nt__clock_us(nt__ctx_get(ctx));
+}
+
+/* ------------------------------------------------------ */
+
+int nt_ctx_input_record_start(struct nt_ctx* ctx, int fd)
+{
+    if(fd < 0)
+        return NT_ERR_INVALID_ARG;
+
+    ctx = nt__ctx_get(ctx);
+
+    ctx->record_fd = -1;
+    if(nt__write_all(fd, NT_INPUT_RECORD_MAGIC, NT_INPUT_RECORD_MAGIC_LEN,
+                NULL) != 0)
+        return NT_ERR_UNEXPECTED;
+
+    ctx->record_fd = fd;
+    ctx->record_start_us = nt__clock_us(ctx);
+
+    return 0;
+}
+
+void nt_ctx_input_record_stop(struct nt_ctx* ctx)
+{
+    nt__ctx_get(ctx)->record_fd = -1;
+}
+
+/* ------------------------------------------------------ */
+
+int nt_ctx_stats_get(struct nt_ctx* ctx, struct nt_stats* out_stats)
+{
+    if(out_stats == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    ctx = nt__ctx_get(ctx);
+
+    /* All members are uint64_t counters. */
+    const uint64_t* src = (const uint64_t*)&ctx->stats;
+    uint64_t* dst = (uint64_t*)out_stats;
+    size_t i;
+    for(i = 0; i < (sizeof(struct nt_stats) / sizeof(uint64_t)); i++)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* EVENT */
+/* -------------------------------------------------------------------------- */
+
+/* Called by nt_ctx_event_wait(ctx) internally. */
+static int nt__process_stdin(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore);
+static int nt__process_resize(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore);
+static int nt__process_signal(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore);
+static int nt__process_custom(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore);
 
 /* -------------------------------------------------------------------------- */
 
@@ -845,15 +2270,150 @@ static int nt__event_new(
     return (status == 0) ? 0 : NT_ERR_UNEXPECTED;
 }
 
-int nt_event_wait(
+/* Event types each polled source can produce. */
+static const uint32_t poll_fd_types[POLL_FD_COUNT] = {
+    [STDIN_POLL_FD] = NT_EVENT_KEY | NT_EVENT_MOUSE,
+    [RESIZE_POLL_FD] = NT_EVENT_RESIZE,
+    [SIGNAL_POLL_FD] = NT_EVENT_SIGNAL,
+    [CUSTOM_POLL_FD] = NT_EVENT_MASK_ALL // nt_event_push() accepts any type
+};
+
+/* Appends `event` to the deferred list. A deferred resize is replaced in place,
+ * in line with resize coalescing. */
+static int nt__deferred_push(struct nt_ctx* ctx, const struct nt_event* event)
+{
+    size_t i;
+    if(event->type == NT_EVENT_RESIZE)
+    {
+        for(i = 0; i < ctx->deferred_count; i++)
+        {
+            if(ctx->deferred[i].type == NT_EVENT_RESIZE)
+            {
+                ctx->deferred[i] = *event;
+                return 0;
+            }
+        }
+    }
+
+    if(ctx->deferred_count == ctx->deferred_cap)
+    {
+        size_t new_cap = (ctx->deferred_cap > 0) ? (ctx->deferred_cap * 2) : 16;
+        struct nt_event* new_deferred = realloc(
+                ctx->deferred, new_cap * sizeof(struct nt_event));
+        if(new_deferred == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        ctx->deferred = new_deferred;
+        ctx->deferred_cap = new_cap;
+    }
+
+    ctx->deferred[ctx->deferred_count++] = *event;
+
+    return 0;
+}
+
+/* Removes the oldest deferred event matching `mask`, if any. */
+static bool nt__deferred_pop(struct nt_ctx* ctx,
+        uint32_t mask, struct nt_event* out_event)
+{
+    size_t i;
+    for(i = 0; i < ctx->deferred_count; i++)
+    {
+        if(ctx->deferred[i].type & mask)
+        {
+            *out_event = ctx->deferred[i];
+            memmove(ctx->deferred + i, ctx->deferred + i + 1,
+                    (ctx->deferred_count - i - 1) * sizeof(struct nt_event));
+            ctx->deferred_count--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Keeps `deferred_fd` readable exactly while the deferred list is not
+ * empty. */
+static void nt__deferred_fd_sync(struct nt_ctx* ctx)
+{
+#ifdef NT__HAVE_EPOLL
+    if(ctx->deferred_fd < 0)
+        return;
+
+    uint64_t val;
+    if((ctx->deferred_count > 0) && !ctx->deferred_fd_set)
+    {
+        val = 1;
+        if(write(ctx->deferred_fd, &val, sizeof(val)) == sizeof(val))
+            ctx->deferred_fd_set = true;
+    }
+    else if((ctx->deferred_count == 0) && ctx->deferred_fd_set)
+    {
+        if(read(ctx->deferred_fd, &val, sizeof(val)) == sizeof(val))
+            ctx->deferred_fd_set = false;
+    }
+#endif // NT__HAVE_EPOLL
+}
+
+static int nt__event_wait_mask(
+        struct nt_ctx* ctx,
+        struct nt_event* out_event,
+        uint32_t mask,
+        unsigned int timeout,
+        unsigned int* out_elapsed);
+
+int nt_ctx_event_wait(
+        struct nt_ctx* ctx,
+        struct nt_event* out_event,
+        unsigned int timeout,
+        unsigned int* out_elapsed)
+{
+    return nt_ctx_event_wait_mask(ctx, out_event, NT_EVENT_MASK_ALL,
+            timeout, out_elapsed);
+}
+
+int nt_ctx_event_wait_mask(
+        struct nt_ctx* ctx,
         struct nt_event* out_event,
+        uint32_t mask,
         unsigned int timeout,
         unsigned int* out_elapsed)
 {
-    struct timespec time1, time2;
+    ctx = nt__ctx_get(ctx);
+
+    int status = nt__event_wait_mask(ctx, out_event, mask,
+            timeout, out_elapsed);
+    nt__deferred_fd_sync(ctx);
+
+    return status;
+}
+
+static void nt__stat_event(struct nt_ctx* ctx, uint32_t type)
+{
+    size_t i;
+    for(i = 0; i < 32; i++)
+    {
+        if(type & (((uint32_t)1) << i))
+            break;
+    }
+
+    if(i < 32)
+        nt__stat_add(&ctx->stats.events[i], 1);
+}
+
+static int nt__event_wait_mask(
+        struct nt_ctx* ctx,
+        struct nt_event* out_event,
+        uint32_t mask,
+        unsigned int timeout,
+        unsigned int* out_elapsed)
+{
+    unsigned long long start_us, until_us;
+    struct pollfd fds[POLL_FD_COUNT];
     int poll_status;
-    unsigned int elapsed;
+    unsigned int elapsed = 0;
     int status;
+    size_t i;
 
     struct nt_event event = NT_EVENT_EMPTY;
     struct nt_event timeout_event;
@@ -867,28 +2427,77 @@ int nt_event_wait(
     if(out_elapsed != NULL)
         *out_elapsed = 0;
 
-    while(true)
+    if(mask == 0)
+        return NT_ERR_INVALID_ARG;
+
+    if(nt__deferred_pop(ctx, mask, &event))
     {
-        if(clock_gettime(CLOCK_MONOTONIC, &time1) != 0)
-            return NT_ERR_UNEXPECTED;
+        nt__stat_event(ctx, event.type);
+        if(out_event != NULL)
+            *out_event = event;
+        return 0;
+    }
+
+    /* Sources that can't produce a matching type are skipped by poll(). */
+    for(i = 0; i < POLL_FD_COUNT; i++)
+    {
+        fds[i] = ctx->poll_fds[i];
+        if(!(poll_fd_types[i] & mask))
+            fds[i].fd = -1;
+    }
 
-        poll_status = nt__poll_retry(poll_fds, POLL_FD_COUNT, (int)timeout);
+    start_us = nt__clock_us(ctx);
 
-        if(clock_gettime(CLOCK_MONOTONIC, &time2) != 0)
-            return NT_ERR_UNEXPECTED;
+    pthread_mutex_lock(&ctx->present_lock);
+    ctx->present_waiter = pthread_self();
+    ctx->present_waiter_set = true;
+    pthread_mutex_unlock(&ctx->present_lock);
+
+    while(true)
+    {
+        unsigned int remaining = (timeout == NT_EVENT_WAIT_FOREVER) ?
+            NT_EVENT_WAIT_FOREVER : (timeout - elapsed);
+        int poll_timeout = (int)remaining;
+        bool frame_bound = false;
+        until_us = NT__PRESENT_NONE;
 
-        time_t sec = time2.tv_sec - time1.tv_sec;
-        long nsec = time2.tv_nsec - time1.tv_nsec;
-        if(nsec < 0)
+        if(mask & NT_EVENT_FRAME)
         {
-            sec--;
-            nsec += 1000000000L;
+            unsigned long long now_us = nt__clock_us(ctx);
+            until_us = nt__present_until_due(ctx, now_us);
+            if(until_us == 0)
+            {
+                status = nt__present_take_frame(ctx, now_us, &event);
+                if(status != 0)
+                    return status;
+                break;
+            }
+            if(until_us != NT__PRESENT_NONE)
+            {
+                unsigned long long until_ms = (until_us + 999) / 1000;
+                if((remaining == NT_EVENT_WAIT_FOREVER) ||
+                   (until_ms < remaining))
+                {
+                    poll_timeout = (int)until_ms;
+                    frame_bound = true;
+                }
+            }
         }
 
-        unsigned long long elapsed_ms =
-            ((unsigned long long)sec * 1000ULL) +
-            ((unsigned long long)nsec / 1000000ULL);
+        /* A virtual clock never waits, it jumps to the deadline instead. */
+        NT__TRACE_BEGIN(trace_poll);
+        poll_status = nt__poll_retry(fds, POLL_FD_COUNT,
+                ctx->clock_virtual ? 0 : poll_timeout);
+        NT__TRACE_END(trace_poll, "event_poll");
+        if(ctx->clock_virtual && (poll_status == 0))
+        {
+            if(frame_bound)
+                ctx->clock_us += until_us;
+            else if(remaining != NT_EVENT_WAIT_FOREVER)
+                ctx->clock_us += (unsigned long long)remaining * 1000ULL;
+        }
 
+        unsigned long long elapsed_ms = (nt__clock_us(ctx) - start_us) / 1000ULL;
         elapsed = (elapsed_ms <= timeout) ? (unsigned int)elapsed_ms : timeout;
 
         if(out_elapsed != NULL)
@@ -899,100 +2508,378 @@ int nt_event_wait(
 
         if(poll_status == 0)
         {
+            if(frame_bound)
+                continue;
+
+            nt__stat_event(ctx, timeout_event.type);
             if(out_event != NULL)
                 *out_event = timeout_event;
             return 0;
         }
 
-        timeout -= elapsed; // for the next poll(), if ignore == true
-
-        if(poll_fds[STDIN_POLL_FD].revents & POLLIN)
-        {
-            status = nt__process_stdin(&event, &ignore);
-            poll_fds[STDIN_POLL_FD].revents = 0;
-        }
-        else if(poll_fds[RESIZE_POLL_FD].revents & POLLIN)
+        if(fds[STDIN_POLL_FD].revents & POLLIN)
         {
-            status = nt__process_resize(&event, &ignore);
-            poll_fds[RESIZE_POLL_FD].revents = 0;
+            NT__TRACE_BEGIN(trace_stdin);
+            status = nt__process_stdin(ctx, &event, &ignore);
+            NT__TRACE_END(trace_stdin, "process_stdin");
         }
-        else if(poll_fds[SIGNAL_POLL_FD].revents & POLLIN)
-        {
-            status = nt__process_signal(&event, &ignore);
-            poll_fds[SIGNAL_POLL_FD].revents = 0;
-        }
-        else if(poll_fds[CUSTOM_POLL_FD].revents & POLLIN)
+        else if(fds[RESIZE_POLL_FD].revents & POLLIN)
+            status = nt__process_resize(ctx, &event, &ignore);
+        else if(fds[SIGNAL_POLL_FD].revents & POLLIN)
+            status = nt__process_signal(ctx, &event, &ignore);
+        else if(fds[CUSTOM_POLL_FD].revents & POLLIN)
+            status = nt__process_custom(ctx, &event, &ignore);
+        else
+            return NT_ERR_UNEXPECTED;
+
+        if(status != 0)
+            return status;
+
+        if(ignore)
+            continue;
+
+        if(!(event.type & mask))
         {
-            status = nt__process_custom(&event, &ignore);
-            poll_fds[CUSTOM_POLL_FD].revents = 0;
+            status = nt__deferred_push(ctx, &event);
+            if(status != 0)
+            {
+                nt_event_payload_release(nt_event_get_payload(&event));
+                return status;
+            }
+
+            continue;
         }
-        else
+
+        break;
+    }
+
+    nt__stat_event(ctx, event.type);
+    if(out_event != NULL)
+        *out_event = event;
+
+    return 0;
+}
+
+int nt_ctx_event_queue_drain(struct nt_ctx* ctx)
+{
+    struct nt_event event = {0};
+    int status;
+
+    while(true)
+    {
+        status = nt_ctx_event_wait(ctx, &event, 0, NULL);
+        if(status != 0)
+            return status;
+
+        if(event.type == NT_EVENT_TIMEOUT)
+            return 0;
+
+        nt_event_payload_release(nt_event_get_payload(&event));
+    }
+}
+
+int nt_ctx_event_get_fd(struct nt_ctx* ctx, int* out_fd)
+{
+    ctx = nt__ctx_get(ctx);
+
+    if(out_fd == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    *out_fd = -1;
+
+#ifdef NT__HAVE_EPOLL
+    if(ctx->ready_fd >= 0)
+    {
+        *out_fd = ctx->ready_fd;
+        return 0;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd < 0)
+        return NT_ERR_UNEXPECTED;
+
+    int event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if(event_fd < 0)
+    {
+        close(epoll_fd);
+        return NT_ERR_UNEXPECTED;
+    }
+
+    int fds[POLL_FD_COUNT + 1];
+    size_t i;
+    for(i = 0; i < POLL_FD_COUNT; i++)
+        fds[i] = ctx->poll_fds[i].fd;
+    fds[POLL_FD_COUNT] = event_fd;
+
+    struct epoll_event ep_event;
+    for(i = 0; i < (POLL_FD_COUNT + 1); i++)
+    {
+        /* Only the default context has a signal pipe. */
+        if(fds[i] < 0)
+            continue;
+
+        ep_event = (struct epoll_event) { .events = EPOLLIN };
+        ep_event.data.fd = fds[i];
+
+        if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fds[i], &ep_event) != 0)
         {
+            close(event_fd);
+            close(epoll_fd);
             return NT_ERR_UNEXPECTED;
         }
+    }
+
+    ctx->ready_fd = epoll_fd;
+    ctx->deferred_fd = event_fd;
+    ctx->deferred_fd_set = false;
+    nt__deferred_fd_sync(ctx);
+
+    *out_fd = ctx->ready_fd;
+    return 0;
+#else
+    return NT_ERR_FUNC_NOT_SUPP;
+#endif // NT__HAVE_EPOLL
+}
+
+int nt_ctx_event_dispatch(
+        struct nt_ctx* ctx,
+        struct nt_event* out_events,
+        size_t cap,
+        size_t* out_count)
+{
+    if(out_count != NULL)
+        *out_count = 0;
+    if((out_events == NULL) || (out_count == NULL))
+        return NT_ERR_INVALID_ARG;
 
+    int status;
+    size_t count = 0;
+    while(count < cap)
+    {
+        status = nt_ctx_event_wait(ctx, &out_events[count], 0, NULL);
         if(status != 0)
             return status;
 
-        if(ignore)
-            continue;
+        if(out_events[count].type == NT_EVENT_TIMEOUT)
+            break;
+
+        count++;
+        *out_count = count;
+    }
+
+    return 0;
+}
+
+int nt_ctx_event_push(struct nt_ctx* ctx, const struct nt_event* event)
+{
+    ctx = nt__ctx_get(ctx);
+
+    if(!event || !nt_event_is_valid(event))
+        return NT_ERR_INVALID_ARG;
+
+    size_t i;
+    uint8_t type;
+    for(i = 0; i < sizeof(uint32_t) * 8; i++)
+    {
+        if(event->type & (((uint32_t)1) << i))
+            break;
+    }
+    type = i;
+
+    // Prepare buffer for writing
+    uint8_t buff[NT__EVENT_HEADER_SIZE + NT_EVENT_DATA_MAX_SIZE +
+        NT__EVENT_STAMP_SIZE] = {0};
+    buff[0] = type;
+    buff[1] = event->data_size;
+    buff[2] = event->flags & NT_EVENT_FLAG_PAYLOAD; // unknown bits dropped
+
+    // If there's data, write it to buffer
+    if(event->data_size > 0)
+        memcpy(buff + NT__EVENT_HEADER_SIZE, event->u.data, event->data_size);
+
+    unsigned long long push_us = nt__now_us();
+    memcpy(buff + NT__EVENT_HEADER_SIZE + event->data_size, &push_us,
+            NT__EVENT_STAMP_SIZE);
+
+    // Write to the pipe. The whole event must stay one atomic write.
+    size_t write_size = NT__EVENT_HEADER_SIZE + event->data_size +
+        NT__EVENT_STAMP_SIZE;
+    return nt__write_pipe_event(ctx->custom_event_pipe[1], buff, write_size);
+}
+
+int nt_ctx_event_push_payload(struct nt_ctx* ctx, uint32_t type, void* payload)
+{
+    struct nt_event event;
+    int status = nt_event_new_payload(type, payload, &event);
+    if(status != 0)
+        return status;
+
+    return nt_ctx_event_push(ctx, &event);
+}
+
+/* Must be called with `keyed_lock` held. */
+static struct nt__keyed_slot* nt__keyed_find(struct nt_ctx* ctx, uint32_t key)
+{
+    size_t i;
+    for(i = 0; i < ctx->keyed_count; i++)
+    {
+        if(ctx->keyed_slots[i].pending && (ctx->keyed_slots[i].key == key))
+            return &ctx->keyed_slots[i];
+    }
+
+    return NULL;
+}
 
-        break;
+/* Must be called with `keyed_lock` held. */
+static struct nt__keyed_slot* nt__keyed_acquire(struct nt_ctx* ctx)
+{
+    size_t i;
+    for(i = 0; i < ctx->keyed_count; i++)
+    {
+        if(!ctx->keyed_slots[i].pending)
+            return &ctx->keyed_slots[i];
     }
 
-    if(out_event != NULL)
-        *out_event = event;
+    if(ctx->keyed_count == ctx->keyed_cap)
+    {
+        size_t new_cap = (ctx->keyed_cap > 0) ? (ctx->keyed_cap * 2) : 8;
+        struct nt__keyed_slot* new_slots = realloc(
+                ctx->keyed_slots, new_cap * sizeof(struct nt__keyed_slot));
+        if(new_slots == NULL)
+            return NULL;
+
+        ctx->keyed_slots = new_slots;
+        ctx->keyed_cap = new_cap;
+    }
 
-    return 0;
+    ctx->keyed_slots[ctx->keyed_count].pending = false;
+    return &ctx->keyed_slots[ctx->keyed_count++];
 }
 
-int nt_event_queue_drain(void)
+int nt_ctx_event_push_keyed(struct nt_ctx* ctx,
+        const struct nt_event* event, uint32_t key)
 {
-    struct nt_event event = {0};
-    int status;
+    ctx = nt__ctx_get(ctx);
 
-    while(true)
+    if(!event || !nt_event_is_valid(event))
+        return NT_ERR_INVALID_ARG;
+
+    struct nt__keyed_slot* slot;
+    void* replaced = NULL;
+
+    pthread_mutex_lock(&ctx->keyed_lock);
+    slot = nt__keyed_find(ctx, key);
+    if(slot != NULL)
     {
-        status = nt_event_wait(&event, 0, NULL);
-        if(status != 0)
-            return status;
+        replaced = nt_event_get_payload(&slot->event);
+        slot->event = *event;
+        pthread_mutex_unlock(&ctx->keyed_lock);
 
-        if(event.type == NT_EVENT_TIMEOUT)
-            return 0;
+        if(replaced != nt_event_get_payload(event))
+            nt_event_payload_release(replaced);
+        return 0;
+    }
+
+    slot = nt__keyed_acquire(ctx);
+    if(slot == NULL)
+    {
+        pthread_mutex_unlock(&ctx->keyed_lock);
+        return NT_ERR_ALLOC_FAIL;
+    }
+    slot->event = *event;
+    slot->key = key;
+    slot->pending = true;
+    pthread_mutex_unlock(&ctx->keyed_lock);
+
+    /* The pipe write is done without holding the lock: the reader takes the
+     * lock after reading a token, so holding it on a full pipe would
+     * deadlock. */
+    uint8_t buff[NT__EVENT_HEADER_SIZE + sizeof(uint32_t)] = {0};
+    buff[0] = NT__EVENT_TOKEN_KEYED;
+    buff[1] = sizeof(uint32_t);
+    memcpy(buff + NT__EVENT_HEADER_SIZE, &key, sizeof(uint32_t));
+
+    int status = nt__write_pipe_event(ctx->custom_event_pipe[1], buff, sizeof(buff));
+    if(status != 0)
+    {
+        pthread_mutex_lock(&ctx->keyed_lock);
+        slot = nt__keyed_find(ctx, key);
+        if(slot != NULL)
+        {
+            slot->pending = false;
+            replaced = nt_event_get_payload(&slot->event);
+        }
+        pthread_mutex_unlock(&ctx->keyed_lock);
+
+        /* The caller keeps ownership of its own payload on failure. */
+        if(replaced != nt_event_get_payload(event))
+            nt_event_payload_release(replaced);
     }
+
+    return status;
 }
 
-int nt_event_push(const struct nt_event* event)
+/* Resolves a keyed token read from the custom event pipe. Sets `out_ignore`
+ * if nothing is pending under the key. */
+static int nt__process_custom_keyed(
+        struct nt_ctx* ctx,
+        uint8_t data_size,
+        struct nt_event* out_event,
+        bool* out_ignore)
 {
-    if(!event || !nt_event_is_valid(event))
-        return NT_ERR_INVALID_ARG;
+    uint32_t key;
+    if((data_size != sizeof(uint32_t)) ||
+       (nt__read_exact(ctx->custom_event_pipe[0], &key, sizeof(key),
+                     NULL) != 0))
+    {
+        return NT_ERR_UNEXPECTED;
+    }
 
-    size_t i;
-    uint8_t type;
-    for(i = 0; i < sizeof(uint32_t) * 8; i++)
+    bool found = false;
+
+    pthread_mutex_lock(&ctx->keyed_lock);
+    struct nt__keyed_slot* slot = nt__keyed_find(ctx, key);
+    if(slot != NULL)
     {
-        if(event->type & (((uint32_t)1) << i))
-            break;
+        *out_event = slot->event;
+        slot->pending = false;
+        found = true;
     }
-    type = i;
+    pthread_mutex_unlock(&ctx->keyed_lock);
 
-    // Prepare buffer for writing
-    uint8_t buff[NT__EVENT_HEADER_SIZE + NT_EVENT_DATA_MAX_SIZE] = {0};
-    buff[0] = type;
-    buff[1] = event->data_size;
+    if(!found && (out_ignore != NULL))
+        *out_ignore = true;
 
-    // If there's data, write it to buffer
-    if(event->data_size > 0)
-        memcpy(buff + NT__EVENT_HEADER_SIZE, event->u.data, event->data_size);
+    return 0;
+}
 
-    // Write to the pipe. The whole event must stay one atomic write.
-    size_t write_size = NT__EVENT_HEADER_SIZE + event->data_size;
-    return nt__write_pipe_event(custom_event_pipe[1], buff, write_size);
+static void nt__release_pending_payloads(struct nt_ctx* ctx)
+{
+    if(ctx->custom_event_pipe[0] < 0)
+        return;
+
+    struct pollfd pfd = {
+        .fd = ctx->custom_event_pipe[0],
+        .events = POLLIN,
+        .revents = 0
+    };
+    struct nt_event event;
+    bool ignore;
+    while((nt__poll_retry(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN))
+    {
+        if(nt__process_custom(ctx, &event, &ignore) != 0)
+            break;
+        if(ignore)
+            continue;
+
+        nt_event_payload_release(nt_event_get_payload(&event));
+    }
 }
 
 /* ------------------------------------------------------ */
 
-static int nt__process_resize(struct nt_event* out_event, bool* out_ignore)
+static int nt__process_resize(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore)
 {
     if(out_ignore != NULL)
         *out_ignore = false;
@@ -1002,75 +2889,114 @@ static int nt__process_resize(struct nt_event* out_event, bool* out_ignore)
     while(true)
     {
         // Already polled, so read first.
-        if(nt__read_exact(resize_pipe[0], &c, 1) != 0)
+        if(nt__read_exact(ctx->resize_pipe[0], &c, 1, NULL) != 0)
             return NT_ERR_UNEXPECTED;
+        nt__stat_add(&ctx->stats.wakeups, 1);
 
-        poll_status = nt__poll_retry(poll_fds + RESIZE_POLL_FD, 1, 0);
+        poll_status = nt__poll_retry(ctx->poll_fds + RESIZE_POLL_FD, 1, 0);
         if(poll_status < 0)
             return NT_ERR_UNEXPECTED;
         if(poll_status == 0)
             break;
-        if(!(poll_fds[RESIZE_POLL_FD].revents & POLLIN))
+        if(!(ctx->poll_fds[RESIZE_POLL_FD].revents & POLLIN))
             return NT_ERR_UNEXPECTED;
     }
 
     struct nt_resize rsz;
     memset(&rsz, 0, sizeof(rsz));
-    nt_get_term_size(&rsz.new_x, &rsz.new_y);
+    nt_ctx_get_term_size(ctx, &rsz.new_x, &rsz.new_y);
     return nt__event_new(NT_EVENT_RESIZE, &rsz, sizeof(rsz), out_event);
 }
 
 /* ------------------------------------------------------ */
 
-static int nt__process_signal(struct nt_event* out_event, bool* out_ignore)
+static int nt__process_signal(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore)
 {
     if(out_ignore != NULL)
         *out_ignore = false;
 
     unsigned int signum = 0;
-    if(nt__read_exact(signal_pipe[0], &signum, sizeof(signum)) != 0)
+    if(nt__read_exact(ctx->signal_pipe[0], &signum, sizeof(signum),
+                NULL) != 0)
         return NT_ERR_UNEXPECTED;
+    nt__stat_add(&ctx->stats.wakeups, 1);
 
     return nt__event_new(NT_EVENT_SIGNAL, &signum, sizeof(signum), out_event);
 }
 
 /* ------------------------------------------------------ */
 
-static int nt__process_custom(struct nt_event* out_event, bool* out_ignore)
+static int nt__process_custom(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore)
 {
     if(out_ignore != NULL)
         *out_ignore = false;
 
     // Read header to determine type and data_size.
     uint8_t header[NT__EVENT_HEADER_SIZE] = {0};
-    if(nt__read_exact(custom_event_pipe[0], header, sizeof(header)) != 0)
+    if(nt__read_exact(ctx->custom_event_pipe[0], header, sizeof(header),
+                NULL) != 0)
         return NT_ERR_UNEXPECTED;
+    nt__stat_add(&ctx->stats.wakeups, 1);
 
     uint8_t type_idx = header[0];
     uint8_t data_size = header[1];
+    uint8_t flags = header[2];
+
+    if(type_idx == NT__EVENT_TOKEN_KEYED)
+        return nt__process_custom_keyed(ctx, data_size, out_event, out_ignore);
+
+    if(type_idx == NT__EVENT_TOKEN_WAKE)
+    {
+        pthread_mutex_lock(&ctx->present_lock);
+        ctx->present_token = false;
+        pthread_mutex_unlock(&ctx->present_lock);
+
+        /* Only wakes the waiting thread so it picks up a new deadline. */
+        if(out_ignore != NULL)
+            *out_ignore = true;
+        return 0;
+    }
 
     if((type_idx >= 32) || (data_size > NT_EVENT_DATA_MAX_SIZE))
         return NT_ERR_UNEXPECTED;
 
-    uint8_t buff[NT_EVENT_DATA_MAX_SIZE] = {0};
-    if((data_size > 0) && (nt__read_exact(custom_event_pipe[0], buff, data_size) != 0))
+    uint8_t buff[NT_EVENT_DATA_MAX_SIZE + NT__EVENT_STAMP_SIZE] = {0};
+    if(nt__read_exact(ctx->custom_event_pipe[0], buff,
+                data_size + NT__EVENT_STAMP_SIZE, NULL) != 0)
     {
         return NT_ERR_UNEXPECTED;
     }
 
+    unsigned long long push_us, now_us = nt__now_us();
+    memcpy(&push_us, buff + data_size, NT__EVENT_STAMP_SIZE);
+    nt__stat_hist_add(&ctx->stats.queue_wait_us,
+            (now_us > push_us) ? (now_us - push_us) : 0);
+
     uint32_t type = ((uint32_t)1) << type_idx;
-    return nt__event_new(type, buff, data_size, out_event);
+    int status = nt__event_new(type, buff, data_size, out_event);
+    if(status != 0)
+        return status;
+
+    out_event->flags = flags;
+    if(!nt_event_is_valid(out_event))
+        return NT_ERR_UNEXPECTED;
+
+    return 0;
 }
 
 /* ------------------------------------------------------ */
 
 static int nt__process_stdin_utf32(
+        struct nt_ctx* ctx,
         uint8_t* utf8_sbyte,
         bool alt,
         struct nt_event* out_event,
         bool* out_ignore);
 
 static int nt__process_stdin_esc(
+        struct nt_ctx* ctx,
         uint8_t* buff,
         size_t read_count,
         struct nt_event* out_event,
@@ -1086,7 +3012,57 @@ enum nt__process_stdin_state
     PROCESS_STDIN_ESC_SEQ_PROCESS // process esc sequence
 };
 
-static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
+/* Reads input of `ctx`, adding it to the record being collected. */
+static int nt__read_in(struct nt_ctx* ctx, void* data, size_t size)
+{
+    int status = nt__read_exact(ctx->in_fd, data, size, &ctx->stats.reads);
+
+    if((status == 0) && (ctx->record_fd >= 0) &&
+       (nt__chunk_put(&ctx->record, data, size) != 0))
+        ctx->record_fd = -1;
+
+    return status;
+}
+
+static int nt__process_stdin_parse(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore);
+
+/* Parses one event from the input. While recording, the bytes it took are
+ * written out as one record. */
+static int nt__process_stdin(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore)
+{
+    if(ctx->record_fd < 0)
+        return nt__process_stdin_parse(ctx, out_event, out_ignore);
+
+    struct nt_input_record header = {
+        .time_us = nt__clock_us(ctx) - ctx->record_start_us
+    };
+
+    ctx->record.len = 0;
+    if(nt__chunk_put(&ctx->record, (const char*)&header, sizeof(header)) != 0)
+    {
+        ctx->record_fd = -1;
+        return nt__process_stdin_parse(ctx, out_event, out_ignore);
+    }
+
+    int status = nt__process_stdin_parse(ctx, out_event, out_ignore);
+
+    /* A failed write stops recording rather than failing the input. */
+    if((ctx->record_fd >= 0) && (ctx->record.len > sizeof(header)))
+    {
+        header.len = (uint32_t)(ctx->record.len - sizeof(header));
+        memcpy(ctx->record.data, &header, sizeof(header));
+        if(nt__write_all(ctx->record_fd, ctx->record.data,
+                ctx->record.len, NULL) != 0)
+            ctx->record_fd = -1;
+    }
+
+    return status;
+}
+
+static int nt__process_stdin_parse(struct nt_ctx* ctx,
+        struct nt_event* out_event, bool* out_ignore)
 {
     uint8_t buff[64];
     int poll_status;
@@ -1103,7 +3079,7 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
         switch(state)
         {
             case PROCESS_STDIN_BEGIN:
-                if(nt__read_exact(STDIN_FILENO, buff, 1) != 0)
+                if(nt__read_in(ctx, buff, 1) != 0)
                     return NT_ERR_UNEXPECTED;
 
                 if(buff[0] == 0x1b)
@@ -1113,7 +3089,7 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                 break;
 
             case PROCESS_STDIN_ESC_BEGIN:
-                poll_status = nt__poll_retry(poll_fds + STDIN_POLL_FD, 1, 0);
+                poll_status = nt__poll_retry(ctx->poll_fds + STDIN_POLL_FD, 1, 0);
                 if(poll_status < 0)
                     return NT_ERR_UNEXPECTED;
 
@@ -1123,10 +3099,10 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                     return nt__event_new(NT_EVENT_KEY, &key, sizeof(key), out_event);
                 }
 
-                if(!(poll_fds[STDIN_POLL_FD].revents & POLLIN))
+                if(!(ctx->poll_fds[STDIN_POLL_FD].revents & POLLIN))
                     return NT_ERR_UNEXPECTED;
 
-                if(nt__read_exact(STDIN_FILENO, buff + 1, 1) != 0)
+                if(nt__read_in(ctx, buff + 1, 1) != 0)
                     return NT_ERR_UNEXPECTED;
 
                 state = PROCESS_STDIN_ESC_SEQ_OR_ALT;
@@ -1137,7 +3113,7 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                  * CSI (ESC [) or SS3 (ESC O). */
                 if((buff[1] == '[') || (buff[1] == 'O'))
                 {
-                    poll_status = nt__poll_retry(poll_fds + STDIN_POLL_FD, 1, 0);
+                    poll_status = nt__poll_retry(ctx->poll_fds + STDIN_POLL_FD, 1, 0);
                     if(poll_status < 0)
                         return NT_ERR_UNEXPECTED;
 
@@ -1146,7 +3122,7 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                         struct nt_key key = nt_key_utf32_new(buff[1], true);
                         return nt__event_new(NT_EVENT_KEY, &key, sizeof(key), out_event);
                     }
-                    if(!(poll_fds[STDIN_POLL_FD].revents & POLLIN))
+                    if(!(ctx->poll_fds[STDIN_POLL_FD].revents & POLLIN))
                         return NT_ERR_UNEXPECTED;
 
                     state = PROCESS_STDIN_ESC_SEQ_READ;
@@ -1160,13 +3136,14 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                 break;
 
             case PROCESS_STDIN_UTF32:
-                return nt__process_stdin_utf32(buff + alt, alt, out_event, out_ignore);
+                return nt__process_stdin_utf32(ctx, buff + alt, alt,
+                        out_event, out_ignore);
 
             case PROCESS_STDIN_ESC_SEQ_READ:
                 if(esc_seq_read_count >= (sizeof(buff) - 1))
                     return NT_ERR_UNEXPECTED;
 
-                if(nt__read_exact(STDIN_FILENO, buff + esc_seq_read_count, 1) != 0)
+                if(nt__read_in(ctx, buff + esc_seq_read_count, 1) != 0)
                 {
                     return NT_ERR_UNEXPECTED;
                 }
@@ -1180,8 +3157,8 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                     break;
                 }
 
-                poll_status = nt__poll_retry(poll_fds + STDIN_POLL_FD, 1, 0);
-                if((poll_status <= 0) || !(poll_fds[STDIN_POLL_FD].revents & POLLIN))
+                poll_status = nt__poll_retry(ctx->poll_fds + STDIN_POLL_FD, 1, 0);
+                if((poll_status <= 0) || !(ctx->poll_fds[STDIN_POLL_FD].revents & POLLIN))
                 {
                     return NT_ERR_UNEXPECTED;
                 }
@@ -1189,7 +3166,8 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
                 break;
 
             case PROCESS_STDIN_ESC_SEQ_PROCESS:
-                return nt__process_stdin_esc(buff, esc_seq_read_count, out_event, out_ignore);
+                return nt__process_stdin_esc(ctx, buff, esc_seq_read_count,
+                        out_event, out_ignore);
         }
     }
 
@@ -1197,6 +3175,7 @@ static int nt__process_stdin(struct nt_event* out_event, bool* out_ignore)
 }
 
 static int nt__process_stdin_utf32(
+        struct nt_ctx* ctx,
         uint8_t* utf8_sbyte,
         bool alt,
         struct nt_event* out_event,
@@ -1210,7 +3189,7 @@ static int nt__process_stdin_utf32(
         return NT_ERR_UNEXPECTED;
 
     if((utf32_len > 1) &&
-    (nt__read_exact(STDIN_FILENO, utf8_sbyte + 1, utf32_len - 1) != 0))
+    (nt__read_in(ctx, utf8_sbyte + 1, utf32_len - 1) != 0))
     {
         return NT_ERR_UNEXPECTED;
     }
@@ -1244,6 +3223,7 @@ nt__process_stdin_esc_mouse(
         struct nt_mouse* out_event);
 
 static int nt__process_stdin_esc(
+        struct nt_ctx* ctx,
         uint8_t* buff,
         size_t read_count,
         struct nt_event* out_event,
@@ -1264,6 +3244,7 @@ static int nt__process_stdin_esc(
     }
     else if(mouse_rv == MOUSE_EVENT_UNSUPPORTED)
     {
+        nt__stat_add(&ctx->stats.ignored_seqs, 1);
         if(out_ignore != NULL)
             *out_ignore = true;
         return 0;
@@ -1271,10 +3252,10 @@ static int nt__process_stdin_esc(
 
     int i;
     struct nt_key key;
-    struct nt_term_info term = nt__term_get_used();
+    const struct nt_term_info* term = &ctx->term.info;
     for(i = 0; i < NT_ESC_KEY_OTHER; i++)
     {
-        if(strcmp((char*)buff, term.esc_key_seqs[i]) == 0)
+        if(strcmp((char*)buff, term->esc_key_seqs[i]) == 0)
         {
             key = nt_key_esc_new(i);
             return nt__event_new(
@@ -1282,6 +3263,7 @@ static int nt__process_stdin_esc(
         }
     }
 
+    nt__stat_add(&ctx->stats.ignored_seqs, 1);
     key = nt_key_esc_new(NT_ESC_KEY_OTHER);
     return nt__event_new(NT_EVENT_KEY, &key, sizeof(key), out_event);
 }
@@ -1381,3 +3363,218 @@ nt__process_stdin_esc_mouse(
 
     return MOUSE_EVENT_SUPPORTED;
 }
+
+/* -------------------------------------------------------------------------- */
+/* DEFAULT CONTEXT */
+/* -------------------------------------------------------------------------- */
+
+int nt_buffer_enable(char* buff, size_t cap)
+{
+    return nt_ctx_buffer_enable(NULL, buff, cap);
+}
+
+int nt_buffer_disable(enum nt_buffact buffact, char** out_buff)
+{
+    return nt_ctx_buffer_disable(NULL, buffact, out_buff);
+}
+
+int nt_buffer_flush(void)
+{
+    return nt_ctx_buffer_flush(NULL);
+}
+
+void nt_output_set_sink(nt_output_sink sink, void* sink_data)
+{
+    nt_ctx_output_set_sink(NULL, sink, sink_data);
+}
+
+int nt_render_to(nt_render_fn render, void* data,
+        char* buff, size_t cap, size_t* out_len)
+{
+    return nt_ctx_render_to(NULL, render, data, buff, cap, out_len);
+}
+
+void nt_output_get_state(struct nt_output_state* out_state)
+{
+    nt_ctx_output_get_state(NULL, out_state);
+}
+
+void nt_output_set_congestion_limit(size_t limit)
+{
+    nt_ctx_output_set_congestion_limit(NULL, limit);
+}
+
+int nt_write_str(const char* str, size_t len, struct nt_gfx gfx)
+{
+    return nt_ctx_write_str(NULL, str, len, gfx);
+}
+
+int nt_write_str_unsafe(const char* str, struct nt_gfx gfx)
+{
+    return nt_ctx_write_str_unsafe(NULL, str, gfx);
+}
+
+int nt_write_str_id(const char* str, size_t len, nt_gfx_id id)
+{
+    return nt_ctx_write_str_id(NULL, str, len, id);
+}
+
+void nt_output_set_color_enc(enum nt_color_enc enc)
+{
+    nt_ctx_output_set_color_enc(NULL, enc);
+}
+
+void nt_output_set_frame_budget(size_t budget)
+{
+    nt_ctx_output_set_frame_budget(NULL, budget);
+}
+
+int nt_cursor_hide(void)
+{
+    return nt_ctx_cursor_hide(NULL);
+}
+
+int nt_cursor_show(void)
+{
+    return nt_ctx_cursor_show(NULL);
+}
+
+int nt_cursor_move(size_t x, size_t y)
+{
+    return nt_ctx_cursor_move(NULL, x, y);
+}
+
+int nt_erase_screen(void)
+{
+    return nt_ctx_erase_screen(NULL);
+}
+
+int nt_erase_line(void)
+{
+    return nt_ctx_erase_line(NULL);
+}
+
+int nt_erase_scrollback(void)
+{
+    return nt_ctx_erase_scrollback(NULL);
+}
+
+int nt_alt_screen_enable(void)
+{
+    return nt_ctx_alt_screen_enable(NULL);
+}
+
+int nt_alt_screen_disable(void)
+{
+    return nt_ctx_alt_screen_disable(NULL);
+}
+
+int nt_mouse_mode_enable(void)
+{
+    return nt_ctx_mouse_mode_enable(NULL);
+}
+
+int nt_mouse_mode_disable(void)
+{
+    return nt_ctx_mouse_mode_disable(NULL);
+}
+
+void nt_get_term_size(size_t* out_width, size_t* out_height)
+{
+    nt_ctx_get_term_size(NULL, out_width, out_height);
+}
+
+int nt_event_wait(
+        struct nt_event* out_event,
+        unsigned int timeout,
+        unsigned int* out_elapsed)
+{
+    return nt_ctx_event_wait(NULL, out_event, timeout, out_elapsed);
+}
+
+int nt_event_wait_mask(
+        struct nt_event* out_event,
+        uint32_t mask,
+        unsigned int timeout,
+        unsigned int* out_elapsed)
+{
+    return nt_ctx_event_wait_mask(NULL, out_event, mask, timeout, out_elapsed);
+}
+
+int nt_event_queue_drain(void)
+{
+    return nt_ctx_event_queue_drain(NULL);
+}
+
+int nt_event_get_fd(int* out_fd)
+{
+    return nt_ctx_event_get_fd(NULL, out_fd);
+}
+
+int nt_event_dispatch(
+        struct nt_event* out_events,
+        size_t cap,
+        size_t* out_count)
+{
+    return nt_ctx_event_dispatch(NULL, out_events, cap, out_count);
+}
+
+int nt_event_push(const struct nt_event* event)
+{
+    return nt_ctx_event_push(NULL, event);
+}
+
+int nt_event_push_payload(uint32_t type, void* payload)
+{
+    return nt_ctx_event_push_payload(NULL, type, payload);
+}
+
+int nt_event_push_keyed(const struct nt_event* event, uint32_t key)
+{
+    return nt_ctx_event_push_keyed(NULL, event, key);
+}
+
+void nt_request_redraw(void)
+{
+    nt_ctx_request_redraw(NULL);
+}
+
+int nt_present_set_fps(unsigned int fps)
+{
+    return nt_ctx_present_set_fps(NULL, fps);
+}
+
+unsigned int nt_present_get_timeout(void)
+{
+    return nt_ctx_present_get_timeout(NULL);
+}
+
+void nt_clock_set_virtual(bool enable)
+{
+    nt_ctx_clock_set_virtual(NULL, enable);
+}
+
+void nt_clock_advance(unsigned long long us)
+{
+    nt_ctx_clock_advance(NULL, us);
+}
+
+unsigned long long nt_clock_get_us(void)
+{
+    return nt_ctx_clock_get_us(NULL);
+}
+
+int nt_input_record_start(int fd)
+{
+    return nt_ctx_input_record_start(NULL, fd);
+}
+
+void nt_input_record_stop(void)
+{
+    nt_ctx_input_record_stop(NULL);
+}
+
+int nt_stats_get(struct nt_stats* out_stats)
+{
+    return nt_ctx_stats_get(NULL, out_stats);
+}
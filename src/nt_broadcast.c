@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nt.h"
+#include "nt_internal.h"
+
+/* Viewers whose terminals encode output the same way. Each frame is encoded
+ * once per class, by a render-only context whose sink appends to `diff` or
+ * `resync`. `screen` holds the previous frame, as for nt_grid_present(). */
+struct nt__bcast_class
+{
+    char** esc_func_seqs;
+    nt_term_color_count colors;
+
+    struct nt_ctx* ctx;
+    struct nt_grid* screen;
+
+    struct nt__chunk diff;
+    struct nt__chunk resync;
+    bool need_resync;
+
+    size_t viewer_count;
+};
+
+struct nt__bcast_viewer
+{
+    int fd;
+    struct nt__bcast_class* class;
+
+    /* Unwritten tail of the last frame sent, starting at `pending_pos`. */
+    struct nt__chunk pending;
+    size_t pending_pos;
+
+    /* A frame was skipped, so the next one must be a resync. */
+    bool stale;
+};
+
+struct nt_broadcast
+{
+    struct nt__bcast_class** classes;
+    size_t class_count;
+    size_t class_cap;
+
+    struct nt__bcast_viewer* viewers;
+    size_t viewer_count;
+    size_t viewer_cap;
+};
+
+/* -------------------------------------------------------------------------- */
+
+static int nt__bcast_chunk_sink(const char* data, size_t len, void* chunk)
+{
+    return nt__chunk_put(chunk, data, len);
+}
+
+static void nt__bcast_class_destroy(struct nt__bcast_class* class)
+{
+    nt_ctx_destroy(class->ctx);
+    nt_grid_destroy(class->screen);
+    free(class->diff.data);
+    free(class->resync.data);
+    free(class);
+}
+
+/* Returns the class of the terminal described by `term` and `colorterm`,
+ * creating it if needed. The status of terminal detection is stored in
+ * `out_status`. */
+static int nt__bcast_class_get(
+        struct nt_broadcast* bcast,
+        const char* term,
+        const char* colorterm,
+        struct nt__bcast_class** out_class,
+        int* out_status)
+{
+    struct nt__term info;
+    int status = nt__term_init(&info, term, colorterm);
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+        return status;
+    *out_status = status;
+
+    size_t i;
+    for(i = 0; i < bcast->class_count; i++)
+    {
+        if((bcast->classes[i]->esc_func_seqs == info.info.esc_func_seqs) &&
+           (bcast->classes[i]->colors == info.colors))
+        {
+            *out_class = bcast->classes[i];
+            nt__term_deinit(&info);
+            return 0;
+        }
+    }
+
+    if(bcast->class_count == bcast->class_cap)
+    {
+        size_t new_cap = (bcast->class_cap > 0) ? (bcast->class_cap * 2) : 4;
+        struct nt__bcast_class** new_classes = realloc(bcast->classes,
+                new_cap * sizeof(struct nt__bcast_class*));
+        if(new_classes == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        bcast->classes = new_classes;
+        bcast->class_cap = new_cap;
+    }
+
+    struct nt__bcast_class* class = calloc(1, sizeof(struct nt__bcast_class));
+    if(class == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    class->esc_func_seqs = info.info.esc_func_seqs;
+    class->colors = info.colors;
+    nt__term_deinit(&info);
+
+    status = nt_ctx_new(-1, -1, term, colorterm, &class->ctx);
+    if((status != 0) && (status != NT_ERR_TERM_NOT_SUPP))
+    {
+        free(class);
+        return status;
+    }
+
+    status = nt_grid_new(0, 0, &class->screen);
+    if(status != 0)
+    {
+        nt__bcast_class_destroy(class);
+        return status;
+    }
+
+    bcast->classes[bcast->class_count++] = class;
+    *out_class = class;
+
+    return 0;
+}
+
+static void nt__bcast_class_release(
+        struct nt_broadcast* bcast,
+        struct nt__bcast_class* class)
+{
+    if(--class->viewer_count > 0)
+        return;
+
+    size_t i;
+    for(i = 0; i < bcast->class_count; i++)
+    {
+        if(bcast->classes[i] == class)
+        {
+            bcast->classes[i] = bcast->classes[--bcast->class_count];
+            break;
+        }
+    }
+
+    nt__bcast_class_destroy(class);
+}
+
+/* Encodes the step from the previous frame to `grid` into `diff`, and a full
+ * redraw of `grid` into `resync` if a viewer needs it. */
+static int nt__bcast_class_encode(
+        struct nt__bcast_class* class,
+        struct nt_grid* grid)
+{
+    int status;
+
+    class->diff.len = 0;
+    nt_ctx_output_set_sink(class->ctx, nt__bcast_chunk_sink, &class->diff);
+    status = nt_ctx_grid_present(class->ctx, class->screen, grid);
+    if(status != 0)
+        return status;
+
+    class->resync.len = 0;
+    if(!class->need_resync)
+        return 0;
+
+    nt_ctx_output_set_sink(class->ctx, nt__bcast_chunk_sink, &class->resync);
+    status = nt_ctx_erase_screen(class->ctx);
+    if(status != 0)
+        return status;
+
+    return nt_ctx_grid_draw(class->ctx, grid);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* Writes as much of `data` as `fd` takes without blocking and stores the
+ * amount in `out_written`. */
+static int nt__bcast_write(int fd, const char* data, size_t len,
+        size_t* out_written)
+{
+    size_t written = 0;
+    ssize_t status;
+
+    while(written < len)
+    {
+        status = write(fd, data + written, len - written);
+        if(status < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                break;
+            if(errno == EPIPE)
+                nt__clear_pending_sigpipe();
+
+            *out_written = written;
+            return NT_ERR_UNEXPECTED;
+        }
+        if(status == 0)
+            break;
+
+        written += (size_t)status;
+    }
+
+    *out_written = written;
+    return 0;
+}
+
+/* Writes the rest of the viewer's pending frame. Sets `out_done` if nothing
+ * is left of it. */
+static int nt__bcast_viewer_flush(struct nt__bcast_viewer* viewer,
+        bool* out_done)
+{
+    struct nt__chunk* pending = &viewer->pending;
+    size_t written;
+
+    int status = nt__bcast_write(viewer->fd, pending->data + viewer->pending_pos,
+            pending->len - viewer->pending_pos, &written);
+
+    viewer->pending_pos += written;
+    if(viewer->pending_pos == pending->len)
+    {
+        pending->len = 0;
+        viewer->pending_pos = 0;
+    }
+
+    *out_done = (pending->len == 0);
+
+    return status;
+}
+
+/* Writes `frame` to the viewer. A partially written frame is kept as pending,
+ * an unwritten one is skipped. */
+static int nt__bcast_viewer_send(struct nt__bcast_viewer* viewer,
+        const struct nt__chunk* frame)
+{
+    size_t written;
+    int status = nt__bcast_write(viewer->fd, frame->data, frame->len,
+            &written);
+    if(status != 0)
+        return status;
+
+    if((written == 0) && (frame->len > 0))
+    {
+        viewer->stale = true;
+        return 0;
+    }
+
+    viewer->stale = false;
+    if(written < frame->len)
+    {
+        return nt__chunk_put(&viewer->pending, frame->data + written,
+                frame->len - written);
+    }
+
+    return 0;
+}
+
+static void nt__bcast_viewer_remove(struct nt_broadcast* bcast, size_t idx)
+{
+    struct nt__bcast_viewer* viewer = &bcast->viewers[idx];
+
+    nt__bcast_class_release(bcast, viewer->class);
+    free(viewer->pending.data);
+
+    bcast->viewers[idx] = bcast->viewers[--bcast->viewer_count];
+}
+
+/* -------------------------------------------------------------------------- */
+
+int nt_broadcast_new(struct nt_broadcast** out_bcast)
+{
+    if(out_bcast == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    struct nt_broadcast* bcast = calloc(1, sizeof(struct nt_broadcast));
+    if(bcast == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    *out_bcast = bcast;
+
+    return 0;
+}
+
+void nt_broadcast_destroy(struct nt_broadcast* bcast)
+{
+    if(bcast == NULL)
+        return;
+
+    while(bcast->viewer_count > 0)
+        nt__bcast_viewer_remove(bcast, bcast->viewer_count - 1);
+
+    free(bcast->viewers);
+    free(bcast->classes);
+    free(bcast);
+}
+
+/* ------------------------------------------------------ */
+
+int nt_broadcast_subscribe(
+        struct nt_broadcast* bcast,
+        int fd,
+        const char* term,
+        const char* colorterm)
+{
+    if((bcast == NULL) || (fd < 0))
+        return NT_ERR_INVALID_ARG;
+
+    size_t i;
+    for(i = 0; i < bcast->viewer_count; i++)
+    {
+        if(bcast->viewers[i].fd == fd)
+            return NT_ERR_INVALID_ARG;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0))
+        return NT_ERR_UNEXPECTED;
+
+    if(bcast->viewer_count == bcast->viewer_cap)
+    {
+        size_t new_cap = (bcast->viewer_cap > 0) ? (bcast->viewer_cap * 2) : 8;
+        struct nt__bcast_viewer* new_viewers = realloc(bcast->viewers,
+                new_cap * sizeof(struct nt__bcast_viewer));
+        if(new_viewers == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        bcast->viewers = new_viewers;
+        bcast->viewer_cap = new_cap;
+    }
+
+    struct nt__bcast_class* class;
+    int term_status;
+    int status = nt__bcast_class_get(bcast, term, colorterm, &class,
+            &term_status);
+    if(status != 0)
+        return status;
+
+    class->viewer_count++;
+    bcast->viewers[bcast->viewer_count++] = (struct nt__bcast_viewer) {
+        .fd = fd,
+        .class = class,
+        .stale = true
+    };
+
+    return term_status;
+}
+
+void nt_broadcast_unsubscribe(struct nt_broadcast* bcast, int fd)
+{
+    if(bcast == NULL)
+        return;
+
+    size_t i;
+    for(i = 0; i < bcast->viewer_count; i++)
+    {
+        if(bcast->viewers[i].fd == fd)
+        {
+            nt__bcast_viewer_remove(bcast, i);
+            return;
+        }
+    }
+}
+
+size_t nt_broadcast_get_count(const struct nt_broadcast* bcast)
+{
+    return (bcast != NULL) ? bcast->viewer_count : 0;
+}
+
+/* ------------------------------------------------------ */
+
+int nt_broadcast_present(struct nt_broadcast* bcast, struct nt_grid* grid)
+{
+    if((bcast == NULL) || (grid == NULL))
+        return NT_ERR_INVALID_ARG;
+
+    struct nt__bcast_viewer* viewer;
+    bool done;
+    size_t i;
+    int status;
+
+    for(i = 0; i < bcast->class_count; i++)
+        bcast->classes[i]->need_resync = false;
+
+    /* Viewers still writing out an earlier frame skip this one. */
+    for(i = 0; i < bcast->viewer_count; i++)
+    {
+        viewer = &bcast->viewers[i];
+        if(viewer->pending.len > 0)
+        {
+            status = nt__bcast_viewer_flush(viewer, &done);
+            if(status != 0)
+            {
+                nt__bcast_viewer_remove(bcast, i--);
+                continue;
+            }
+            if(!done)
+            {
+                viewer->stale = true;
+                continue;
+            }
+        }
+
+        if(viewer->stale)
+            viewer->class->need_resync = true;
+    }
+
+    size_t j, k;
+    for(i = 0; i < bcast->class_count; i++)
+    {
+        status = nt__bcast_class_encode(bcast->classes[i], grid);
+        if(status == 0)
+            continue;
+
+        /* The screens of classes 0..i moved on without their viewers getting
+         * the diff, so those viewers are redrawn in full next time. */
+        for(j = 0; j < bcast->viewer_count; j++)
+        {
+            viewer = &bcast->viewers[j];
+            for(k = 0; k <= i; k++)
+            {
+                if(viewer->class == bcast->classes[k])
+                    viewer->stale = true;
+            }
+        }
+
+        return status;
+    }
+
+    for(i = 0; i < bcast->viewer_count; i++)
+    {
+        viewer = &bcast->viewers[i];
+        if(viewer->pending.len > 0)
+            continue;
+
+        /* A viewer whose stream can't be completed is dropped, as resuming
+         * it mid-sequence would garble the terminal. */
+        status = nt__bcast_viewer_send(viewer, viewer->stale ?
+                &viewer->class->resync : &viewer->class->diff);
+        if(status != 0)
+            nt__bcast_viewer_remove(bcast, i--);
+    }
+
+    return 0;
+}
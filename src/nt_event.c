@@ -83,7 +83,42 @@ bool nt_event_is_valid(const struct nt_event* event)
 
     uint32_t type = event->type;
     uint8_t data_size = event->data_size;
+    uint8_t flags = event->flags;
+
+    /* Unknown bits are ignored, so events of callers that predate `flags`
+     * and leave it unset aren't rejected for them. */
+    if((flags & NT_EVENT_FLAG_PAYLOAD) && (data_size != sizeof(void*)))
+        return false;
+
     return ((type != NT_EVENT_INVALID) &&
             ((type & (type - 1)) == 0) &&
             (data_size <= NT_EVENT_DATA_MAX_SIZE));
 }
+
+int nt_event_new_payload(
+        uint32_t type,
+        void* payload,
+        struct nt_event* out_event)
+{
+    if(!payload)
+        return NT_ERR_INVALID_ARG;
+
+    int status = nt_event_new_custom(type, &payload, sizeof(void*), out_event);
+    if(status != 0)
+        return status;
+
+    out_event->flags = NT_EVENT_FLAG_PAYLOAD;
+
+    return 0;
+}
+
+void* nt_event_get_payload(const struct nt_event* event)
+{
+    if(!event || !(event->flags & NT_EVENT_FLAG_PAYLOAD))
+        return NULL;
+
+    void* payload;
+    memcpy(&payload, event->u.data, sizeof(void*));
+
+    return payload;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <stdlib.h>
+
+#include "nt.h"
+
+/* `state` holds the index of the middle grid in its lower bits and
+ * NT__FRAME_BUFF_FRESH if that grid was published after the front grid was last
+ * acquired. Both sides own one index each and trade it for the middle one
+ * with a single atomic exchange. */
+#define NT__FRAME_BUFF_IDX_MASK 3u
+#define NT__FRAME_BUFF_FRESH 4u
+
+#define NT__FRAME_BUFF_LINE 64
+
+struct nt_frame_buff
+{
+    struct nt_grid* grids[3];
+
+    /* Producer side. */
+    __attribute__((aligned(NT__FRAME_BUFF_LINE))) unsigned int back;
+
+    __attribute__((aligned(NT__FRAME_BUFF_LINE))) unsigned int state;
+
+    /* Consumer side. */
+    __attribute__((aligned(NT__FRAME_BUFF_LINE))) unsigned int front;
+};
+
+int nt_frame_buff_new(size_t width, size_t height,
+        struct nt_frame_buff** out_fbuff)
+{
+    if(out_fbuff == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    struct nt_frame_buff* fbuff;
+    if(posix_memalign((void**)&fbuff, NT__FRAME_BUFF_LINE, sizeof(*fbuff)))
+        return NT_ERR_ALLOC_FAIL;
+
+    *fbuff = (struct nt_frame_buff) {
+        .back = 0,
+        .state = 1,
+        .front = 2
+    };
+
+    size_t i;
+    for(i = 0; i < 3; i++)
+    {
+        if(nt_grid_new(width, height, &fbuff->grids[i]) != 0)
+        {
+            nt_frame_buff_destroy(fbuff);
+            return NT_ERR_ALLOC_FAIL;
+        }
+    }
+
+    *out_fbuff = fbuff;
+
+    return 0;
+}
+
+void nt_frame_buff_destroy(struct nt_frame_buff* fbuff)
+{
+    if(fbuff == NULL)
+        return;
+
+    size_t i;
+    for(i = 0; i < 3; i++)
+        nt_grid_destroy(fbuff->grids[i]);
+
+    free(fbuff);
+}
+
+/* -------------------------------------------------------------------------- */
+
+struct nt_grid* nt_frame_buff_get_back(struct nt_frame_buff* fbuff)
+{
+    return (fbuff != NULL) ? fbuff->grids[fbuff->back] : NULL;
+}
+
+void nt_frame_buff_publish(struct nt_frame_buff* fbuff)
+{
+    if(fbuff == NULL)
+        return;
+
+    /* Release makes the back grid's contents visible to the consumer, acquire
+     * makes sure it stopped reading the grid the producer gets back. */
+    unsigned int old = __atomic_exchange_n(&fbuff->state,
+            fbuff->back | NT__FRAME_BUFF_FRESH, __ATOMIC_ACQ_REL);
+
+    fbuff->back = old & NT__FRAME_BUFF_IDX_MASK;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool nt_frame_buff_acquire(struct nt_frame_buff* fbuff,
+        struct nt_grid** out_front)
+{
+    if(fbuff == NULL)
+        return false;
+
+    bool fresh = false;
+    unsigned int state = __atomic_load_n(&fbuff->state, __ATOMIC_RELAXED);
+    if(state & NT__FRAME_BUFF_FRESH)
+    {
+        unsigned int old = __atomic_exchange_n(&fbuff->state,
+                fbuff->front, __ATOMIC_ACQ_REL);
+
+        fbuff->front = old & NT__FRAME_BUFF_IDX_MASK;
+        fresh = true;
+    }
+
+    if(out_front != NULL)
+        *out_front = fbuff->grids[fbuff->front];
+
+    return fresh;
+}
+
+int nt_ctx_frame_buff_present(struct nt_ctx* ctx,
+        struct nt_frame_buff* fbuff, struct nt_grid* screen)
+{
+    if((fbuff == NULL) || (screen == NULL))
+        return NT_ERR_INVALID_ARG;
+
+    struct nt_grid* front;
+    if(!nt_frame_buff_acquire(fbuff, &front))
+        return 0;
+
+    return nt_ctx_grid_present(ctx, screen, front);
+}
+
+int nt_frame_buff_present(struct nt_frame_buff* fbuff, struct nt_grid* screen)
+{
+    return nt_ctx_frame_buff_present(NULL, fbuff, screen);
+}
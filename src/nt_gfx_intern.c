@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nt_gfx.h"
+#include "nt_internal.h"
+
+/* Entries live in fixed-size pages that are never moved or freed, so the
+ * entry of an id can be read without locking once the id is published. */
+#define NT__GFX_PAGE_SHIFT 8
+#define NT__GFX_PAGE_SIZE (1u << NT__GFX_PAGE_SHIFT)
+#define NT__GFX_PAGE_COUNT ((NT__GFX_ID_MAX >> NT__GFX_PAGE_SHIFT) + 1)
+
+/* Marks an empty slot of the hash table. Never a valid id. */
+#define NT__GFX_SLOT_EMPTY UINT16_MAX
+
+static pthread_once_t intern_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct nt__gfx_entry* pages[NT__GFX_PAGE_COUNT];
+static uint32_t entry_count; // published with release semantics
+
+/* Open addressing, linear probing. Capacity is a power of two and the table
+ * is kept at most half full. */
+static nt_gfx_id* slots;
+static size_t slot_cap;
+
+static inline uint32_t nt__hash_byte(uint32_t hash, uint8_t byte)
+{
+    return (hash ^ byte) * 16777619u;
+}
+
+static inline uint32_t nt__hash_color(uint32_t hash, const struct nt_color* color)
+{
+    hash = nt__hash_byte(hash, (uint8_t)color->code8);
+    hash = nt__hash_byte(hash, color->code256);
+    hash = nt__hash_byte(hash, color->rgb.r);
+    hash = nt__hash_byte(hash, color->rgb.g);
+    return nt__hash_byte(hash, color->rgb.b);
+}
+
+/* FNV-1a over the fields, struct padding is not hashed. */
+static uint32_t nt__hash_gfx(const struct nt_gfx* gfx)
+{
+    uint32_t hash = 2166136261u;
+
+    hash = nt__hash_color(hash, &gfx->fg);
+    hash = nt__hash_color(hash, &gfx->bg);
+    hash = nt__hash_byte(hash, gfx->style.value_c8);
+    hash = nt__hash_byte(hash, gfx->style.value_c256);
+    return nt__hash_byte(hash, gfx->style.value_rgb);
+}
+
+static inline struct nt__gfx_entry* nt__gfx_entry_at(uint32_t id)
+{
+    return &pages[id >> NT__GFX_PAGE_SHIFT][id & (NT__GFX_PAGE_SIZE - 1)];
+}
+
+static size_t nt__gfx_slot_find(
+        const nt_gfx_id* _slots,
+        size_t cap,
+        const struct nt_gfx* gfx,
+        uint32_t hash)
+{
+    size_t i = hash & (cap - 1);
+    while(_slots[i] != NT__GFX_SLOT_EMPTY)
+    {
+        if(nt_gfx_are_eql(nt__gfx_entry_at(_slots[i])->gfx, *gfx))
+            break;
+
+        i = (i + 1) & (cap - 1);
+    }
+
+    return i;
+}
+
+static int nt__gfx_slots_grow(void)
+{
+    size_t new_cap = (slot_cap > 0) ? (slot_cap * 2) : 64;
+    nt_gfx_id* new_slots = malloc(new_cap * sizeof(nt_gfx_id));
+    if(new_slots == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    size_t i;
+    for(i = 0; i < new_cap; i++)
+        new_slots[i] = NT__GFX_SLOT_EMPTY;
+
+    const struct nt_gfx* gfx;
+    for(i = 0; i < slot_cap; i++)
+    {
+        if(slots[i] == NT__GFX_SLOT_EMPTY)
+            continue;
+
+        gfx = &nt__gfx_entry_at(slots[i])->gfx;
+        new_slots[nt__gfx_slot_find(new_slots, new_cap, gfx,
+                nt__hash_gfx(gfx))] = slots[i];
+    }
+
+    free(slots);
+    slots = new_slots;
+    slot_cap = new_cap;
+
+    return 0;
+}
+
+/* Called with `intern_lock` held. */
+static int nt__gfx_intern(const struct nt_gfx* gfx, nt_gfx_id* out_id)
+{
+    if(((entry_count + 1) * 2) > slot_cap)
+    {
+        int status = nt__gfx_slots_grow();
+        if(status != 0)
+            return status;
+    }
+
+    uint32_t hash = nt__hash_gfx(gfx);
+    size_t slot = nt__gfx_slot_find(slots, slot_cap, gfx, hash);
+    if(slots[slot] != NT__GFX_SLOT_EMPTY)
+    {
+        *out_id = slots[slot];
+        return 0;
+    }
+
+    uint32_t id = entry_count;
+    if(id > NT__GFX_ID_MAX)
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    struct nt__gfx_entry** page = &pages[id >> NT__GFX_PAGE_SHIFT];
+    if(*page == NULL)
+    {
+        *page = calloc(NT__GFX_PAGE_SIZE, sizeof(struct nt__gfx_entry));
+        if(*page == NULL)
+            return NT_ERR_ALLOC_FAIL;
+    }
+
+    nt__gfx_entry_at(id)->gfx = *gfx;
+    slots[slot] = (nt_gfx_id)id;
+    __atomic_store_n(&entry_count, id + 1, __ATOMIC_RELEASE);
+
+    *out_id = (nt_gfx_id)id;
+    return 0;
+}
+
+static void nt__gfx_intern_init(void)
+{
+    nt_gfx_id id;
+
+    pthread_mutex_lock(&intern_lock);
+    /* If this fails, NT_GFX_ID_DEFAULT is interned by the first successful
+     * nt_gfx_intern() instead, which interns the default gfx first. */
+    nt__gfx_intern(&NT_GFX_DEFAULT, &id);
+    pthread_mutex_unlock(&intern_lock);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int nt_gfx_intern(struct nt_gfx gfx, nt_gfx_id* out_id)
+{
+    if(out_id == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    pthread_once(&intern_once, nt__gfx_intern_init);
+
+    int status;
+    nt_gfx_id id;
+
+    pthread_mutex_lock(&intern_lock);
+    status = (entry_count == 0) ? nt__gfx_intern(&NT_GFX_DEFAULT, &id) : 0;
+    if(status == 0)
+        status = nt__gfx_intern(&gfx, out_id);
+    pthread_mutex_unlock(&intern_lock);
+
+    return status;
+}
+
+int nt_gfx_get(nt_gfx_id id, struct nt_gfx* out_gfx)
+{
+    if(out_gfx == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    const struct nt__gfx_entry* entry = nt__gfx_entry_get(id);
+    if(entry == NULL)
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    *out_gfx = entry->gfx;
+
+    return 0;
+}
+
+const struct nt__gfx_entry* nt__gfx_entry_get(nt_gfx_id id)
+{
+    pthread_once(&intern_once, nt__gfx_intern_init);
+
+    if(id >= __atomic_load_n(&entry_count, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    return nt__gfx_entry_at(id);
+}
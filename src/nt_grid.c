@@ -0,0 +1,888 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nt.h"
+#include "nt_internal.h"
+#include "uconv.h"
+
+/* Rows start on a 32-byte boundary, the width of an AVX2 register. */
+#define NT__GRID_ALIGN 32
+
+/* Bytes of a row run collected before being written. */
+#define NT__GRID_RUN_CAP 1024
+
+struct nt__grapheme
+{
+    uint32_t off, len; // in `graph_buff`
+};
+
+/* Row flags. */
+#define NT__GRID_ROW_DIRTY (1u << 0) // `row_hashes` entry is not valid
+#define NT__GRID_ROW_GRAPH (1u << 1) // row may hold grapheme cells
+
+struct nt_grid
+{
+    size_t width, height, stride;
+    uint32_t* cps;
+    uint32_t* attrs;
+
+    uint64_t* row_hashes;
+    uint8_t* row_flags;
+
+    char* graph_buff;
+    size_t graph_buff_len, graph_buff_cap;
+    struct nt__grapheme* graphs;
+    size_t graph_count, graph_cap;
+};
+
+static inline size_t nt__grid_stride_of(size_t width)
+{
+    return (width + (NT_GRID_ROW_ALIGN - 1)) & ~((size_t)NT_GRID_ROW_ALIGN - 1);
+}
+
+static uint32_t* nt__grid_alloc_cells(size_t count)
+{
+    void* cells;
+
+    if(count == 0)
+        count = 1;
+    if(count > (SIZE_MAX / sizeof(uint32_t)))
+        return NULL;
+    if(posix_memalign(&cells, NT__GRID_ALIGN, count * sizeof(uint32_t)) != 0)
+        return NULL;
+
+    return cells;
+}
+
+static void nt__grid_fill(struct nt_grid* grid, nt_gfx_id gfx)
+{
+    size_t count = grid->stride * grid->height;
+    uint32_t attr = nt_cell_attr_new(gfx, 0);
+
+    memset(grid->cps, 0, count * sizeof(uint32_t));
+    memset(grid->attrs, 0, count * sizeof(uint32_t));
+    memset(grid->row_flags, NT__GRID_ROW_DIRTY, grid->height);
+
+    size_t x, y;
+    uint32_t *cps, *attrs;
+    for(y = 0; y < grid->height; y++)
+    {
+        cps = grid->cps + (y * grid->stride);
+        attrs = grid->attrs + (y * grid->stride);
+        for(x = 0; x < grid->width; x++)
+        {
+            cps[x] = ' ';
+            attrs[x] = attr;
+        }
+    }
+}
+
+int nt_grid_new(size_t width, size_t height, struct nt_grid** out_grid)
+{
+    if(out_grid == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    struct nt_grid* grid = calloc(1, sizeof(struct nt_grid));
+    if(grid == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    int status = nt_grid_resize(grid, width, height);
+    if(status != 0)
+    {
+        free(grid);
+        return status;
+    }
+
+    *out_grid = grid;
+
+    return 0;
+}
+
+void nt_grid_destroy(struct nt_grid* grid)
+{
+    if(grid == NULL)
+        return;
+
+    free(grid->cps);
+    free(grid->attrs);
+    free(grid->row_hashes);
+    free(grid->row_flags);
+    free(grid->graph_buff);
+    free(grid->graphs);
+    free(grid);
+}
+
+int nt_grid_resize(struct nt_grid* grid, size_t width, size_t height)
+{
+    if(grid == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    size_t stride = nt__grid_stride_of(width);
+    if((stride < width) || ((height > 0) && (stride > (SIZE_MAX / height))))
+        return NT_ERR_ALLOC_FAIL;
+
+    uint32_t* cps = nt__grid_alloc_cells(stride * height);
+    uint32_t* attrs = nt__grid_alloc_cells(stride * height);
+    uint64_t* row_hashes = malloc((height + 1) * sizeof(uint64_t));
+    uint8_t* row_flags = malloc(height + 1);
+    if((cps == NULL) || (attrs == NULL) ||
+       (row_hashes == NULL) || (row_flags == NULL))
+    {
+        free(cps);
+        free(attrs);
+        free(row_hashes);
+        free(row_flags);
+        return NT_ERR_ALLOC_FAIL;
+    }
+
+    free(grid->cps);
+    free(grid->attrs);
+    free(grid->row_hashes);
+    free(grid->row_flags);
+    grid->cps = cps;
+    grid->attrs = attrs;
+    grid->row_hashes = row_hashes;
+    grid->row_flags = row_flags;
+    grid->width = width;
+    grid->height = height;
+    grid->stride = stride;
+
+    nt_grid_clear(grid, NT_GFX_ID_DEFAULT);
+
+    return 0;
+}
+
+void nt_grid_get_size(const struct nt_grid* grid,
+        size_t* out_width, size_t* out_height)
+{
+    if(out_width != NULL)
+        *out_width = (grid != NULL) ? grid->width : 0;
+    if(out_height != NULL)
+        *out_height = (grid != NULL) ? grid->height : 0;
+}
+
+void nt_grid_clear(struct nt_grid* grid, nt_gfx_id gfx)
+{
+    if(grid == NULL)
+        return;
+
+    nt__grid_fill(grid, gfx);
+    grid->graph_buff_len = 0;
+    grid->graph_count = 0;
+}
+
+/* ------------------------------------------------------ */
+
+/* Splits the double-width character covering cell `idx` at column `x` before
+ * the cell is overwritten. Its other half becomes a blank narrow cell, so no
+ * stale half is skipped or overdrawn when the row is drawn. */
+static void nt__grid_unpair(struct nt_grid* grid, size_t x, size_t idx)
+{
+    uint16_t flags = nt_cell_attr_flags(grid->attrs[idx]);
+    size_t other;
+
+    if((flags & NT_CELL_WIDE) && ((x + 1) < grid->width) &&
+       (nt_cell_attr_flags(grid->attrs[idx + 1]) & NT_CELL_CONT))
+        other = idx + 1;
+    else if((flags & NT_CELL_CONT) && (x > 0))
+        other = idx - 1;
+    else
+        return;
+
+    grid->cps[other] = ' ';
+    grid->attrs[other] = nt_cell_attr_new(
+            nt_cell_attr_gfx(grid->attrs[other]), 0);
+}
+
+static void nt__grid_put(struct nt_grid* grid, size_t x, size_t y,
+        uint32_t cp, nt_gfx_id gfx, uint16_t flags)
+{
+    size_t idx = (y * grid->stride) + x;
+
+    nt__grid_unpair(grid, x, idx);
+    if((flags & NT_CELL_WIDE) && ((x + 1) < grid->width))
+        nt__grid_unpair(grid, x + 1, idx + 1);
+
+    grid->cps[idx] = cp;
+    grid->attrs[idx] = nt_cell_attr_new(gfx, flags);
+    grid->row_flags[y] |= NT__GRID_ROW_DIRTY;
+    if(flags & NT_CELL_GRAPHEME)
+        grid->row_flags[y] |= NT__GRID_ROW_GRAPH;
+
+    if((flags & NT_CELL_WIDE) && ((x + 1) < grid->width))
+    {
+        grid->cps[idx + 1] = ' ';
+        grid->attrs[idx + 1] = nt_cell_attr_new(gfx, NT_CELL_CONT);
+    }
+}
+
+int nt_grid_set(struct nt_grid* grid, size_t x, size_t y, struct nt_cell cell)
+{
+    if(grid == NULL)
+        return NT_ERR_INVALID_ARG;
+    if((x >= grid->width) || (y >= grid->height))
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    nt__grid_put(grid, x, y, cell.cp, cell.gfx, cell.flags);
+
+    return 0;
+}
+
+/* Appends `len` bytes of `str` to the grapheme table of `grid`. */
+static int nt__grid_graph_append(struct nt_grid* grid,
+        const char* str, size_t len, uint32_t* out_idx)
+{
+    if((len > UINT32_MAX) || ((grid->graph_buff_len + len) > UINT32_MAX) ||
+       (grid->graph_count >= UINT32_MAX))
+        return NT_ERR_ALLOC_FAIL;
+
+    if((grid->graph_buff_len + len) > grid->graph_buff_cap)
+    {
+        size_t new_cap = (grid->graph_buff_cap > 0) ? grid->graph_buff_cap : 256;
+        while(new_cap < (grid->graph_buff_len + len))
+            new_cap *= 2;
+
+        char* new_buff = realloc(grid->graph_buff, new_cap);
+        if(new_buff == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        grid->graph_buff = new_buff;
+        grid->graph_buff_cap = new_cap;
+    }
+
+    if(grid->graph_count == grid->graph_cap)
+    {
+        size_t new_cap = (grid->graph_cap > 0) ? (grid->graph_cap * 2) : 32;
+        struct nt__grapheme* new_graphs = realloc(grid->graphs,
+                new_cap * sizeof(struct nt__grapheme));
+        if(new_graphs == NULL)
+            return NT_ERR_ALLOC_FAIL;
+
+        grid->graphs = new_graphs;
+        grid->graph_cap = new_cap;
+    }
+
+    memcpy(grid->graph_buff + grid->graph_buff_len, str, len);
+    grid->graphs[grid->graph_count] = (struct nt__grapheme) {
+        .off = (uint32_t)grid->graph_buff_len,
+        .len = (uint32_t)len
+    };
+    grid->graph_buff_len += len;
+
+    *out_idx = (uint32_t)grid->graph_count;
+    grid->graph_count++;
+
+    return 0;
+}
+
+int nt_grid_set_grapheme(struct nt_grid* grid, size_t x, size_t y,
+        const char* str, size_t len, nt_gfx_id gfx, uint16_t flags)
+{
+    if((grid == NULL) || (str == NULL) || (len == 0))
+        return NT_ERR_INVALID_ARG;
+    if((x >= grid->width) || (y >= grid->height))
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    uint32_t idx;
+    int status = nt__grid_graph_append(grid, str, len, &idx);
+    if(status != 0)
+        return status;
+
+    nt__grid_put(grid, x, y, idx, gfx,
+            (flags & ~NT_CELL_CONT) | NT_CELL_GRAPHEME);
+
+    return 0;
+}
+
+int nt_grid_get(const struct nt_grid* grid, size_t x, size_t y,
+        struct nt_cell* out_cell)
+{
+    if((grid == NULL) || (out_cell == NULL))
+        return NT_ERR_INVALID_ARG;
+    if((x >= grid->width) || (y >= grid->height))
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    size_t idx = (y * grid->stride) + x;
+    *out_cell = (struct nt_cell) {
+        .cp = grid->cps[idx],
+        .gfx = nt_cell_attr_gfx(grid->attrs[idx]),
+        .flags = nt_cell_attr_flags(grid->attrs[idx])
+    };
+
+    return 0;
+}
+
+const char* nt_grid_get_grapheme(const struct nt_grid* grid,
+        uint32_t idx, size_t* out_len)
+{
+    if((grid == NULL) || (idx >= grid->graph_count))
+        return NULL;
+
+    if(out_len != NULL)
+        *out_len = grid->graphs[idx].len;
+
+    return grid->graph_buff + grid->graphs[idx].off;
+}
+
+/* ------------------------------------------------------ */
+
+const uint32_t* nt_grid_row_cps(const struct nt_grid* grid, size_t y)
+{
+    if((grid == NULL) || (y >= grid->height))
+        return NULL;
+
+    return grid->cps + (y * grid->stride);
+}
+
+const uint32_t* nt_grid_row_attrs(const struct nt_grid* grid, size_t y)
+{
+    if((grid == NULL) || (y >= grid->height))
+        return NULL;
+
+    return grid->attrs + (y * grid->stride);
+}
+
+size_t nt_grid_get_stride(const struct nt_grid* grid)
+{
+    return (grid != NULL) ? grid->stride : 0;
+}
+
+/* ------------------------------------------------------ */
+
+/* Stores in `out` the UTF-8 bytes to draw for a cell and returns their count,
+ * or points `out_ext` to them if they are stored in the grapheme table.
+ * Control characters are drawn as spaces and invalid code points as U+FFFD. */
+static size_t nt__grid_cell_utf8(const struct nt_grid* grid, uint32_t cp,
+        uint16_t flags, char* out, const char** out_ext)
+{
+    size_t len;
+
+    *out_ext = NULL;
+    if(flags & NT_CELL_GRAPHEME)
+    {
+        *out_ext = nt_grid_get_grapheme(grid, cp, &len);
+        if(*out_ext != NULL)
+            return len;
+
+        cp = 0xFFFD;
+    }
+
+    if((cp < 0x20) || (cp == 0x7F))
+    {
+        out[0] = ' ';
+        return 1;
+    }
+    if(cp < 0x80)
+    {
+        out[0] = (char)cp;
+        return 1;
+    }
+
+    if(uc_utf32_to_utf8_single(cp, 0, (uint8_t*)out, &len) != 0)
+        uc_utf32_to_utf8_single(0xFFFD, 0, (uint8_t*)out, &len);
+
+    return len;
+}
+
+/* Draws cells [`x0`, `x1`) of row `y` at the same terminal position, to
+ * `chunk` or to the output of `ctx` if `chunk` is NULL. */
+static int nt__grid_draw_span(struct nt_ctx* ctx, const struct nt_grid* grid,
+        struct nt__chunk* chunk, size_t y, size_t x0, size_t x1)
+{
+    char run[NT__GRID_RUN_CAP];
+    size_t run_len = 0;
+    nt_gfx_id run_gfx = NT_GFX_ID_DEFAULT;
+
+    char utf8[4];
+    const char* ext;
+    size_t utf8_len;
+
+    const uint32_t* cps = grid->cps + (y * grid->stride);
+    const uint32_t* attrs = grid->attrs + (y * grid->stride);
+    nt_gfx_id gfx;
+    uint16_t flags;
+    size_t x;
+    int status;
+
+    status = nt__encode_cursor_move(ctx, chunk, x0, y);
+    if(status != 0)
+        return status;
+
+    for(x = x0; x < x1; x++)
+    {
+        flags = nt_cell_attr_flags(attrs[x]);
+        if(flags & NT_CELL_CONT)
+            continue;
+
+        gfx = nt_cell_attr_gfx(attrs[x]);
+        utf8_len = nt__grid_cell_utf8(grid, cps[x], flags, utf8, &ext);
+
+        if((run_len > 0) && ((gfx != run_gfx) ||
+           ((run_len + utf8_len) > sizeof(run))))
+        {
+            status = nt__encode_str_id(ctx, chunk, run, run_len, run_gfx);
+            if(status != 0)
+                return status;
+            run_len = 0;
+        }
+
+        run_gfx = gfx;
+        if(utf8_len > sizeof(run))
+        {
+            status = nt__encode_str_id(ctx, chunk, ext, utf8_len, gfx);
+            if(status != 0)
+                return status;
+            continue;
+        }
+
+        memcpy(run + run_len, (ext != NULL) ? ext : utf8, utf8_len);
+        run_len += utf8_len;
+    }
+
+    if(run_len > 0)
+        return nt__encode_str_id(ctx, chunk, run, run_len, run_gfx);
+
+    return 0;
+}
+
+int nt_ctx_grid_draw(struct nt_ctx* ctx, const struct nt_grid* grid)
+{
+    if(grid == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    nt__verify_frame_begin(ctx, grid, true);
+
+    size_t y;
+    int status;
+    for(y = 0; y < grid->height; y++)
+    {
+        status = nt__grid_draw_span(ctx, grid, NULL, y, 0, grid->width);
+        if(status != 0)
+            return status;
+    }
+
+    nt__verify_frame_end(ctx, grid);
+
+    return 0;
+}
+
+size_t nt__grid_get_utf8(const struct nt_grid* grid, size_t x, size_t y,
+        char* out, const char** out_ext)
+{
+    size_t idx = (y * grid->stride) + x;
+
+    return nt__grid_cell_utf8(grid, grid->cps[idx],
+            nt_cell_attr_flags(grid->attrs[idx]), out, out_ext);
+}
+
+/* ------------------------------------------------------ */
+/* PRESENT */
+/* ------------------------------------------------------ */
+
+static inline bool nt__grid_row_hashed(const struct nt_grid* grid, size_t y)
+{
+    return !(grid->row_flags[y] & NT__GRID_ROW_DIRTY);
+}
+
+static inline void nt__grid_row_set_hash(struct nt_grid* grid, size_t y,
+        uint64_t hash)
+{
+    grid->row_hashes[y] = hash;
+    grid->row_flags[y] &= ~NT__GRID_ROW_DIRTY;
+}
+
+static bool nt__grid_graph_eql(const struct nt_grid* grid1, uint32_t idx1,
+        const struct nt_grid* grid2, uint32_t idx2)
+{
+    size_t len1, len2;
+    const char* graph1 = nt_grid_get_grapheme(grid1, idx1, &len1);
+    const char* graph2 = nt_grid_get_grapheme(grid2, idx2, &len2);
+
+    if((graph1 == NULL) || (graph2 == NULL))
+        return (graph1 == graph2);
+
+    return ((len1 == len2) && (memcmp(graph1, graph2, len1) == 0));
+}
+
+/* Finds the span of row `y` to redraw, in [`*out_first`, `*out_last`]. Returns
+ * false if the row needs no redraw. */
+static bool nt__grid_row_diff(struct nt_grid* screen, struct nt_grid* grid,
+        size_t y, size_t* out_first, size_t* out_last)
+{
+    size_t off = y * grid->stride;
+    bool graphs = ((screen->row_flags[y] | grid->row_flags[y]) &
+            NT__GRID_ROW_GRAPH);
+
+    /* Grapheme cells store table indices, equal words don't mean equal
+     * contents, so hashes can't skip such rows. Hashing reads one row while
+     * comparing reads two, and `screen` inherits the hash once it matches
+     * `grid`, so rows that stay unchanged are read once per frame. */
+    if(!graphs)
+    {
+        if(!nt__grid_row_hashed(grid, y))
+        {
+            nt__grid_row_set_hash(grid, y, nt__row_hash(grid->cps + off,
+                    grid->attrs + off, grid->stride));
+        }
+
+        if(nt__grid_row_hashed(screen, y) &&
+           (screen->row_hashes[y] == grid->row_hashes[y]))
+            return false;
+    }
+
+    size_t first = grid->width, last = 0;
+    bool diff = nt__row_diff(screen->cps + off, screen->attrs + off,
+            grid->cps + off, grid->attrs + off, grid->stride, &first, &last);
+
+    if(graphs)
+    {
+        size_t x;
+        for(x = 0; x < grid->width; x++)
+        {
+            if(diff && (x >= first) && (x <= last))
+                continue;
+            if(!(nt_cell_attr_flags(grid->attrs[off + x]) & NT_CELL_GRAPHEME))
+                continue;
+            if((screen->cps[off + x] != grid->cps[off + x]) ||
+               (screen->attrs[off + x] != grid->attrs[off + x]))
+                continue;
+
+            if(!nt__grid_graph_eql(screen, screen->cps[off + x],
+                        grid, grid->cps[off + x]))
+            {
+                first = (!diff || (x < first)) ? x : first;
+                last = (!diff || (x > last)) ? x : last;
+                diff = true;
+            }
+        }
+    }
+
+    if(!diff)
+    {
+        if(!graphs)
+            nt__grid_row_set_hash(screen, y, grid->row_hashes[y]);
+        return false;
+    }
+
+    /* Redraw whole double-width characters on both sides of the span. */
+    if((first > 0) && ((nt_cell_attr_flags(screen->attrs[off + first]) |
+         nt_cell_attr_flags(grid->attrs[off + first])) & NT_CELL_CONT))
+        first--;
+    if(((last + 1) < grid->width) &&
+       ((nt_cell_attr_flags(screen->attrs[off + last]) |
+         nt_cell_attr_flags(grid->attrs[off + last])) & NT_CELL_WIDE))
+        last++;
+
+    *out_first = first;
+    *out_last = last;
+
+    return true;
+}
+
+/* Copies cells [`x0`, `x1`) of row `y` from `src` to `dst`. Grapheme clusters
+ * are copied into the table of `dst`. If that fails, the cell gets U+FFFD so
+ * that it differs from `src` and is drawn again. */
+static void nt__grid_copy_span(struct nt_grid* dst, const struct nt_grid* src,
+        size_t y, size_t x0, size_t x1)
+{
+    size_t off = y * src->stride;
+
+    memcpy(dst->cps + off + x0, src->cps + off + x0,
+            (x1 - x0) * sizeof(uint32_t));
+    memcpy(dst->attrs + off + x0, src->attrs + off + x0,
+            (x1 - x0) * sizeof(uint32_t));
+    dst->row_flags[y] |= NT__GRID_ROW_DIRTY;
+
+    if(!(src->row_flags[y] & NT__GRID_ROW_GRAPH))
+        return;
+
+    dst->row_flags[y] |= NT__GRID_ROW_GRAPH;
+
+    const char* graph;
+    size_t x, len;
+    uint32_t idx;
+    for(x = x0; x < x1; x++)
+    {
+        if(!(nt_cell_attr_flags(src->attrs[off + x]) & NT_CELL_GRAPHEME))
+            continue;
+
+        graph = nt_grid_get_grapheme(src, src->cps[off + x], &len);
+        if((graph != NULL) &&
+           (nt__grid_graph_append(dst, graph, len, &idx) == 0))
+        {
+            dst->cps[off + x] = idx;
+        }
+        else
+        {
+            dst->cps[off + x] = 0xFFFD;
+            dst->attrs[off + x] &= ~(((uint32_t)NT_CELL_GRAPHEME) << 16);
+        }
+    }
+}
+
+int nt__grid_copy(struct nt_grid* dst, const struct nt_grid* src)
+{
+    int status;
+    if((dst->width != src->width) || (dst->height != src->height))
+    {
+        status = nt_grid_resize(dst, src->width, src->height);
+        if(status != 0)
+            return status;
+    }
+    else
+        nt_grid_clear(dst, NT_GFX_ID_DEFAULT);
+
+    size_t y;
+    for(y = 0; y < src->height; y++)
+        nt__grid_copy_span(dst, src, y, 0, src->width);
+
+    return 0;
+}
+
+/* Rebuilds the grapheme table of `grid` with only the clusters its cells
+ * still reference. */
+static void nt__grid_graph_compact(struct nt_grid* grid)
+{
+    struct nt_grid old = *grid;
+
+    grid->graph_buff = NULL;
+    grid->graph_buff_len = grid->graph_buff_cap = 0;
+    grid->graphs = NULL;
+    grid->graph_count = grid->graph_cap = 0;
+
+    const char* graph;
+    size_t x, y, off, len;
+    uint32_t idx;
+    for(y = 0; y < grid->height; y++)
+    {
+        if(!(grid->row_flags[y] & NT__GRID_ROW_GRAPH))
+            continue;
+
+        off = y * grid->stride;
+        for(x = 0; x < grid->width; x++)
+        {
+            if(!(nt_cell_attr_flags(grid->attrs[off + x]) & NT_CELL_GRAPHEME))
+                continue;
+
+            graph = nt_grid_get_grapheme(&old, grid->cps[off + x], &len);
+            if((graph != NULL) &&
+               (nt__grid_graph_append(grid, graph, len, &idx) == 0))
+            {
+                grid->cps[off + x] = idx;
+            }
+            else
+            {
+                grid->cps[off + x] = 0xFFFD;
+                grid->attrs[off + x] &= ~(((uint32_t)NT_CELL_GRAPHEME) << 16);
+            }
+        }
+        grid->row_flags[y] |= NT__GRID_ROW_DIRTY;
+    }
+
+    free(old.graph_buff);
+    free(old.graphs);
+}
+
+/* Updates row `y` of `screen` after cells [`first`, `last`] were drawn. */
+static inline void nt__grid_row_sync(struct nt_grid* screen,
+        struct nt_grid* grid, size_t y, size_t first, size_t last)
+{
+    nt__grid_copy_span(screen, grid, y, first, last + 1);
+    if(!((screen->row_flags[y] | grid->row_flags[y]) & NT__GRID_ROW_GRAPH))
+        nt__grid_row_set_hash(screen, y, grid->row_hashes[y]);
+}
+
+/* ------------------------------------------------------ */
+/* BANDS */
+/* ------------------------------------------------------ */
+
+static unsigned int present_threads = 1;
+
+/* Reused across frames. Only touched by the thread holding `bands_lock`, and
+ * by the band tasks it waits for. Contexts presenting while it is held encode
+ * on their own thread. */
+static pthread_mutex_t bands_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct nt__chunk band_chunks[NT__CHUNKS_MAX];
+
+struct nt__band_job
+{
+    struct nt_ctx* ctx;
+    struct nt_grid* screen;
+    struct nt_grid* grid;
+    size_t band_rows;
+
+    /* Per row: first and last drawn cell, first > last if none. */
+    size_t* spans;
+
+    /* Per band. */
+    int statuses[NT__CHUNKS_MAX];
+};
+
+/* Every span starts with a cursor move and every run with a gfx reset, so no
+ * terminal state carries over from one band into the next. Each band is
+ * therefore encoded exactly as the serial loop would encode it. */
+static void nt__grid_band_encode(void* _job, size_t band)
+{
+    struct nt__band_job* job = _job;
+    struct nt__chunk* chunk = &band_chunks[band];
+    size_t y0 = band * job->band_rows;
+    size_t y1 = y0 + job->band_rows;
+    size_t y, *span;
+
+    if(y1 > job->grid->height)
+        y1 = job->grid->height;
+
+    chunk->len = 0;
+    chunk->sgr_len = 0;
+    chunk->cursor_len = 0;
+    job->statuses[band] = 0;
+    for(y = y0; y < y1; y++)
+    {
+        span = &job->spans[2 * y];
+        if(!nt__grid_row_diff(job->screen, job->grid, y, &span[0], &span[1]))
+        {
+            span[0] = 1;
+            span[1] = 0;
+            continue;
+        }
+
+        job->statuses[band] = nt__grid_draw_span(job->ctx, job->grid, chunk,
+                y, span[0], span[1] + 1);
+        if(job->statuses[band] != 0)
+            return;
+    }
+}
+
+/* Must be called with `bands_lock` held. */
+static int nt__grid_present_bands(struct nt_ctx* ctx,
+        struct nt_grid* screen, struct nt_grid* grid)
+{
+    size_t bands = (present_threads < grid->height) ?
+        present_threads : grid->height;
+
+    struct nt__band_job job = {
+        .ctx = ctx,
+        .screen = screen,
+        .grid = grid,
+        .band_rows = (grid->height + bands - 1) / bands,
+        .spans = malloc(2 * grid->height * sizeof(size_t))
+    };
+    if(job.spans == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    bands = (grid->height + job.band_rows - 1) / job.band_rows;
+    nt__workers_run(nt__grid_band_encode, &job, bands);
+
+    size_t i, y;
+    int status = 0;
+    for(i = 0; (i < bands) && (status == 0); i++)
+        status = job.statuses[i];
+
+    if(status == 0)
+        status = nt__write_chunks(ctx, band_chunks, bands);
+
+    if(status == 0)
+    {
+        for(y = 0; y < grid->height; y++)
+        {
+            if(job.spans[2 * y] <= job.spans[(2 * y) + 1])
+                nt__grid_row_sync(screen, grid, y,
+                        job.spans[2 * y], job.spans[(2 * y) + 1]);
+        }
+    }
+
+    free(job.spans);
+
+    return status;
+}
+
+int nt_grid_set_present_threads(unsigned int threads)
+{
+    if((threads == 0) || (threads > NT_GRID_PRESENT_THREADS_MAX))
+        return NT_ERR_INVALID_ARG;
+
+    int status = nt__workers_set(threads - 1);
+    present_threads = nt__workers_get() + 1;
+
+    return status;
+}
+
+/* ------------------------------------------------------ */
+
+int nt_ctx_grid_present(struct nt_ctx* ctx,
+        struct nt_grid* screen, struct nt_grid* grid)
+{
+    if((screen == NULL) || (grid == NULL) || (screen == grid))
+        return NT_ERR_INVALID_ARG;
+
+    int status;
+    size_t y;
+
+    nt__verify_frame_begin(ctx, grid, false);
+
+    if((screen->width != grid->width) || (screen->height != grid->height))
+    {
+        status = nt_grid_resize(screen, grid->width, grid->height);
+        if(status != 0)
+            return status;
+
+        status = nt_ctx_grid_draw(ctx, grid);
+        if(status != 0)
+            return status;
+
+        for(y = 0; y < grid->height; y++)
+            nt__grid_copy_span(screen, grid, y, 0, grid->width);
+
+        return 0;
+    }
+
+    bool banded = (present_threads > 1) && (grid->height > 1) &&
+        nt__encode_is_exact(ctx) && (pthread_mutex_trylock(&bands_lock) == 0);
+
+    if(banded)
+    {
+        status = nt__grid_present_bands(ctx, screen, grid);
+        pthread_mutex_unlock(&bands_lock);
+        if(status != 0)
+            return status;
+    }
+    else
+    {
+        size_t first, last;
+        for(y = 0; y < grid->height; y++)
+        {
+            if(!nt__grid_row_diff(screen, grid, y, &first, &last))
+                continue;
+
+            status = nt__grid_draw_span(ctx, grid, NULL, y, first, last + 1);
+            if(status != 0)
+                return status;
+
+            nt__grid_row_sync(screen, grid, y, first, last);
+        }
+    }
+
+    if(screen->graph_buff_len > ((grid->graph_buff_len * 2) + 4096))
+        nt__grid_graph_compact(screen);
+
+    nt__verify_frame_end(ctx, grid);
+
+    return 0;
+}
+
+/* ------------------------------------------------------ */
+
+int nt_grid_draw(const struct nt_grid* grid)
+{
+    return nt_ctx_grid_draw(NULL, grid);
+}
+
+int nt_grid_present(struct nt_grid* screen, struct nt_grid* grid)
+{
+    return nt_ctx_grid_present(NULL, screen, grid);
+}
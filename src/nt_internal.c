@@ -1,3 +1,4 @@
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -5,9 +6,6 @@
 #include <string.h>
 #include "nt_internal.h"
 
-static nt_term_color_count nt__color = NT_TERM_COLOR_OTHER;
-static struct nt_term_info nt__term = {0};
-
 static char* xterm_esc_key_seqs[] = {
     // F keys
     "\x1b\x4f\x50", "\x1b\x4f\x51", "\x1b\x4f\x52", "\x1b\x4f\x53",
@@ -319,11 +317,92 @@ static struct nt_term_info terms[] = {
     }
 };
 
-int nt__term_init(void)
+static void nt__esc_frag_init(struct nt__esc_frag* frag, const char* fmt, ...)
 {
-    char* env_term = getenv("TERM");
-    char* env_colorterm = getenv("COLORTERM");
+    frag->len = 0;
+    if(fmt == NULL)
+        return;
+
+    va_list list;
+    va_start(list, fmt);
+    int status = vsnprintf(frag->seq, sizeof(frag->seq), fmt, list);
+    va_end(list);
+
+    if((status > 0) && ((size_t)status < sizeof(frag->seq)))
+        frag->len = (uint8_t)status;
+}
+
+/* RGB sequences must have the form <prefix>%d;%d;%dm. Only the prefix is
+ * cached, the rest is rendered per color. */
+static void nt__esc_frag_init_rgb(struct nt__esc_frag* frag, const char* fmt)
+{
+    const char* suffix = "%d;%d;%dm";
+
+    frag->len = 0;
+    if(fmt == NULL)
+        return;
+
+    size_t fmt_len = strlen(fmt);
+    size_t suffix_len = strlen(suffix);
+    if((fmt_len < suffix_len) || ((fmt_len - suffix_len) >= sizeof(frag->seq)))
+        return;
+
+    size_t prefix_len = fmt_len - suffix_len;
+    if((strcmp(fmt + prefix_len, suffix) != 0) ||
+       (memchr(fmt, '%', prefix_len) != NULL))
+        return;
+
+    memcpy(frag->seq, fmt, prefix_len);
+    frag->len = (uint8_t)prefix_len;
+}
+
+static void nt__esc_cache_init(struct nt__esc_cache* cache,
+        char** esc_func_seqs)
+{
+    size_t i;
+    for(i = 0; i < NT_ESC_FUNC_OTHER; i++)
+    {
+        switch(i)
+        {
+            case NT_ESC_FUNC_CURSOR_MOVE:
+            case NT_ESC_FUNC_FG_SET_C8:
+            case NT_ESC_FUNC_FG_SET_C256:
+            case NT_ESC_FUNC_FG_SET_RGB:
+            case NT_ESC_FUNC_BG_SET_C8:
+            case NT_ESC_FUNC_BG_SET_C256:
+            case NT_ESC_FUNC_BG_SET_RGB:
+                cache->funcs[i].len = 0;
+                break;
+            default:
+                nt__esc_frag_init(&cache->funcs[i], esc_func_seqs[i]);
+        }
+    }
+
+    nt__esc_frag_init_rgb(&cache->fg_rgb,
+            esc_func_seqs[NT_ESC_FUNC_FG_SET_RGB]);
+    nt__esc_frag_init_rgb(&cache->bg_rgb,
+            esc_func_seqs[NT_ESC_FUNC_BG_SET_RGB]);
+
+    for(i = 0; i < 8; i++)
+    {
+        nt__esc_frag_init(&cache->fg_c8[i],
+                esc_func_seqs[NT_ESC_FUNC_FG_SET_C8], (int)i);
+        nt__esc_frag_init(&cache->bg_c8[i],
+                esc_func_seqs[NT_ESC_FUNC_BG_SET_C8], (int)i);
+    }
+
+    for(i = 0; i < 256; i++)
+    {
+        nt__esc_frag_init(&cache->fg_c256[i],
+                esc_func_seqs[NT_ESC_FUNC_FG_SET_C256], (int)i);
+        nt__esc_frag_init(&cache->bg_c256[i],
+                esc_func_seqs[NT_ESC_FUNC_BG_SET_C256], (int)i);
+    }
+}
 
+int nt__term_init(struct nt__term* term,
+        const char* env_term, const char* env_colorterm)
+{
     if(env_term == NULL)
     {
         return NT_ERR_INIT_TERM_ENV;
@@ -339,7 +418,7 @@ int nt__term_init(void)
             size_t match_len = strlen(terms[i].name);
             if(match_len > best_match_len)
             {
-                nt__term = terms[i];
+                term->info = terms[i];
                 best_match_len = match_len;
                 found = true;
             }
@@ -348,34 +427,27 @@ int nt__term_init(void)
 
     if(!found)
     {
-        nt__term = terms[0]; // Assume emulator is compatible with xterm
+        term->info = terms[0]; // Assume emulator is compatible with xterm
     }
 
+    nt__esc_cache_init(&term->esc_cache, term->info.esc_func_seqs);
+
     if((env_colorterm != NULL) && (strstr(env_colorterm, "truecolor")))
-        nt__color = NT_TERM_COLOR_TC;
+        term->colors = NT_TERM_COLOR_TC;
     else
     {
         if(strstr(env_term, "256"))
-            nt__color = NT_TERM_COLOR_C256;
+            term->colors = NT_TERM_COLOR_C256;
         else
-            nt__color = NT_TERM_COLOR_C8;
+            term->colors = NT_TERM_COLOR_C8;
     }
 
     return found ? 0 : NT_ERR_TERM_NOT_SUPP;
 }
 
-struct nt_term_info nt__term_get_used(void)
-{
-    return nt__term;
-}
-
-nt_term_color_count nt__term_get_color_count(void)
-{
-    return nt__color;
-}
-
-void nt__term_deinit(void)
+void nt__term_deinit(struct nt__term* term)
 {
-    nt__color = NT_TERM_COLOR_OTHER;
-    nt__term = (struct nt_term_info) {0};
+    term->colors = NT_TERM_COLOR_OTHER;
+    term->info = (struct nt_term_info) {0};
+    memset(&term->esc_cache, 0, sizeof(term->esc_cache));
 }
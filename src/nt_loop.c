@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include "nt.h"
+#include "nt_internal.h"
+
+static inline uint8_t nt__type_idx(uint32_t type)
+{
+    uint8_t i;
+    for(i = 0; i < 32; i++)
+    {
+        if(type & (((uint32_t)1) << i))
+            break;
+    }
+
+    return i;
+}
+
+static bool nt__loop_has_idle(const struct nt_loop* loop)
+{
+    size_t i;
+    for(i = 0; i < NT_LOOP_IDLE_MAX; i++)
+    {
+        if(loop->idle[i] != NULL)
+            return true;
+    }
+
+    return false;
+}
+
+static void nt__loop_handle(const struct nt_loop* loop, struct nt_event* event)
+{
+    nt_loop_handler handler = loop->handlers[nt__type_idx(event->type)];
+
+    if(handler != NULL)
+        handler(event, loop->data);
+    else
+        nt_event_payload_release(nt_event_get_payload(event));
+}
+
+int nt_loop_set_handler(
+        struct nt_loop* loop,
+        uint32_t type,
+        nt_loop_handler handler)
+{
+    if(loop == NULL)
+        return NT_ERR_INVALID_ARG;
+    if((type == NT_EVENT_INVALID) || ((type & (type - 1)) != 0))
+        return NT_ERR_INVALID_ARG;
+
+    loop->handlers[nt__type_idx(type)] = handler;
+
+    return 0;
+}
+
+int nt_ctx_loop_run(struct nt_ctx* ctx, const struct nt_loop* loop)
+{
+    if(loop == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    unsigned int timeout = nt__loop_has_idle(loop) ?
+        loop->idle_timeout : NT_EVENT_WAIT_FOREVER;
+
+    struct nt_event event;
+    int status;
+    size_t i;
+
+    bool* loop_stop = nt__ctx_loop_stop(ctx);
+
+    *loop_stop = false;
+    while(!*loop_stop)
+    {
+        status = nt_ctx_event_wait(ctx, &event, timeout, NULL);
+        if(status != 0)
+            return status;
+
+        if(event.type == NT_EVENT_TIMEOUT)
+        {
+            for(i = 0; (i < NT_LOOP_IDLE_MAX) && !*loop_stop; i++)
+            {
+                if(loop->idle[i] != NULL)
+                    loop->idle[i](loop->data);
+            }
+        }
+        else
+        {
+            nt__loop_handle(loop, &event);
+
+            /* Drain what is already pending so the frame covers all of it. */
+            while(!*loop_stop)
+            {
+                status = nt_ctx_event_wait(ctx, &event, 0, NULL);
+                if(status != 0)
+                    return status;
+
+                if(event.type == NT_EVENT_TIMEOUT)
+                    break;
+
+                nt__loop_handle(loop, &event);
+            }
+        }
+
+        if(!*loop_stop && (loop->frame != NULL))
+            loop->frame(loop->data);
+    }
+
+    return 0;
+}
+
+void nt_ctx_loop_stop(struct nt_ctx* ctx)
+{
+    *nt__ctx_loop_stop(ctx) = true;
+}
+
+int nt_loop_run(const struct nt_loop* loop)
+{
+    return nt_ctx_loop_run(NULL, loop);
+}
+
+void nt_loop_stop(void)
+{
+    nt_ctx_loop_stop(NULL);
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nt_event.h"
+#include "nt_internal.h"
+
+/* Size classes are powers of two in range [2^MIN_SHIFT, 2^MAX_SHIFT].
+ * Bigger payloads bypass the pool and go straight to malloc(). */
+#define NT__PAYLOAD_MIN_SHIFT 7 // 128B
+#define NT__PAYLOAD_MAX_SHIFT 16 // 64KiB
+#define NT__PAYLOAD_CLASS_COUNT \
+    (NT__PAYLOAD_MAX_SHIFT - NT__PAYLOAD_MIN_SHIFT + 1)
+#define NT__PAYLOAD_CLASS_NONE UINT8_MAX
+
+/* Upper bound of free blocks retained per class. */
+#define NT__PAYLOAD_CLASS_MAX_FREE 32
+
+union nt__payload_hdr
+{
+    struct
+    {
+        union nt__payload_hdr* next; // free-list link
+        size_t size; // size requested by nt_event_payload_alloc()
+        uint8_t class_idx;
+    } s;
+    nt__max_align_t _align;
+};
+
+struct nt__payload_class
+{
+    pthread_mutex_t lock;
+    union nt__payload_hdr* free_list;
+    size_t free_count;
+};
+
+#define NT__PAYLOAD_CLASS_INIT { PTHREAD_MUTEX_INITIALIZER, NULL, 0 }
+
+static struct nt__payload_class classes[NT__PAYLOAD_CLASS_COUNT] = {
+    NT__PAYLOAD_CLASS_INIT, NT__PAYLOAD_CLASS_INIT, NT__PAYLOAD_CLASS_INIT,
+    NT__PAYLOAD_CLASS_INIT, NT__PAYLOAD_CLASS_INIT, NT__PAYLOAD_CLASS_INIT,
+    NT__PAYLOAD_CLASS_INIT, NT__PAYLOAD_CLASS_INIT, NT__PAYLOAD_CLASS_INIT,
+    NT__PAYLOAD_CLASS_INIT
+};
+
+static uint8_t nt__payload_class_of(size_t size)
+{
+    size_t i;
+    for(i = 0; i < NT__PAYLOAD_CLASS_COUNT; i++)
+    {
+        if(size <= ((size_t)1 << (NT__PAYLOAD_MIN_SHIFT + i)))
+            return (uint8_t)i;
+    }
+
+    return NT__PAYLOAD_CLASS_NONE;
+}
+
+static inline union nt__payload_hdr* nt__payload_hdr_of(const void* payload)
+{
+    return ((union nt__payload_hdr*)payload) - 1;
+}
+
+void* nt_event_payload_alloc(size_t size)
+{
+    if((size == 0) || (size > (SIZE_MAX - sizeof(union nt__payload_hdr))))
+        return NULL;
+
+    uint8_t class_idx = nt__payload_class_of(size);
+    union nt__payload_hdr* hdr = NULL;
+
+    if(class_idx != NT__PAYLOAD_CLASS_NONE)
+    {
+        struct nt__payload_class* class = &classes[class_idx];
+
+        pthread_mutex_lock(&class->lock);
+        hdr = class->free_list;
+        if(hdr != NULL)
+        {
+            class->free_list = hdr->s.next;
+            class->free_count--;
+        }
+        pthread_mutex_unlock(&class->lock);
+
+        if(hdr == NULL)
+        {
+            size_t class_size = (size_t)1 << (NT__PAYLOAD_MIN_SHIFT + class_idx);
+            hdr = malloc(sizeof(union nt__payload_hdr) + class_size);
+        }
+    }
+    else
+    {
+        hdr = malloc(sizeof(union nt__payload_hdr) + size);
+    }
+
+    if(hdr == NULL)
+        return NULL;
+
+    hdr->s.next = NULL;
+    hdr->s.size = size;
+    hdr->s.class_idx = class_idx;
+
+    return hdr + 1;
+}
+
+void nt_event_payload_release(void* payload)
+{
+    if(payload == NULL)
+        return;
+
+    union nt__payload_hdr* hdr = nt__payload_hdr_of(payload);
+
+    if(hdr->s.class_idx == NT__PAYLOAD_CLASS_NONE)
+    {
+        free(hdr);
+        return;
+    }
+
+    struct nt__payload_class* class = &classes[hdr->s.class_idx];
+
+    pthread_mutex_lock(&class->lock);
+    if(class->free_count < NT__PAYLOAD_CLASS_MAX_FREE)
+    {
+        hdr->s.next = class->free_list;
+        class->free_list = hdr;
+        class->free_count++;
+        hdr = NULL;
+    }
+    pthread_mutex_unlock(&class->lock);
+
+    free(hdr);
+}
+
+size_t nt_event_payload_size(const void* payload)
+{
+    return (payload != NULL) ? nt__payload_hdr_of(payload)->s.size : 0;
+}
+
+void nt__payload_pool_trim(void)
+{
+    size_t i;
+    union nt__payload_hdr *it, *next;
+    for(i = 0; i < NT__PAYLOAD_CLASS_COUNT; i++)
+    {
+        pthread_mutex_lock(&classes[i].lock);
+        it = classes[i].free_list;
+        classes[i].free_list = NULL;
+        classes[i].free_count = 0;
+        pthread_mutex_unlock(&classes[i].lock);
+
+        while(it != NULL)
+        {
+            next = it->s.next;
+            free(it);
+            it = next;
+        }
+    }
+}
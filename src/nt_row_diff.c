@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <string.h>
+
+#include "nt_grid.h"
+#include "nt_internal.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define NT__HAVE_X86_SIMD
+#endif
+
+typedef bool (*nt__row_diff_fn)(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2,
+        size_t len,
+        size_t* out_first,
+        size_t* out_last);
+
+/* Resolved on first use, see nt__row_diff_select(). */
+static nt__row_diff_fn row_diff_fn;
+
+/* -------------------------------------------------------------------------- */
+/* SCALAR */
+/* -------------------------------------------------------------------------- */
+
+static inline bool nt__cell_eql(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2,
+        size_t i)
+{
+    return ((cps1[i] == cps2[i]) && (attrs1[i] == attrs2[i]));
+}
+
+static bool nt__row_diff_scalar(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2,
+        size_t len,
+        size_t* out_first,
+        size_t* out_last)
+{
+    size_t first, last;
+
+    for(first = 0; first < len; first++)
+    {
+        if(!nt__cell_eql(cps1, attrs1, cps2, attrs2, first))
+            break;
+    }
+
+    if(first == len)
+        return false;
+
+    for(last = len - 1; last > first; last--)
+    {
+        if(!nt__cell_eql(cps1, attrs1, cps2, attrs2, last))
+            break;
+    }
+
+    *out_first = first;
+    *out_last = last;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* SSE2/AVX2 */
+/* -------------------------------------------------------------------------- */
+
+#ifdef NT__HAVE_X86_SIMD
+
+/* Both return a mask with bit i set if cell i of the block is equal. */
+
+__attribute__((target("sse2")))
+static inline unsigned int nt__eq_mask_sse2(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2)
+{
+    __m128i cps = _mm_cmpeq_epi32(
+            _mm_loadu_si128((const __m128i*)cps1),
+            _mm_loadu_si128((const __m128i*)cps2));
+    __m128i attrs = _mm_cmpeq_epi32(
+            _mm_loadu_si128((const __m128i*)attrs1),
+            _mm_loadu_si128((const __m128i*)attrs2));
+
+    return (unsigned int)_mm_movemask_ps(
+            _mm_castsi128_ps(_mm_and_si128(cps, attrs)));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned int nt__eq_mask_avx2(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2)
+{
+    __m256i cps = _mm256_cmpeq_epi32(
+            _mm256_loadu_si256((const __m256i*)cps1),
+            _mm256_loadu_si256((const __m256i*)cps2));
+    __m256i attrs = _mm256_cmpeq_epi32(
+            _mm256_loadu_si256((const __m256i*)attrs1),
+            _mm256_loadu_si256((const __m256i*)attrs2));
+
+    return (unsigned int)_mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_and_si256(cps, attrs)));
+}
+
+/* Scans blocks of `lanes` cells from both ends. `len` is a multiple of
+ * `lanes`, so the backward scan stops at the latest in the block holding the
+ * first difference. */
+#define NT__ROW_DIFF_DEFINE(name, isa, eq_mask, lanes)                         \
+    __attribute__((target(isa)))                                               \
+    static bool name(                                                          \
+            const uint32_t* cps1,                                              \
+            const uint32_t* attrs1,                                            \
+            const uint32_t* cps2,                                              \
+            const uint32_t* attrs2,                                            \
+            size_t len,                                                        \
+            size_t* out_first,                                                 \
+            size_t* out_last)                                                  \
+    {                                                                          \
+        const unsigned int all = (1u << (lanes)) - 1;                          \
+        unsigned int mask = all;                                               \
+        size_t i;                                                              \
+                                                                               \
+        for(i = 0; i < len; i += (lanes))                                      \
+        {                                                                      \
+            mask = eq_mask(cps1 + i, attrs1 + i, cps2 + i, attrs2 + i);        \
+            if(mask != all)                                                    \
+                break;                                                         \
+        }                                                                      \
+                                                                               \
+        if(i >= len)                                                           \
+            return false;                                                      \
+                                                                               \
+        *out_first = i + __builtin_ctz(~mask & all);                           \
+                                                                               \
+        i = len;                                                               \
+        do                                                                     \
+        {                                                                      \
+            i -= (lanes);                                                      \
+            mask = eq_mask(cps1 + i, attrs1 + i, cps2 + i, attrs2 + i);        \
+        } while(mask == all);                                                  \
+                                                                               \
+        *out_last = i + (31 - __builtin_clz(~mask & all));                     \
+                                                                               \
+        return true;                                                           \
+    }
+
+NT__ROW_DIFF_DEFINE(nt__row_diff_sse2, "sse2", nt__eq_mask_sse2, 4)
+NT__ROW_DIFF_DEFINE(nt__row_diff_avx2, "avx2", nt__eq_mask_avx2, 8)
+
+#endif // NT__HAVE_X86_SIMD
+
+/* -------------------------------------------------------------------------- */
+
+static nt__row_diff_fn nt__row_diff_select(void)
+{
+#ifdef NT__HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return nt__row_diff_avx2;
+    if(__builtin_cpu_supports("sse2"))
+        return nt__row_diff_sse2;
+#endif
+
+    return nt__row_diff_scalar;
+}
+
+bool nt__row_diff(
+        const uint32_t* cps1,
+        const uint32_t* attrs1,
+        const uint32_t* cps2,
+        const uint32_t* attrs2,
+        size_t len,
+        size_t* out_first,
+        size_t* out_last)
+{
+    /* Racing threads resolve the same function, so relaxed order is enough. */
+    nt__row_diff_fn fn = __atomic_load_n(&row_diff_fn, __ATOMIC_RELAXED);
+    if(fn == NULL)
+    {
+        fn = nt__row_diff_select();
+        __atomic_store_n(&row_diff_fn, fn, __ATOMIC_RELAXED);
+    }
+
+    return fn(cps1, attrs1, cps2, attrs2, len, out_first, out_last);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static inline uint64_t nt__load_u64(const uint32_t* words)
+{
+    uint64_t val;
+    memcpy(&val, words, sizeof(val));
+    return val;
+}
+
+uint64_t nt__row_hash(const uint32_t* cps, const uint32_t* attrs, size_t len)
+{
+    const uint64_t k = 0x9E3779B97F4A7C15ULL;
+
+    /* Four independent lanes hide the multiply latency. */
+    uint64_t h[4] = { k, k << 1, k << 2, k << 3 };
+    size_t i;
+    for(i = 0; i < len; i += 8)
+    {
+        h[0] = (h[0] ^ nt__load_u64(cps + i)) * k;
+        h[1] = (h[1] ^ nt__load_u64(cps + i + 2)) * k;
+        h[2] = (h[2] ^ nt__load_u64(cps + i + 4)) * k;
+        h[3] = (h[3] ^ nt__load_u64(cps + i + 6)) * k;
+        h[0] = (h[0] ^ nt__load_u64(attrs + i)) * k;
+        h[1] = (h[1] ^ nt__load_u64(attrs + i + 2)) * k;
+        h[2] = (h[2] ^ nt__load_u64(attrs + i + 4)) * k;
+        h[3] = (h[3] ^ nt__load_u64(attrs + i + 6)) * k;
+    }
+
+    uint64_t hash = h[0];
+    hash = (hash ^ h[1]) * k;
+    hash = (hash ^ h[2]) * k;
+    hash = (hash ^ h[3]) * k;
+
+    return hash ^ (hash >> 29);
+}
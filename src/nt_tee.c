@@ -0,0 +1,521 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nt.h"
+#include "nt_internal.h"
+
+#define NT__TEE_RING_CAP_DEFAULT (1 << 20)
+#define NT__TEE_POLL_NS 5000000L
+#define NT__TEE_LINE_MAX 64
+
+/* Output is handed to the writer thread through a single-producer,
+ * single-consumer ring. The output path only copies a struct
+ * nt_output_record and the bytes into the ring and publishes `head`. Output
+ * that doesn't fit is dropped and counted in `dropped`, so the output path
+ * never waits for the file. The writer polls the ring, formats what it finds
+ * and writes it out with one call per batch. The output path only takes
+ * `lock`, to wake the writer early, once the ring is half full. */
+struct nt__tee
+{
+    char* ring;
+    size_t mask; // ring capacity - 1, the capacity is a power of 2
+    size_t head; // written by the output path
+    size_t tail; // written by the writer
+    uint32_t dropped; // bytes dropped since the last record was taken
+    bool stop;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool waiting; // the writer is waiting on `cond`
+
+    int fd;
+    enum nt_output_record_fmt fmt;
+    unsigned long long start_us;
+    pthread_t writer;
+
+    /* Writer state. `data` holds the bytes of the record being formatted.
+     * `carry` holds the start of a UTF-8 sequence split between two records,
+     * which asciicast can't store, and is put in front of the next record. */
+    struct nt__chunk out;
+    struct nt__chunk data;
+    char carry[4];
+    size_t carry_len;
+    bool failed;
+};
+
+/* -------------------------------------------------------------------------- */
+
+static void nt__tee_ring_put(struct nt__tee* tee, size_t pos,
+        const void* data, size_t len)
+{
+    size_t offset = pos & tee->mask;
+    size_t first = tee->mask + 1 - offset;
+    if(first > len)
+        first = len;
+
+    memcpy(tee->ring + offset, data, first);
+    memcpy(tee->ring, (const char*)data + first, len - first);
+}
+
+static void nt__tee_ring_take(const struct nt__tee* tee, size_t pos,
+        void* data, size_t len)
+{
+    size_t offset = pos & tee->mask;
+    size_t first = tee->mask + 1 - offset;
+    if(first > len)
+        first = len;
+
+    memcpy(data, tee->ring + offset, first);
+    memcpy((char*)data + first, tee->ring, len - first);
+}
+
+void nt__tee_feed(struct nt__tee* tee, unsigned long long now_us,
+        const void* data, size_t len)
+{
+    if(len == 0)
+        return;
+
+    size_t head = tee->head;
+    size_t tail = __atomic_load_n(&tee->tail, __ATOMIC_ACQUIRE);
+    size_t need = sizeof(struct nt_output_record) + len;
+
+    if((len > UINT32_MAX) || (need > ((tee->mask + 1) - (head - tail))))
+    {
+        __atomic_fetch_add(&tee->dropped,
+                (len > UINT32_MAX) ? UINT32_MAX : (uint32_t)len,
+                __ATOMIC_RELAXED);
+        return;
+    }
+
+    struct nt_output_record record = {
+        .time_us = (now_us > tee->start_us) ? (now_us - tee->start_us) : 0,
+        .len = (uint32_t)len
+    };
+
+    nt__tee_ring_put(tee, head, &record, sizeof(record));
+    nt__tee_ring_put(tee, head + sizeof(record), data, len);
+
+    /* Pairs with the writer setting `waiting` before it checks `head`. */
+    __atomic_store_n(&tee->head, head + need, __ATOMIC_SEQ_CST);
+
+    if(((head + need - tail) > ((tee->mask + 1) / 2)) &&
+       __atomic_load_n(&tee->waiting, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&tee->lock);
+        pthread_cond_signal(&tee->cond);
+        pthread_mutex_unlock(&tee->lock);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* WRITER */
+/* -------------------------------------------------------------------------- */
+
+static int nt__tee_reserve(struct nt__chunk* chunk, size_t len)
+{
+    if((chunk->len + len) <= chunk->cap)
+        return 0;
+
+    size_t new_cap = (chunk->cap > 0) ? chunk->cap : 4096;
+    while(new_cap < (chunk->len + len))
+        new_cap *= 2;
+
+    char* new_data = realloc(chunk->data, new_cap);
+    if(new_data == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    chunk->data = new_data;
+    chunk->cap = new_cap;
+
+    return 0;
+}
+
+/* Returns the length of the UTF-8 sequence starting with `byte`, or 0 if it
+ * can't start one. */
+static size_t nt__tee_utf8_len(unsigned char byte)
+{
+    if(byte < 0x80) return 1;
+    if((byte & 0xE0) == 0xC0) return (byte >= 0xC2) ? 2 : 0;
+    if((byte & 0xF0) == 0xE0) return 3;
+    if((byte & 0xF8) == 0xF0) return (byte <= 0xF4) ? 4 : 0;
+
+    return 0;
+}
+
+/* Appends `data` to `out` as the contents of a JSON string. Invalid UTF-8 is
+ * replaced with U+FFFD. An incomplete sequence at the end is kept in
+ * `tee->carry` and completed by the next record. */
+static void nt__tee_json_append(struct nt__tee* tee, struct nt__chunk* out,
+        const char* data, size_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    const unsigned char* it = (const unsigned char*)data;
+    const unsigned char* end = it + len;
+    char* dst = out->data + out->len;
+    size_t seq_len, i;
+
+    while(it < end)
+    {
+        if((*it < 0x20) || (*it == 0x7F))
+        {
+            memcpy(dst, "\\u00", 4);
+            dst[4] = hex[*it >> 4];
+            dst[5] = hex[*it & 0xF];
+            dst += 6;
+            it++;
+            continue;
+        }
+        if((*it == '"') || (*it == '\\'))
+        {
+            *dst++ = '\\';
+            *dst++ = (char)*it++;
+            continue;
+        }
+        if(*it < 0x80)
+        {
+            *dst++ = (char)*it++;
+            continue;
+        }
+
+        seq_len = nt__tee_utf8_len(*it);
+        for(i = 1; (i < seq_len) && ((it + i) < end); i++)
+        {
+            if((it[i] & 0xC0) != 0x80)
+                break;
+        }
+
+        if((seq_len > 0) && (i == seq_len))
+        {
+            memcpy(dst, it, seq_len);
+            dst += seq_len;
+            it += seq_len;
+        }
+        else if((seq_len > 0) && ((it + i) == end))
+        {
+            memcpy(tee->carry, it, i);
+            tee->carry_len = i;
+            it = end;
+        }
+        else
+        {
+            memcpy(dst, "\\ufffd", 6);
+            dst += 6;
+            it += (i > 0) ? i : 1;
+        }
+    }
+
+    out->len = (size_t)(dst - out->data);
+}
+
+/* Appends the record with the bytes in `tee->data` to the output. */
+static int nt__tee_format(struct nt__tee* tee,
+        struct nt_output_record record, uint32_t dropped)
+{
+    struct nt__chunk* out = &tee->out;
+    struct nt__chunk* data = &tee->data;
+
+    if(tee->fmt == NT_OUTPUT_RECORD_BINARY)
+    {
+        record.dropped = dropped;
+
+        if(nt__tee_reserve(out, sizeof(record) + data->len) != 0)
+            return NT_ERR_ALLOC_FAIL;
+
+        memcpy(out->data + out->len, &record, sizeof(record));
+        memcpy(out->data + out->len + sizeof(record), data->data, data->len);
+        out->len += sizeof(record) + data->len;
+
+        return 0;
+    }
+
+    /* A byte takes at most 6 bytes escaped, the rest of the lines less than
+     * NT__TEE_LINE_MAX each. */
+    if(nt__tee_reserve(out, (2 * NT__TEE_LINE_MAX) + (data->len * 6)) != 0)
+        return NT_ERR_ALLOC_FAIL;
+
+    double time_s = (double)record.time_us / 1000000.0;
+
+    if(dropped > 0)
+    {
+        out->len += (size_t)snprintf(out->data + out->len, NT__TEE_LINE_MAX,
+                "[%.6f, \"m\", \"dropped %u bytes\"]\n",
+                time_s, (unsigned int)dropped);
+    }
+
+    size_t line_start = out->len;
+    out->len += (size_t)snprintf(out->data + out->len, NT__TEE_LINE_MAX,
+            "[%.6f, \"o\", \"", time_s);
+    size_t text_start = out->len;
+
+    nt__tee_json_append(tee, out, data->data, data->len);
+
+    /* All bytes went to `carry`. */
+    if(out->len == text_start)
+    {
+        out->len = line_start;
+        return 0;
+    }
+
+    memcpy(out->data + out->len, "\"]\n", 3);
+    out->len += 3;
+
+    return 0;
+}
+
+static void nt__tee_write(struct nt__tee* tee)
+{
+    const char* it = tee->out.data;
+    size_t size = tee->out.len;
+
+    tee->out.len = 0;
+
+    while((size > 0) && !tee->failed)
+    {
+        ssize_t written = write(tee->fd, it, size);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            tee->failed = true;
+        }
+        else if(written == 0)
+            tee->failed = true;
+        else
+        {
+            it += written;
+            size -= (size_t)written;
+        }
+    }
+}
+
+/* Formats the records between the tail and `head` and writes them out.
+ * Records are taken even after writing failed, so the ring keeps moving. */
+static void nt__tee_drain(struct nt__tee* tee, size_t head)
+{
+    struct nt_output_record record;
+    size_t tail = tee->tail;
+    uint32_t dropped;
+
+    while(tail != head)
+    {
+        nt__tee_ring_take(tee, tail, &record, sizeof(record));
+
+        tee->data.len = 0;
+        if(nt__tee_reserve(&tee->data, tee->carry_len + record.len) != 0)
+            tee->failed = true;
+
+        if(!tee->failed)
+        {
+            memcpy(tee->data.data, tee->carry, tee->carry_len);
+            nt__tee_ring_take(tee, tail + sizeof(record),
+                    tee->data.data + tee->carry_len, record.len);
+            tee->data.len = tee->carry_len + record.len;
+            tee->carry_len = 0;
+
+            dropped = __atomic_exchange_n(&tee->dropped, 0, __ATOMIC_RELAXED);
+            if(nt__tee_format(tee, record, dropped) != 0)
+                tee->failed = true;
+        }
+
+        tail += sizeof(record) + record.len;
+        __atomic_store_n(&tee->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    nt__tee_write(tee);
+}
+
+/* Waits up to NT__TEE_POLL_NS for the output path to fill the ring. */
+static void nt__tee_wait(struct nt__tee* tee)
+{
+    struct timespec until;
+    clock_gettime(CLOCK_MONOTONIC, &until);
+    until.tv_nsec += NT__TEE_POLL_NS;
+    if(until.tv_nsec >= 1000000000L)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&tee->lock);
+    __atomic_store_n(&tee->waiting, true, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&tee->head, __ATOMIC_SEQ_CST) == tee->tail)
+        pthread_cond_timedwait(&tee->cond, &tee->lock, &until);
+    __atomic_store_n(&tee->waiting, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&tee->lock);
+}
+
+static void* nt__tee_writer_fn(void* data)
+{
+    struct nt__tee* tee = data;
+    size_t head;
+    bool stop;
+
+    /* Signals are left to the threads of the application. */
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    while(true)
+    {
+        stop = __atomic_load_n(&tee->stop, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&tee->head, __ATOMIC_ACQUIRE);
+
+        if(head != tee->tail)
+            nt__tee_drain(tee, head);
+        else if(stop)
+            break;
+        else
+            nt__tee_wait(tee);
+    }
+
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void nt__tee_destroy(struct nt__tee* tee)
+{
+    if(tee == NULL)
+        return;
+
+    __atomic_store_n(&tee->stop, true, __ATOMIC_RELEASE);
+    pthread_join(tee->writer, NULL);
+
+    pthread_cond_destroy(&tee->cond);
+    pthread_mutex_destroy(&tee->lock);
+    free(tee->ring);
+    free(tee->out.data);
+    free(tee->data.data);
+    free(tee);
+}
+
+static int nt__tee_header_write(struct nt_ctx* ctx, struct nt__tee* tee)
+{
+    if(tee->fmt == NT_OUTPUT_RECORD_BINARY)
+    {
+        if(nt__tee_reserve(&tee->out, NT_OUTPUT_RECORD_MAGIC_LEN) != 0)
+            return NT_ERR_ALLOC_FAIL;
+
+        memcpy(tee->out.data, NT_OUTPUT_RECORD_MAGIC,
+                NT_OUTPUT_RECORD_MAGIC_LEN);
+        tee->out.len = NT_OUTPUT_RECORD_MAGIC_LEN;
+    }
+    else
+    {
+        size_t width, height;
+        nt_ctx_get_term_size(ctx, &width, &height);
+        if((width == 0) || (height == 0))
+        {
+            width = 80;
+            height = 24;
+        }
+
+        if(nt__tee_reserve(&tee->out, 128) != 0)
+            return NT_ERR_ALLOC_FAIL;
+
+        tee->out.len = (size_t)snprintf(tee->out.data, 128,
+                "{\"version\": 2, \"width\": %zu, \"height\": %zu, "
+                "\"timestamp\": %lld}\n",
+                width, height, (long long)time(NULL));
+    }
+
+    nt__tee_write(tee);
+
+    return tee->failed ? NT_ERR_UNEXPECTED : 0;
+}
+
+int nt_ctx_output_record_start(struct nt_ctx* ctx, int fd,
+        enum nt_output_record_fmt fmt, size_t ring_cap)
+{
+    if((fd < 0) || ((fmt != NT_OUTPUT_RECORD_ASCIICAST) &&
+                (fmt != NT_OUTPUT_RECORD_BINARY)))
+        return NT_ERR_INVALID_ARG;
+
+    nt_ctx_output_record_stop(ctx);
+
+    size_t cap = NT__TEE_RING_CAP_DEFAULT;
+    if(ring_cap > 0)
+    {
+        for(cap = 1024; cap < ring_cap; cap *= 2)
+        {
+            if(cap > (SIZE_MAX / 2))
+                return NT_ERR_INVALID_ARG;
+        }
+    }
+
+    struct nt__tee* tee = calloc(1, sizeof(struct nt__tee));
+    if(tee == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    tee->ring = malloc(cap);
+    if(tee->ring == NULL)
+    {
+        free(tee);
+        return NT_ERR_ALLOC_FAIL;
+    }
+    tee->mask = cap - 1;
+    tee->fd = fd;
+    tee->fmt = fmt;
+    tee->start_us = nt__ctx_clock_us(ctx);
+
+    /* The writer waits on the monotonic clock, see nt__tee_wait(). */
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&tee->lock, NULL);
+    pthread_cond_init(&tee->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    int status = nt__tee_header_write(ctx, tee);
+    if(status == 0)
+    {
+        if(pthread_create(&tee->writer, NULL, nt__tee_writer_fn, tee) != 0)
+            status = NT_ERR_UNEXPECTED;
+    }
+    if(status != 0)
+    {
+        pthread_cond_destroy(&tee->cond);
+        pthread_mutex_destroy(&tee->lock);
+        free(tee->ring);
+        free(tee->out.data);
+        free(tee);
+        return status;
+    }
+
+    *nt__ctx_tee(ctx) = tee;
+
+    return 0;
+}
+
+void nt_ctx_output_record_stop(struct nt_ctx* ctx)
+{
+    struct nt__tee** slot = nt__ctx_tee(ctx);
+
+    nt__tee_destroy(*slot);
+    *slot = NULL;
+}
+
+/* ------------------------------------------------------ */
+
+int nt_output_record_start(int fd, enum nt_output_record_fmt fmt,
+        size_t ring_cap)
+{
+    return nt_ctx_output_record_start(NULL, fd, fmt, ring_cap);
+}
+
+void nt_output_record_stop(void)
+{
+    nt_ctx_output_record_stop(NULL);
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nt.h"
+#include "nt_internal.h"
+
+#ifdef NT_TRACE
+
+#define NT__TRACE_RING_MASK (NT_TRACE_RING_CAP - 1)
+#define NT__TRACE_LINE_MAX 160
+
+struct nt__trace_entry
+{
+    const char* name;
+    uint64_t start_ns;
+    uint64_t dur_ns;
+};
+
+/* Written only by its thread. `begin` is advanced before an entry is
+ * overwritten and `end` after, so a reader can tell which of the entries it
+ * copied were overwritten while it copied them.
+ *
+ * When its thread exits, a ring goes on the free list, and its spans can
+ * still be dumped until a new thread takes it over. The new thread records
+ * from `start` on, so rings are never freed, but there are only as many as
+ * threads have traced at once. */
+struct nt__trace_ring
+{
+    struct nt__trace_ring* next;
+    struct nt__trace_ring* free_next; // guarded by `trace_lock`
+    uint32_t tid; // guarded by `trace_lock`
+    uint64_t start; // guarded by `trace_lock`
+    uint64_t begin;
+    uint64_t end;
+    struct nt__trace_entry entries[NT_TRACE_RING_CAP];
+};
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct nt__trace_ring* trace_rings; // guarded by `trace_lock`
+static struct nt__trace_ring* trace_free; // guarded by `trace_lock`
+static uint32_t trace_tid_next = 1; // guarded by `trace_lock`
+static uint64_t trace_clear_ns; // spans starting earlier are not dumped
+
+/* Its destructor hands the ring of an exiting thread to `trace_free`. */
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static bool trace_key_created;
+
+static __thread struct nt__trace_ring* trace_ring;
+
+/* -------------------------------------------------------------------------- */
+
+uint64_t nt__trace_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+static void nt__trace_ring_release(void* data)
+{
+    struct nt__trace_ring* ring = data;
+
+    pthread_mutex_lock(&trace_lock);
+    ring->free_next = trace_free;
+    trace_free = ring;
+    pthread_mutex_unlock(&trace_lock);
+
+    trace_ring = NULL;
+}
+
+static void nt__trace_key_create(void)
+{
+    trace_key_created = (pthread_key_create(&trace_key,
+                nt__trace_ring_release) == 0);
+}
+
+/* Takes a ring released by an exited thread, or allocates one. */
+static struct nt__trace_ring* nt__trace_ring_get(void)
+{
+    pthread_once(&trace_key_once, nt__trace_key_create);
+
+    pthread_mutex_lock(&trace_lock);
+    struct nt__trace_ring* ring = trace_free;
+    if(ring != NULL)
+    {
+        trace_free = ring->free_next;
+        ring->start = ring->end;
+    }
+    else
+    {
+        ring = calloc(1, sizeof(struct nt__trace_ring));
+        if(ring == NULL)
+        {
+            pthread_mutex_unlock(&trace_lock);
+            return NULL;
+        }
+
+        ring->next = trace_rings;
+        trace_rings = ring;
+    }
+    ring->tid = trace_tid_next++;
+    pthread_mutex_unlock(&trace_lock);
+
+    if(trace_key_created)
+        pthread_setspecific(trace_key, ring);
+    trace_ring = ring;
+
+    return ring;
+}
+
+void nt__trace_add(const char* name, uint64_t start_ns)
+{
+    uint64_t end_ns = nt__trace_now_ns();
+
+    struct nt__trace_ring* ring = trace_ring;
+    if((ring == NULL) && ((ring = nt__trace_ring_get()) == NULL))
+        return;
+
+    uint64_t pos = ring->end;
+    struct nt__trace_entry* entry = &ring->entries[pos & NT__TRACE_RING_MASK];
+
+    __atomic_store_n(&ring->begin, pos + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store_n(&entry->name, name, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->start_ns, start_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->dur_ns, end_ns - start_ns, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&ring->end, pos + 1, __ATOMIC_RELEASE);
+}
+
+/* ------------------------------------------------------ */
+
+/* Copies the entries of `ring` in [`start`, `end`) still valid after the
+ * copy into `copy`, which holds NT_TRACE_RING_CAP entries, and returns their
+ * count. */
+static size_t nt__trace_ring_copy(const struct nt__trace_ring* ring,
+        uint64_t start, uint64_t end, struct nt__trace_entry* copy)
+{
+    uint64_t first = (end > NT_TRACE_RING_CAP) ? (end - NT_TRACE_RING_CAP) : 0;
+    if(first < start)
+        first = start;
+    const struct nt__trace_entry* entry;
+    uint64_t pos;
+
+    for(pos = first; pos < end; pos++)
+    {
+        entry = &ring->entries[pos & NT__TRACE_RING_MASK];
+        copy[pos - first] = (struct nt__trace_entry) {
+            .name = __atomic_load_n(&entry->name, __ATOMIC_RELAXED),
+            .start_ns = __atomic_load_n(&entry->start_ns, __ATOMIC_RELAXED),
+            .dur_ns = __atomic_load_n(&entry->dur_ns, __ATOMIC_RELAXED)
+        };
+    }
+
+    /* Entries the thread started to overwrite meanwhile are dropped. */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t begin = __atomic_load_n(&ring->begin, __ATOMIC_RELAXED);
+    uint64_t valid = (begin > NT_TRACE_RING_CAP) ?
+        (begin - NT_TRACE_RING_CAP) : 0;
+    if(valid <= first)
+        return end - first;
+    if(valid >= end)
+        return 0;
+
+    memmove(copy, copy + (valid - first),
+            (end - valid) * sizeof(struct nt__trace_entry));
+
+    return end - valid;
+}
+
+int nt_trace_dump(nt_trace_fn fn, void* data)
+{
+    if(fn == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    struct nt__trace_entry* copy = malloc(
+            NT_TRACE_RING_CAP * sizeof(struct nt__trace_entry));
+    if(copy == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    pthread_mutex_lock(&trace_lock);
+    struct nt__trace_ring* rings = trace_rings;
+    pthread_mutex_unlock(&trace_lock);
+
+    uint64_t clear_ns = __atomic_load_n(&trace_clear_ns, __ATOMIC_RELAXED);
+    struct nt_trace_span span;
+    struct nt__trace_ring* ring;
+    uint64_t start, end;
+    uint32_t tid;
+    size_t count, i;
+
+    /* Rings are only prepended, so the list from `rings` on doesn't change.
+     * The spans in [`start`, `end`) were all recorded by thread `tid`, even
+     * if the ring is taken over by another thread meanwhile. */
+    for(ring = rings; ring != NULL; ring = ring->next)
+    {
+        pthread_mutex_lock(&trace_lock);
+        tid = ring->tid;
+        start = ring->start;
+        end = __atomic_load_n(&ring->end, __ATOMIC_ACQUIRE);
+        pthread_mutex_unlock(&trace_lock);
+
+        count = nt__trace_ring_copy(ring, start, end, copy);
+        for(i = 0; i < count; i++)
+        {
+            if(copy[i].start_ns < clear_ns)
+                continue;
+
+            span = (struct nt_trace_span) {
+                .name = copy[i].name,
+                .start_ns = copy[i].start_ns,
+                .dur_ns = copy[i].dur_ns,
+                .tid = tid
+            };
+            fn(&span, data);
+        }
+    }
+
+    free(copy);
+
+    return 0;
+}
+
+/* ------------------------------------------------------ */
+
+struct nt__trace_json
+{
+    struct nt__chunk out;
+    long pid;
+    bool first;
+    bool failed;
+};
+
+static void nt__trace_json_fn(const struct nt_trace_span* span, void* data)
+{
+    struct nt__trace_json* json = data;
+    char line[NT__TRACE_LINE_MAX];
+
+    /* Timestamps are in microseconds, kept to the nanosecond. */
+    int len = snprintf(line, sizeof(line),
+            "%s\n{\"name\":\"%s\",\"cat\":\"nuterm\",\"ph\":\"X\","
+            "\"pid\":%ld,\"tid\":%u,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+            json->first ? "" : ",", span->name, json->pid,
+            (unsigned int)span->tid,
+            (unsigned long long)(span->start_ns / 1000),
+            (unsigned int)(span->start_ns % 1000),
+            (unsigned long long)(span->dur_ns / 1000),
+            (unsigned int)(span->dur_ns % 1000));
+
+    json->first = false;
+    if((len < 0) || ((size_t)len >= sizeof(line)) ||
+       (nt__chunk_put(&json->out, line, (size_t)len) != 0))
+        json->failed = true;
+}
+
+int nt_trace_write_json(int fd)
+{
+    static const char head[] = "{\"traceEvents\":[";
+    static const char tail[] = "\n],\"displayTimeUnit\":\"ns\"}\n";
+
+    struct nt__trace_json json = {
+        .pid = (long)getpid(),
+        .first = true
+    };
+
+    int status = nt__chunk_put(&json.out, head, sizeof(head) - 1);
+    if(status == 0)
+        status = nt_trace_dump(nt__trace_json_fn, &json);
+    if((status == 0) && !json.failed)
+        status = nt__chunk_put(&json.out, tail, sizeof(tail) - 1);
+    if((status == 0) && json.failed)
+        status = NT_ERR_ALLOC_FAIL;
+
+    const char* it = json.out.data;
+    size_t rem = json.out.len;
+    ssize_t written;
+    while((status == 0) && (rem > 0))
+    {
+        written = write(fd, it, rem);
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            status = NT_ERR_UNEXPECTED;
+            break;
+        }
+
+        it += written;
+        rem -= (size_t)written;
+    }
+
+    free(json.out.data);
+
+    return status;
+}
+
+void nt_trace_clear(void)
+{
+    __atomic_store_n(&trace_clear_ns, nt__trace_now_ns(), __ATOMIC_RELAXED);
+}
+
+#else
+
+int nt_trace_dump(nt_trace_fn fn, void* data)
+{
+    (void)fn;
+    (void)data;
+
+    return NT_ERR_FUNC_NOT_SUPP;
+}
+
+int nt_trace_write_json(int fd)
+{
+    (void)fd;
+
+    return NT_ERR_FUNC_NOT_SUPP;
+}
+
+void nt_trace_clear(void)
+{
+}
+
+#endif // NT_TRACE
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "nt.h"
+#include "nt_internal.h"
+
+/* Pen a gfx is rendered to, valid while `check` matches the check count. */
+struct nt__verify_pen
+{
+    struct nt_vt_pen pen;
+    unsigned int check;
+};
+
+struct nt__verify
+{
+    nt_verify_fn fn;
+    void* data;
+
+    /* Shadow model, created with the size of the first frame. `synced` is set
+     * once a frame was drawn in full, so every cell of the model is known. */
+    struct nt_vt* vt;
+    bool synced;
+
+    /* Copy of a frame still in the output buffer, checked on flush. */
+    struct nt_grid* frame;
+    bool pending;
+
+    /* Expected pens are found by encoding a cell with each gfx and feeding it
+     * to `scratch`, so they go through the same emitter as the output. */
+    struct nt_vt* scratch;
+    struct nt__chunk scratch_chunk;
+    struct nt__verify_pen* pens;
+    size_t pen_cap;
+    unsigned int check;
+};
+
+/* -------------------------------------------------------------------------- */
+
+void nt__verify_destroy(struct nt__verify* verify)
+{
+    if(verify == NULL)
+        return;
+
+    nt_vt_destroy(verify->vt);
+    nt_vt_destroy(verify->scratch);
+    nt_grid_destroy(verify->frame);
+    free(verify->scratch_chunk.data);
+    free(verify->pens);
+    free(verify);
+}
+
+void nt__verify_feed(struct nt__verify* verify, const void* data, size_t len)
+{
+    if(verify->vt != NULL)
+        nt_vt_feed(verify->vt, data, len);
+}
+
+/* ------------------------------------------------------ */
+
+/* Stores the pen of a cell drawn with `id` in `out_pen`. Returns false if it
+ * could not be rendered. */
+static bool nt__verify_pen_get(struct nt_ctx* ctx, struct nt__verify* verify,
+        nt_gfx_id id, struct nt_vt_pen* out_pen)
+{
+    if(id >= verify->pen_cap)
+    {
+        size_t new_cap = (verify->pen_cap > 0) ? verify->pen_cap : 64;
+        while(new_cap <= id)
+            new_cap *= 2;
+
+        struct nt__verify_pen* new_pens = realloc(verify->pens,
+                new_cap * sizeof(struct nt__verify_pen));
+        if(new_pens == NULL)
+            return false;
+
+        /* Check 0 is never current. */
+        memset(new_pens + verify->pen_cap, 0,
+                (new_cap - verify->pen_cap) * sizeof(struct nt__verify_pen));
+        verify->pens = new_pens;
+        verify->pen_cap = new_cap;
+    }
+
+    struct nt__verify_pen* pen = &verify->pens[id];
+    if(pen->check != verify->check)
+    {
+        verify->scratch_chunk.len = 0;
+        if(nt__encode_str_id(ctx, &verify->scratch_chunk, " ", 1, id) != 0)
+            return false;
+
+        struct nt_vt_cell cell;
+        nt_vt_feed(verify->scratch, "\r", 1);
+        nt_vt_feed(verify->scratch, verify->scratch_chunk.data,
+                verify->scratch_chunk.len);
+        nt_vt_get_cell(verify->scratch, 0, 0, &cell);
+
+        pen->pen = cell.pen;
+        pen->check = verify->check;
+    }
+
+    *out_pen = pen->pen;
+
+    return true;
+}
+
+/* The model keeps at most NT_VT_TEXT_CAP bytes of a cluster, whole code
+ * points from its start. */
+static bool nt__verify_text_eql(const char* text, size_t len,
+        const struct nt_vt_cell* cell)
+{
+    if(len <= NT_VT_TEXT_CAP)
+        return ((cell->len == len) && (memcmp(cell->text, text, len) == 0));
+
+    return ((cell->len > 0) && (memcmp(cell->text, text, cell->len) == 0));
+}
+
+/* Compares `grid` with the model and reports the first differing cell. */
+static void nt__verify_check(struct nt_ctx* ctx, struct nt__verify* verify,
+        const struct nt_grid* grid)
+{
+    struct nt_verify_mismatch mismatch;
+    struct nt_cell cell;
+    struct nt_vt_cell actual;
+    struct nt_vt_pen pen;
+    char utf8[4];
+    const char* ext;
+    const char* text;
+    size_t len;
+    uint16_t flags;
+    bool eql;
+
+    size_t width, height, x, y;
+    nt_grid_get_size(grid, &width, &height);
+
+    if(++verify->check == 0)
+        verify->check = 1;
+
+    for(y = 0; y < height; y++)
+    {
+        for(x = 0; x < width; x++)
+        {
+            nt_grid_get(grid, x, y, &cell);
+            nt_vt_get_cell(verify->vt, x, y, &actual);
+
+            flags = cell.flags & (NT_CELL_WIDE | NT_CELL_CONT);
+            if(flags & NT_CELL_CONT)
+            {
+                if(actual.flags & NT_CELL_CONT)
+                    continue;
+
+                len = 0;
+                text = "";
+                eql = false;
+            }
+            else
+            {
+                len = nt__grid_get_utf8(grid, x, y, utf8, &ext);
+                text = (ext != NULL) ? ext : utf8;
+                eql = (flags == actual.flags) &&
+                    nt__verify_text_eql(text, len, &actual);
+            }
+
+            if(!nt__verify_pen_get(ctx, verify, cell.gfx, &pen))
+                pen = actual.pen;
+            if(eql && nt_vt_pen_are_eql(pen, actual.pen))
+                continue;
+
+            if(len > NT_VT_TEXT_CAP)
+                len = NT_VT_TEXT_CAP;
+
+            memset(&mismatch, 0, sizeof(mismatch));
+            mismatch.x = x;
+            mismatch.y = y;
+            memcpy(mismatch.expected_text, text, len);
+            mismatch.expected_len = (uint8_t)len;
+            mismatch.expected_flags = flags;
+            mismatch.expected_gfx = cell.gfx;
+            mismatch.expected_pen = pen;
+            mismatch.actual = actual;
+
+            verify->fn(&mismatch, verify->data);
+            return;
+        }
+    }
+}
+
+/* ------------------------------------------------------ */
+
+void nt__verify_frame_begin(struct nt_ctx* ctx, const struct nt_grid* grid,
+        bool full)
+{
+    struct nt__verify* verify = *nt__ctx_verify(ctx);
+    if(verify == NULL)
+        return;
+
+    /* An earlier frame still in the output buffer is covered by this one. */
+    verify->pending = false;
+
+    size_t width, height, vt_width, vt_height;
+    nt_grid_get_size(grid, &width, &height);
+    nt_vt_get_size(verify->vt, &vt_width, &vt_height);
+
+    if((width != vt_width) || (height != vt_height))
+    {
+        nt_vt_destroy(verify->vt);
+        verify->vt = NULL;
+        verify->synced = false;
+
+        if((width == 0) || (height == 0) ||
+           (nt_vt_new(width, height, &verify->vt) != 0))
+            return;
+    }
+
+    if(full)
+        verify->synced = true;
+}
+
+void nt__verify_frame_end(struct nt_ctx* ctx, const struct nt_grid* grid)
+{
+    struct nt__verify* verify = *nt__ctx_verify(ctx);
+    if((verify == NULL) || (verify->vt == NULL) || !verify->synced)
+        return;
+
+    if(nt__output_buffered(ctx) == 0)
+    {
+        nt__verify_check(ctx, verify, grid);
+        return;
+    }
+
+    if((verify->frame == NULL) && (nt_grid_new(0, 0, &verify->frame) != 0))
+        return;
+
+    verify->pending = (nt__grid_copy(verify->frame, grid) == 0);
+}
+
+void nt__verify_on_flush(struct nt_ctx* ctx)
+{
+    struct nt__verify* verify = *nt__ctx_verify(ctx);
+    if((verify == NULL) || !verify->pending)
+        return;
+
+    verify->pending = false;
+    nt__verify_check(ctx, verify, verify->frame);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int nt_ctx_verify_enable(struct nt_ctx* ctx, nt_verify_fn fn, void* data)
+{
+    if(fn == NULL)
+        return NT_ERR_INVALID_ARG;
+
+    struct nt__verify** slot = nt__ctx_verify(ctx);
+    if(*slot != NULL)
+    {
+        (*slot)->fn = fn;
+        (*slot)->data = data;
+        return 0;
+    }
+
+    struct nt__verify* verify = calloc(1, sizeof(struct nt__verify));
+    if(verify == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    if(nt_vt_new(2, 1, &verify->scratch) != 0)
+    {
+        free(verify);
+        return NT_ERR_ALLOC_FAIL;
+    }
+
+    verify->fn = fn;
+    verify->data = data;
+    *slot = verify;
+
+    return 0;
+}
+
+void nt_ctx_verify_disable(struct nt_ctx* ctx)
+{
+    struct nt__verify** slot = nt__ctx_verify(ctx);
+
+    nt__verify_destroy(*slot);
+    *slot = NULL;
+}
+
+/* ------------------------------------------------------ */
+
+int nt_verify_enable(nt_verify_fn fn, void* data)
+{
+    return nt_ctx_verify_enable(NULL, fn, data);
+}
+
+void nt_verify_disable(void)
+{
+    nt_ctx_verify_disable(NULL);
+}
@@ -0,0 +1,756 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "nt.h"
+#include "nt_vt.h"
+#include "uconv.h"
+
+#define NT__VT_PARAMS_MAX 16
+#define NT__VT_TAB_WIDTH 8
+
+enum nt__vt_state
+{
+    VT_GROUND,
+    VT_ESC, // after ESC
+    VT_ESC_SKIP, // after ESC and an intermediate byte, e.g. ESC ( B
+    VT_CSI, // in ESC [ ... final
+    VT_UTF8 // in a multi-byte UTF-8 unit
+};
+
+struct nt_vt
+{
+    size_t width, height;
+
+    /* `cells` is the shown screen, the other one is kept aside while the
+     * alternate screen is on or off. */
+    struct nt_vt_cell* cells;
+    struct nt_vt_cell* other_cells;
+    bool alt_screen;
+
+    size_t cursor_x, cursor_y;
+    size_t saved_x, saved_y;
+    bool cursor_visible;
+
+    /* The cursor is past the last column, a printed character wraps first. */
+    bool wrap_pending;
+
+    struct nt_vt_pen pen;
+
+    enum nt__vt_state state;
+    int params[NT__VT_PARAMS_MAX]; // -1 if omitted
+    size_t param_count;
+    bool param_private;
+
+    uint8_t utf8[4];
+    size_t utf8_len, utf8_need;
+
+    struct nt_vt_stats stats;
+};
+
+/* -------------------------------------------------------------------------- */
+/* WIDTH */
+/* -------------------------------------------------------------------------- */
+
+struct nt__vt_range
+{
+    uint32_t first, last;
+};
+
+static const struct nt__vt_range vt_zero_width[] = {
+    { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD },
+    { 0x0610, 0x061A }, { 0x064B, 0x065F }, { 0x0E31, 0x0E31 },
+    { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x1AB0, 0x1AFF },
+    { 0x1DC0, 0x1DFF }, { 0x200B, 0x200F }, { 0x20D0, 0x20FF },
+    { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0x1F3FB, 0x1F3FF },
+    { 0xE0100, 0xE01EF }
+};
+
+static const struct nt__vt_range vt_wide[] = {
+    { 0x1100, 0x115F }, { 0x2E80, 0x303E }, { 0x3041, 0x33FF },
+    { 0x3400, 0x4DBF }, { 0x4E00, 0x9FFF }, { 0xA000, 0xA4CF },
+    { 0xAC00, 0xD7A3 }, { 0xF900, 0xFAFF }, { 0xFE30, 0xFE4F },
+    { 0xFF00, 0xFF60 }, { 0xFFE0, 0xFFE6 }, { 0x1F300, 0x1F64F },
+    { 0x1F900, 0x1F9FF }, { 0x20000, 0x2FFFD }, { 0x30000, 0x3FFFD }
+};
+
+static bool nt__vt_in_ranges(uint32_t cp,
+        const struct nt__vt_range* ranges, size_t count)
+{
+    size_t i;
+    for(i = 0; i < count; i++)
+    {
+        if((cp >= ranges[i].first) && (cp <= ranges[i].last))
+            return true;
+    }
+
+    return false;
+}
+
+static size_t nt__vt_cp_width(uint32_t cp)
+{
+    if(nt__vt_in_ranges(cp, vt_zero_width,
+            sizeof(vt_zero_width) / sizeof(vt_zero_width[0])))
+        return 0;
+
+    if(nt__vt_in_ranges(cp, vt_wide, sizeof(vt_wide) / sizeof(vt_wide[0])))
+        return 2;
+
+    return 1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* CELLS */
+/* -------------------------------------------------------------------------- */
+
+static inline struct nt_vt_cell* nt__vt_cell(struct nt_vt* vt,
+        size_t x, size_t y)
+{
+    return &vt->cells[(y * vt->width) + x];
+}
+
+/* A space drawn with the background of `pen`, as erasing leaves behind. */
+static struct nt_vt_cell nt__vt_blank(const struct nt_vt_pen* pen)
+{
+    struct nt_vt_cell cell;
+    memset(&cell, 0, sizeof(cell));
+
+    cell.text[0] = ' ';
+    cell.len = 1;
+    if(pen != NULL)
+        cell.pen.bg = pen->bg;
+
+    return cell;
+}
+
+static bool nt__vt_cell_are_eql(const struct nt_vt_cell* cell1,
+        const struct nt_vt_cell* cell2)
+{
+    return ((cell1->len == cell2->len) && (cell1->flags == cell2->flags) &&
+            (memcmp(cell1->text, cell2->text, cell1->len) == 0) &&
+            nt_vt_pen_are_eql(cell1->pen, cell2->pen));
+}
+
+static void nt__vt_cell_set(struct nt_vt* vt, size_t x, size_t y,
+        const struct nt_vt_cell* cell)
+{
+    struct nt_vt_cell* dst = nt__vt_cell(vt, x, y);
+    if(nt__vt_cell_are_eql(dst, cell))
+        return;
+
+    *dst = *cell;
+    vt->stats.changes++;
+}
+
+static void nt__vt_erase(struct nt_vt* vt, size_t y, size_t x0, size_t x1)
+{
+    struct nt_vt_cell blank = nt__vt_blank(&vt->pen);
+
+    size_t x;
+    for(x = x0; x < x1; x++)
+        nt__vt_cell_set(vt, x, y, &blank);
+}
+
+/* Blanks the other half of a wide character at (`x`, `y`), which is about to
+ * be overwritten. */
+static void nt__vt_split_wide(struct nt_vt* vt, size_t x, size_t y)
+{
+    struct nt_vt_cell blank = nt__vt_blank(NULL);
+    struct nt_vt_cell* cell = nt__vt_cell(vt, x, y);
+
+    if((cell->flags & NT_CELL_CONT) && (x > 0))
+    {
+        blank.pen = nt__vt_cell(vt, x - 1, y)->pen;
+        nt__vt_cell_set(vt, x - 1, y, &blank);
+    }
+    else if((cell->flags & NT_CELL_WIDE) && ((x + 1) < vt->width))
+    {
+        blank.pen = nt__vt_cell(vt, x + 1, y)->pen;
+        nt__vt_cell_set(vt, x + 1, y, &blank);
+    }
+}
+
+static void nt__vt_scroll_up(struct nt_vt* vt)
+{
+    memmove(vt->cells, vt->cells + vt->width,
+            (vt->height - 1) * vt->width * sizeof(struct nt_vt_cell));
+
+    /* Every shown cell may have changed, but only the cleared row counts. */
+    struct nt_vt_cell blank = nt__vt_blank(&vt->pen);
+    size_t x;
+    for(x = 0; x < vt->width; x++)
+    {
+        *nt__vt_cell(vt, x, vt->height - 1) = blank;
+        vt->stats.changes++;
+    }
+}
+
+static void nt__vt_line_feed(struct nt_vt* vt)
+{
+    if((vt->cursor_y + 1) < vt->height)
+        vt->cursor_y++;
+    else
+        nt__vt_scroll_up(vt);
+}
+
+/* -------------------------------------------------------------------------- */
+/* PRINT */
+/* -------------------------------------------------------------------------- */
+
+/* Appends a zero-width code point to the last printed cell. */
+static void nt__vt_print_combining(struct nt_vt* vt,
+        const uint8_t* utf8, size_t len)
+{
+    size_t x = vt->cursor_x;
+    if(!vt->wrap_pending)
+    {
+        if(x == 0)
+            return;
+        x--;
+    }
+
+    struct nt_vt_cell* cell = nt__vt_cell(vt, x, vt->cursor_y);
+    if((cell->flags & NT_CELL_CONT) && (x > 0))
+        cell = nt__vt_cell(vt, x - 1, vt->cursor_y);
+
+    if((cell->len + len) > NT_VT_TEXT_CAP)
+        return;
+
+    memcpy(cell->text + cell->len, utf8, len);
+    cell->len += (uint8_t)len;
+    vt->stats.changes++;
+}
+
+static void nt__vt_print(struct nt_vt* vt, uint32_t cp,
+        const uint8_t* utf8, size_t len)
+{
+    size_t width = nt__vt_cp_width(cp);
+    if(width == 0)
+    {
+        nt__vt_print_combining(vt, utf8, len);
+        return;
+    }
+
+    if(vt->wrap_pending ||
+       ((width == 2) && ((vt->cursor_x + 1) >= vt->width)))
+    {
+        vt->cursor_x = 0;
+        vt->wrap_pending = false;
+        nt__vt_line_feed(vt);
+    }
+
+    /* A wide character doesn't fit on a single-column screen. */
+    if(width > vt->width)
+        width = 1;
+
+    size_t x = vt->cursor_x;
+    size_t y = vt->cursor_y;
+
+    nt__vt_split_wide(vt, x, y);
+    if(width == 2)
+        nt__vt_split_wide(vt, x + 1, y);
+
+    struct nt_vt_cell cell;
+    memset(&cell, 0, sizeof(cell));
+    memcpy(cell.text, utf8, len);
+    cell.len = (uint8_t)len;
+    cell.flags = (width == 2) ? NT_CELL_WIDE : 0;
+    cell.pen = vt->pen;
+    nt__vt_cell_set(vt, x, y, &cell);
+
+    if(width == 2)
+    {
+        memset(&cell, 0, sizeof(cell));
+        cell.flags = NT_CELL_CONT;
+        cell.pen = vt->pen;
+        nt__vt_cell_set(vt, x + 1, y, &cell);
+    }
+
+    if((x + width) < vt->width)
+        vt->cursor_x = x + width;
+    else
+    {
+        vt->cursor_x = vt->width - 1;
+        vt->wrap_pending = true;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* CSI */
+/* -------------------------------------------------------------------------- */
+
+static inline int nt__vt_param(const struct nt_vt* vt, size_t i, int def)
+{
+    if((i >= vt->param_count) || (vt->params[i] < 0))
+        return def;
+
+    return vt->params[i];
+}
+
+static void nt__vt_cursor_set(struct nt_vt* vt, long x, long y)
+{
+    if(x < 0) x = 0;
+    if(y < 0) y = 0;
+    if((size_t)x >= vt->width) x = (long)vt->width - 1;
+    if((size_t)y >= vt->height) y = (long)vt->height - 1;
+
+    vt->cursor_x = (size_t)x;
+    vt->cursor_y = (size_t)y;
+    vt->wrap_pending = false;
+}
+
+/* Reads an extended color starting at parameter `*i`, 38 or 48, and advances
+ * `*i` past it. */
+static void nt__vt_sgr_color(struct nt_vt* vt, size_t* i,
+        struct nt_vt_color* color)
+{
+    int kind = nt__vt_param(vt, *i + 1, -1);
+    if((kind == 5) && ((*i + 2) < vt->param_count))
+    {
+        *color = (struct nt_vt_color) {
+            .type = NT_VT_COLOR_C256,
+            .idx = (uint8_t)nt__vt_param(vt, *i + 2, 0)
+        };
+        *i += 2;
+    }
+    else if((kind == 2) && ((*i + 4) < vt->param_count))
+    {
+        *color = (struct nt_vt_color) {
+            .type = NT_VT_COLOR_RGB,
+            .rgb = {
+                (uint8_t)nt__vt_param(vt, *i + 2, 0),
+                (uint8_t)nt__vt_param(vt, *i + 3, 0),
+                (uint8_t)nt__vt_param(vt, *i + 4, 0)
+            }
+        };
+        *i += 4;
+    }
+    else
+        *i = vt->param_count;
+}
+
+static void nt__vt_sgr(struct nt_vt* vt)
+{
+    static const struct nt_vt_color color_default = {0};
+
+    size_t count = (vt->param_count > 0) ? vt->param_count : 1;
+    size_t i;
+    int p;
+    for(i = 0; i < count; i++)
+    {
+        p = nt__vt_param(vt, i, 0);
+        switch(p)
+        {
+            case 0:
+                memset(&vt->pen, 0, sizeof(vt->pen));
+                break;
+            case 1: vt->pen.style |= NT_STYLE_BOLD; break;
+            case 2: vt->pen.style |= NT_STYLE_FAINT; break;
+            case 3: vt->pen.style |= NT_STYLE_ITALIC; break;
+            case 4: vt->pen.style |= NT_STYLE_UNDERLINE; break;
+            case 5: vt->pen.style |= NT_STYLE_BLINK; break;
+            case 7: vt->pen.style |= NT_STYLE_REVERSE; break;
+            case 8: vt->pen.style |= NT_STYLE_HIDDEN; break;
+            case 9: vt->pen.style |= NT_STYLE_STRIKETHROUGH; break;
+            case 22:
+                vt->pen.style &= ~(NT_STYLE_BOLD | NT_STYLE_FAINT);
+                break;
+            case 23: vt->pen.style &= ~NT_STYLE_ITALIC; break;
+            case 24: vt->pen.style &= ~NT_STYLE_UNDERLINE; break;
+            case 25: vt->pen.style &= ~NT_STYLE_BLINK; break;
+            case 27: vt->pen.style &= ~NT_STYLE_REVERSE; break;
+            case 28: vt->pen.style &= ~NT_STYLE_HIDDEN; break;
+            case 29: vt->pen.style &= ~NT_STYLE_STRIKETHROUGH; break;
+            case 38: nt__vt_sgr_color(vt, &i, &vt->pen.fg); break;
+            case 39: vt->pen.fg = color_default; break;
+            case 48: nt__vt_sgr_color(vt, &i, &vt->pen.bg); break;
+            case 49: vt->pen.bg = color_default; break;
+            default:
+                if((p >= 30) && (p <= 37))
+                {
+                    vt->pen.fg = (struct nt_vt_color) {
+                        .type = NT_VT_COLOR_C8, .idx = (uint8_t)(p - 30) };
+                }
+                else if((p >= 40) && (p <= 47))
+                {
+                    vt->pen.bg = (struct nt_vt_color) {
+                        .type = NT_VT_COLOR_C8, .idx = (uint8_t)(p - 40) };
+                }
+                else if((p >= 90) && (p <= 97))
+                {
+                    vt->pen.fg = (struct nt_vt_color) {
+                        .type = NT_VT_COLOR_C256, .idx = (uint8_t)(p - 82) };
+                }
+                else if((p >= 100) && (p <= 107))
+                {
+                    vt->pen.bg = (struct nt_vt_color) {
+                        .type = NT_VT_COLOR_C256, .idx = (uint8_t)(p - 92) };
+                }
+                break;
+        }
+    }
+}
+
+static void nt__vt_alt_screen(struct nt_vt* vt, bool enable)
+{
+    if(vt->alt_screen == enable)
+        return;
+
+    struct nt_vt_cell* cells = vt->cells;
+    vt->cells = vt->other_cells;
+    vt->other_cells = cells;
+    vt->alt_screen = enable;
+
+    /* Every shown cell may have changed, count the switch as one change. */
+    vt->stats.changes++;
+
+    if(enable)
+    {
+        vt->saved_x = vt->cursor_x;
+        vt->saved_y = vt->cursor_y;
+
+        size_t y;
+        for(y = 0; y < vt->height; y++)
+            nt__vt_erase(vt, y, 0, vt->width);
+    }
+    else
+        nt__vt_cursor_set(vt, (long)vt->saved_x, (long)vt->saved_y);
+}
+
+static void nt__vt_csi_private(struct nt_vt* vt, uint8_t final)
+{
+    bool set = (final == 'h');
+    if(!set && (final != 'l'))
+        return;
+
+    size_t i;
+    for(i = 0; i < vt->param_count; i++)
+    {
+        switch(vt->params[i])
+        {
+            case 25:
+                vt->cursor_visible = set;
+                break;
+            case 1049:
+                nt__vt_alt_screen(vt, set);
+                break;
+            default: // mouse reporting and others don't affect the screen
+                break;
+        }
+    }
+}
+
+static void nt__vt_csi(struct nt_vt* vt, uint8_t final)
+{
+    if(vt->param_private)
+    {
+        nt__vt_csi_private(vt, final);
+        return;
+    }
+
+    long x = (long)vt->cursor_x;
+    long y = (long)vt->cursor_y;
+    int n = nt__vt_param(vt, 0, 1);
+    if(n == 0)
+        n = 1;
+
+    size_t row;
+    switch(final)
+    {
+        case 'H':
+        case 'f':
+            nt__vt_cursor_set(vt, nt__vt_param(vt, 1, 1) - 1L,
+                    nt__vt_param(vt, 0, 1) - 1L);
+            break;
+        case 'A': nt__vt_cursor_set(vt, x, y - n); break;
+        case 'B': nt__vt_cursor_set(vt, x, y + n); break;
+        case 'C': nt__vt_cursor_set(vt, x + n, y); break;
+        case 'D': nt__vt_cursor_set(vt, x - n, y); break;
+        case 'G': nt__vt_cursor_set(vt, n - 1L, y); break;
+        case 'd': nt__vt_cursor_set(vt, x, n - 1L); break;
+        case 'm':
+            nt__vt_sgr(vt);
+            break;
+        case 'J':
+            switch(nt__vt_param(vt, 0, 0))
+            {
+                case 0:
+                    nt__vt_erase(vt, y, x, vt->width);
+                    for(row = y + 1; row < vt->height; row++)
+                        nt__vt_erase(vt, row, 0, vt->width);
+                    break;
+                case 1:
+                    for(row = 0; row < (size_t)y; row++)
+                        nt__vt_erase(vt, row, 0, vt->width);
+                    nt__vt_erase(vt, y, 0, x + 1);
+                    break;
+                case 2:
+                    for(row = 0; row < vt->height; row++)
+                        nt__vt_erase(vt, row, 0, vt->width);
+                    break;
+                default: // 3 clears the scrollback, which isn't modeled
+                    break;
+            }
+            break;
+        case 'K':
+            switch(nt__vt_param(vt, 0, 0))
+            {
+                case 0: nt__vt_erase(vt, y, x, vt->width); break;
+                case 1: nt__vt_erase(vt, y, 0, x + 1); break;
+                case 2: nt__vt_erase(vt, y, 0, vt->width); break;
+                default: break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* FEED */
+/* -------------------------------------------------------------------------- */
+
+static void nt__vt_control(struct nt_vt* vt, uint8_t c)
+{
+    switch(c)
+    {
+        case '\r':
+            vt->cursor_x = 0;
+            vt->wrap_pending = false;
+            break;
+        case '\n':
+        case '\v':
+        case '\f':
+            nt__vt_line_feed(vt);
+            break;
+        case '\b':
+            if(vt->cursor_x > 0)
+                vt->cursor_x--;
+            vt->wrap_pending = false;
+            break;
+        case '\t':
+            nt__vt_cursor_set(vt, (long)(((vt->cursor_x / NT__VT_TAB_WIDTH) + 1) *
+                    NT__VT_TAB_WIDTH), (long)vt->cursor_y);
+            break;
+        case 0x1b:
+            vt->state = VT_ESC;
+            break;
+        default: // SI, SO, BEL and others
+            break;
+    }
+}
+
+static void nt__vt_feed_byte(struct nt_vt* vt, uint8_t c)
+{
+    uint32_t cp;
+
+    switch(vt->state)
+    {
+        case VT_GROUND:
+            if((c < 0x20) || (c == 0x7F))
+            {
+                nt__vt_control(vt, c);
+            }
+            else if(c < 0x80)
+            {
+                nt__vt_print(vt, c, &c, 1);
+            }
+            else
+            {
+                vt->utf8_need = uc_utf8_unit_len(c);
+                if((vt->utf8_need < 2) || (vt->utf8_need > 4))
+                {
+                    nt__vt_print(vt, 0xFFFD, (const uint8_t*)"\xEF\xBF\xBD", 3);
+                    break;
+                }
+                vt->utf8[0] = c;
+                vt->utf8_len = 1;
+                vt->state = VT_UTF8;
+            }
+            break;
+
+        case VT_UTF8:
+            vt->utf8[vt->utf8_len++] = c;
+            if(vt->utf8_len < vt->utf8_need)
+                break;
+
+            vt->state = VT_GROUND;
+            if(uc_utf8_to_utf32_single(vt->utf8, vt->utf8_len, 0, &cp) != 0)
+                nt__vt_print(vt, 0xFFFD, (const uint8_t*)"\xEF\xBF\xBD", 3);
+            else
+                nt__vt_print(vt, cp, vt->utf8, vt->utf8_len);
+            break;
+
+        case VT_ESC:
+            vt->state = VT_GROUND;
+            if(c == '[')
+            {
+                vt->state = VT_CSI;
+                vt->param_count = 0;
+                vt->param_private = false;
+            }
+            else if((c >= 0x20) && (c <= 0x2F)) // charset designation
+                vt->state = VT_ESC_SKIP;
+            break;
+
+        case VT_ESC_SKIP:
+            if((c < 0x20) || (c > 0x2F))
+                vt->state = VT_GROUND;
+            break;
+
+        case VT_CSI:
+            if((c >= '0') && (c <= '9'))
+            {
+                if(vt->param_count == 0)
+                    vt->params[vt->param_count++] = -1;
+
+                int* p = &vt->params[vt->param_count - 1];
+                if(*p < 0)
+                    *p = 0;
+                if(*p < 100000)
+                    *p = (*p * 10) + (c - '0');
+            }
+            else if(c == ';')
+            {
+                if(vt->param_count == 0)
+                    vt->params[vt->param_count++] = -1;
+                if(vt->param_count < NT__VT_PARAMS_MAX)
+                    vt->params[vt->param_count++] = -1;
+            }
+            else if(c == '?')
+            {
+                vt->param_private = true;
+            }
+            else if((c >= 0x40) && (c <= 0x7E))
+            {
+                vt->state = VT_GROUND;
+                nt__vt_csi(vt, c);
+            }
+            else if(c == 0x1b)
+            {
+                vt->state = VT_ESC;
+            }
+            break;
+    }
+}
+
+void nt_vt_feed(struct nt_vt* vt, const char* data, size_t len)
+{
+    if((vt == NULL) || (data == NULL))
+        return;
+
+    vt->stats.bytes += len;
+
+    size_t i;
+    for(i = 0; i < len; i++)
+        nt__vt_feed_byte(vt, (uint8_t)data[i]);
+}
+
+int nt_vt_sink_write(const char* data, size_t len, void* sink_data)
+{
+    nt_vt_feed(sink_data, data, len);
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int nt_vt_new(size_t width, size_t height, struct nt_vt** out_vt)
+{
+    if((out_vt == NULL) || (width == 0) || (height == 0))
+        return NT_ERR_INVALID_ARG;
+
+    struct nt_vt* vt = calloc(1, sizeof(struct nt_vt));
+    if(vt == NULL)
+        return NT_ERR_ALLOC_FAIL;
+
+    vt->width = width;
+    vt->height = height;
+    vt->cursor_visible = true;
+    vt->cells = malloc(width * height * sizeof(struct nt_vt_cell));
+    vt->other_cells = malloc(width * height * sizeof(struct nt_vt_cell));
+    if((vt->cells == NULL) || (vt->other_cells == NULL))
+    {
+        nt_vt_destroy(vt);
+        return NT_ERR_ALLOC_FAIL;
+    }
+
+    struct nt_vt_cell blank = nt__vt_blank(NULL);
+    size_t i;
+    for(i = 0; i < (width * height); i++)
+    {
+        vt->cells[i] = blank;
+        vt->other_cells[i] = blank;
+    }
+
+    *out_vt = vt;
+
+    return 0;
+}
+
+void nt_vt_destroy(struct nt_vt* vt)
+{
+    if(vt == NULL)
+        return;
+
+    free(vt->cells);
+    free(vt->other_cells);
+    free(vt);
+}
+
+/* ------------------------------------------------------ */
+
+void nt_vt_get_size(const struct nt_vt* vt,
+        size_t* out_width, size_t* out_height)
+{
+    if(out_width != NULL)
+        *out_width = (vt != NULL) ? vt->width : 0;
+    if(out_height != NULL)
+        *out_height = (vt != NULL) ? vt->height : 0;
+}
+
+int nt_vt_get_cell(const struct nt_vt* vt, size_t x, size_t y,
+        struct nt_vt_cell* out_cell)
+{
+    if((vt == NULL) || (out_cell == NULL))
+        return NT_ERR_INVALID_ARG;
+    if((x >= vt->width) || (y >= vt->height))
+        return NT_ERR_OUT_OF_BOUNDS;
+
+    *out_cell = vt->cells[(y * vt->width) + x];
+
+    return 0;
+}
+
+void nt_vt_get_cursor(const struct nt_vt* vt,
+        size_t* out_x, size_t* out_y, bool* out_visible)
+{
+    if(vt == NULL)
+        return;
+
+    if(out_x != NULL) *out_x = vt->cursor_x;
+    if(out_y != NULL) *out_y = vt->cursor_y;
+    if(out_visible != NULL) *out_visible = vt->cursor_visible;
+}
+
+void nt_vt_get_pen(const struct nt_vt* vt, struct nt_vt_pen* out_pen)
+{
+    if((vt != NULL) && (out_pen != NULL))
+        *out_pen = vt->pen;
+}
+
+/* ------------------------------------------------------ */
+
+void nt_vt_get_stats(const struct nt_vt* vt, struct nt_vt_stats* out_stats)
+{
+    if((vt != NULL) && (out_stats != NULL))
+        *out_stats = vt->stats;
+}
+
+void nt_vt_reset_stats(struct nt_vt* vt)
+{
+    if(vt != NULL)
+        vt->stats = (struct nt_vt_stats) {0};
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2025 Novak Stevanović
+ * Licensed under the MIT License. See LICENSE file in project root.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "nt_internal.h"
+
+/* Workers sleep on `work_cond` until `work_gen` changes, then claim task
+ * indices from `task_next` until all are taken. The last one to finish wakes
+ * the caller through `done_cond`. */
+
+static pthread_mutex_t work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t workers[NT__WORKERS_MAX];
+static unsigned int worker_count;
+static bool workers_quit;
+
+static unsigned long work_gen;
+static unsigned long start_gen; // `work_gen` when the workers were started
+static nt__task_fn task_fn;
+static void* task_arg;
+static size_t task_count;
+static size_t task_next;
+static unsigned int workers_busy;
+
+static void nt__workers_drain(nt__task_fn fn, void* arg, size_t count)
+{
+    size_t idx;
+    while((idx = __atomic_fetch_add(&task_next, 1, __ATOMIC_RELAXED)) < count)
+        fn(arg, idx);
+}
+
+static void* nt__worker_main(void* _arg)
+{
+    (void)_arg;
+
+    unsigned long seen_gen = start_gen;
+    nt__task_fn fn;
+    void* arg;
+    size_t count;
+
+    pthread_mutex_lock(&work_lock);
+    while(true)
+    {
+        while(!workers_quit && (work_gen == seen_gen))
+            pthread_cond_wait(&work_cond, &work_lock);
+
+        if(workers_quit)
+            break;
+
+        seen_gen = work_gen;
+        fn = task_fn;
+        arg = task_arg;
+        count = task_count;
+        pthread_mutex_unlock(&work_lock);
+
+        nt__workers_drain(fn, arg, count);
+
+        pthread_mutex_lock(&work_lock);
+        workers_busy--;
+        if(workers_busy == 0)
+            pthread_cond_signal(&done_cond);
+    }
+    pthread_mutex_unlock(&work_lock);
+
+    return NULL;
+}
+
+static void nt__workers_stop(void)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&work_lock);
+    workers_quit = true;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&work_lock);
+
+    for(i = 0; i < worker_count; i++)
+        pthread_join(workers[i], NULL);
+
+    worker_count = 0;
+    workers_quit = false;
+}
+
+int nt__workers_set(unsigned int count)
+{
+    if(count > NT__WORKERS_MAX)
+        return NT_ERR_INVALID_ARG;
+
+    if(count == worker_count)
+        return 0;
+
+    nt__workers_stop();
+
+    /* Work is only handed out by the calling thread, so no generation can
+     * pass while workers start up. */
+    start_gen = work_gen;
+
+    for(worker_count = 0; worker_count < count; worker_count++)
+    {
+        if(pthread_create(&workers[worker_count], NULL,
+                    nt__worker_main, NULL) != 0)
+        {
+            nt__workers_stop();
+            return NT_ERR_UNEXPECTED;
+        }
+    }
+
+    return 0;
+}
+
+unsigned int nt__workers_get(void)
+{
+    return worker_count;
+}
+
+void nt__workers_run(nt__task_fn fn, void* arg, size_t count)
+{
+    if(worker_count == 0)
+    {
+        size_t i;
+        for(i = 0; i < count; i++)
+            fn(arg, i);
+        return;
+    }
+
+    pthread_mutex_lock(&work_lock);
+    task_fn = fn;
+    task_arg = arg;
+    task_count = count;
+    __atomic_store_n(&task_next, 0, __ATOMIC_RELAXED);
+    workers_busy = worker_count;
+    work_gen++;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&work_lock);
+
+    nt__workers_drain(fn, arg, count);
+
+    pthread_mutex_lock(&work_lock);
+    while(workers_busy > 0)
+        pthread_cond_wait(&done_cond, &work_lock);
+    pthread_mutex_unlock(&work_lock);
+}